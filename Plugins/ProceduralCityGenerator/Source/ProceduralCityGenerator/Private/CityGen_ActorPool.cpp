@@ -0,0 +1,180 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#include "CityGen_ActorPool.h"
+
+#include "CityGen_LogChannels.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+UCityGen_ActorPoolComponent::UCityGen_ActorPoolComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+AActor* UCityGen_ActorPoolComponent::AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform)
+{
+	bool bReused = false;
+	return AcquireInternal(ActorClass, Transform, bReused);
+}
+
+AActor* UCityGen_ActorPoolComponent::AcquireInternal(UClass* ActorClass, const FTransform& Transform, bool& bOutReused)
+{
+	bOutReused = false;
+	if (ActorClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	FCityGen_PooledActors* Pool = UsePool() ? Pools.Find(ActorClass) : nullptr;
+	while ((Pool != nullptr) && (Pool->Actors.Num() > 0))
+	{
+		AActor* Actor = Pool->Actors.Pop(EAllowShrinking::No);
+		if (!IsValid(Actor))
+		{
+			continue; // Destroyed by someone else while parked
+		}
+
+		Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Actor->SetActorHiddenInGame(false);
+		Actor->SetActorEnableCollision(true);
+		Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+		NumReusedActors++;
+		bOutReused = true;
+		return Actor;
+	}
+
+	return SpawnActor(ActorClass, Transform, false);
+}
+
+void UCityGen_ActorPoolComponent::ReleaseActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+
+	FCityGen_PooledActors* Pool = UsePool() ? &Pools.FindOrAdd(Actor->GetClass()) : nullptr;
+	if ((Pool == nullptr) || (Pool->Actors.Num() >= MaxPooledActorsPerClass))
+	{
+		Actor->Destroy();
+		return;
+	}
+
+	ParkActor(Actor);
+	Pool->Actors.Add(Actor);
+}
+
+void UCityGen_ActorPoolComponent::WarmUp(TSubclassOf<AActor> ActorClass, int32 Count)
+{
+	if ((ActorClass == nullptr) || !UsePool())
+	{
+		return;
+	}
+
+	const FTransform ParkingTransform(ParkingLocation);
+	FCityGen_PooledActors& Pool = Pools.FindOrAdd(ActorClass);
+	const int32 TargetCount = FMath::Min(Count, MaxPooledActorsPerClass);
+	Pool.Actors.Reserve(TargetCount);
+	while (Pool.Actors.Num() < TargetCount)
+	{
+		AActor* Actor = SpawnActor(ActorClass, ParkingTransform, true);
+		if (Actor == nullptr)
+		{
+			break;
+		}
+		Pool.Actors.Add(Actor);
+	}
+}
+
+void UCityGen_ActorPoolComponent::SetMaxPooledActorsPerClass(int32 NewMaxPooledActorsPerClass)
+{
+	MaxPooledActorsPerClass = FMath::Max(NewMaxPooledActorsPerClass, 0);
+	for (TPair<TObjectPtr<UClass>, FCityGen_PooledActors>& Pool : Pools)
+	{
+		while (Pool.Value.Actors.Num() > MaxPooledActorsPerClass)
+		{
+			AActor* Actor = Pool.Value.Actors.Pop(EAllowShrinking::No);
+			if (IsValid(Actor))
+			{
+				Actor->Destroy();
+			}
+		}
+		Pool.Value.Actors.Shrink();
+	}
+}
+
+void UCityGen_ActorPoolComponent::EmptyPool()
+{
+	for (TPair<TObjectPtr<UClass>, FCityGen_PooledActors>& Pool : Pools)
+	{
+		for (AActor* Actor : Pool.Value.Actors)
+		{
+			if (IsValid(Actor))
+			{
+				Actor->Destroy();
+			}
+		}
+	}
+	Pools.Empty();
+}
+
+int32 UCityGen_ActorPoolComponent::GetNumPooledActors(TSubclassOf<AActor> ActorClass) const
+{
+	const FCityGen_PooledActors* Pool = Pools.Find(ActorClass.Get());
+	return (Pool != nullptr) ? Pool->Actors.Num() : 0;
+}
+
+int32 UCityGen_ActorPoolComponent::GetTotalNumPooledActors() const
+{
+	int32 NumActors = 0;
+	for (const TPair<TObjectPtr<UClass>, FCityGen_PooledActors>& Pool : Pools)
+	{
+		NumActors += Pool.Value.Actors.Num();
+	}
+	return NumActors;
+}
+
+void UCityGen_ActorPoolComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	EmptyPool();
+	Super::EndPlay(EndPlayReason);
+}
+
+AActor* UCityGen_ActorPoolComponent::SpawnActor(UClass* ActorClass, const FTransform& Transform, bool bSpawnParked)
+{
+	AActor* Actor = GetWorld()->SpawnActorDeferred<AActor>(ActorClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::Undefined);
+	if (Actor == nullptr)
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Failed to spawn %s actor"), *GetNameSafe(ActorClass));
+		return nullptr;
+	}
+
+	if (bSpawnParked)
+	{
+		Actor->SetActorHiddenInGame(true);
+		Actor->SetActorEnableCollision(false);
+	}
+	Actor->FinishSpawning(Transform);
+	if (bSpawnParked)
+	{
+		ParkActor(Actor);
+	}
+
+	NumSpawnedActors++;
+	return Actor;
+}
+
+void UCityGen_ActorPoolComponent::ParkActor(AActor* Actor) const
+{
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	Actor->SetActorLocation(ParkingLocation, false, nullptr, ETeleportType::ResetPhysics);
+}
+
+bool UCityGen_ActorPoolComponent::UsePool() const
+{
+	const UWorld* World = GetWorld();
+	return (World != nullptr) && World->IsGameWorld() && (MaxPooledActorsPerClass > 0);
+}
@@ -0,0 +1,75 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#include "CityGen_CorridorCellStore.h"
+
+void FCityGen_CorridorCellStore::SetBounds(const FSG_GridCoordinate& Origin, const FIntVector& Size)
+{
+	CellBits.Init(Origin, Size);
+	ForEach([this](const FSG_GridCoordinate& Coord, const FCellConnectionState& State)
+	{
+		CellBits.Set(Coord);
+	});
+}
+
+const FCellConnectionState* FCityGen_CorridorCellStore::Find(const FSG_GridCoordinate& Coord) const
+{
+	const uint64 Code = FSG_MortonKey::Encode(Coord.X, Coord.Y, Coord.Z);
+	const int32* pChunkIndex = ChunkIndices.Find(Code >> FSG_MortonCellSet::BrickShift);
+	if (pChunkIndex == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FChunk& Chunk = Chunks[*pChunkIndex];
+	const int32 CellIndex = (int32)(Code & FSG_MortonCellSet::CellInBrickMask);
+	return ((Chunk.UsedCells & (1ull << CellIndex)) != 0) ? &Chunk.Cells[CellIndex] : nullptr;
+}
+
+FCellConnectionState& FCityGen_CorridorCellStore::FindOrAdd(const FSG_GridCoordinate& Coord)
+{
+	const uint64 Code = FSG_MortonKey::Encode(Coord.X, Coord.Y, Coord.Z);
+	const uint64 ChunkCode = Code >> FSG_MortonCellSet::BrickShift;
+	int32& ChunkIndex = ChunkIndices.FindOrAdd(ChunkCode, INDEX_NONE);
+	if (ChunkIndex == INDEX_NONE)
+	{
+		ChunkIndex = Chunks.AddDefaulted();
+		Chunks[ChunkIndex].ChunkCode = ChunkCode;
+	}
+
+	FChunk& Chunk = Chunks[ChunkIndex];
+	const int32 CellIndex = (int32)(Code & FSG_MortonCellSet::CellInBrickMask);
+	const uint64 CellBit = 1ull << CellIndex;
+	if ((Chunk.UsedCells & CellBit) == 0)
+	{
+		Chunk.UsedCells |= CellBit;
+		Chunk.Cells[CellIndex] = FCellConnectionState();
+		CellBits.Set(Coord);
+		NumCells++;
+	}
+	return Chunk.Cells[CellIndex];
+}
+
+void FCityGen_CorridorCellStore::GetKeys(TArray<FSG_GridCoordinate>& OutCoords) const
+{
+	OutCoords.Reset(NumCells);
+	ForEach([&OutCoords](const FSG_GridCoordinate& Coord, const FCellConnectionState& State)
+	{
+		OutCoords.Add(Coord);
+	});
+}
+
+void FCityGen_CorridorCellStore::Empty()
+{
+	Chunks.Empty();
+	ChunkIndices.Empty();
+	CellBits.Reset();
+	NumCells = 0;
+}
+
+void FCityGen_CorridorCellStore::Reset()
+{
+	Chunks.Reset();
+	ChunkIndices.Reset();
+	CellBits.ClearAll();
+	NumCells = 0;
+}
@@ -0,0 +1,250 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#include "CityGen_CorridorSearch.h"
+
+#include "SimpleGridRuntime/Public/SG_GridNeighbours.h"
+
+void FCityGen_GridBounds::Reset()
+{
+	Min = FSG_GridCoordinate(0, 0, 0);
+	Max = FSG_GridCoordinate(0, 0, 0);
+	bIsValid = false;
+}
+
+void FCityGen_GridBounds::Add(const FSG_GridCoordinate& Coord)
+{
+	if (!bIsValid)
+	{
+		Min = Coord;
+		Max = Coord;
+		bIsValid = true;
+		return;
+	}
+
+	Min.X = FMath::Min(Min.X, Coord.X);
+	Min.Y = FMath::Min(Min.Y, Coord.Y);
+	Min.Z = FMath::Min(Min.Z, Coord.Z);
+	Max.X = FMath::Max(Max.X, Coord.X);
+	Max.Y = FMath::Max(Max.Y, Coord.Y);
+	Max.Z = FMath::Max(Max.Z, Coord.Z);
+}
+
+void FCityGen_GridBounds::ExpandBy(const FIntVector& Margin)
+{
+	if (!bIsValid)
+	{
+		return;
+	}
+
+	Min = Min - FSG_GridCoordinate(Margin.X, Margin.Y, Margin.Z);
+	Max = Max + FSG_GridCoordinate(Margin.X, Margin.Y, Margin.Z);
+}
+
+FIntVector FCityGen_GridBounds::GetSize() const
+{
+	if (!bIsValid)
+	{
+		return FIntVector(0, 0, 0);
+	}
+	return FIntVector(Max.X - Min.X + 1, Max.Y - Min.Y + 1, Max.Z - Min.Z + 1);
+}
+
+static_assert(FCityGen_DenseSearchStorage::NumDirections == FSG_GridNeighbours::Num3D, "Walkable neighbour masks are indexed by direction");
+
+const FSG_GridCoordinate FCityGen_DenseSearchStorage::DirectionOffsets[FCityGen_DenseSearchStorage::NumDirections] =
+{
+	FSG_GridNeighbours::GetOffset(0),
+	FSG_GridNeighbours::GetOffset(1),
+	FSG_GridNeighbours::GetOffset(2),
+	FSG_GridNeighbours::GetOffset(3),
+	FSG_GridNeighbours::GetOffset(4),
+	FSG_GridNeighbours::GetOffset(5),
+};
+
+void FCityGen_DenseSearchStorage::Init(const FCityGen_GridBounds& InBounds, bool bWithJumpLengths)
+{
+	Bounds = InBounds;
+	bUseJumpLengths = bWithJumpLengths;
+
+	const FIntVector Size = Bounds.GetSize();
+	StrideY = Size.X;
+	StrideZ = Size.X * Size.Y;
+
+	// The arrays only grow, cells of any previous search are invalidated by the new generation
+	const int32 NumCells = Size.X * Size.Y * Size.Z;
+	if (NumCells > CellGeneration.Num())
+	{
+		GCost.SetNumUninitialized(NumCells);
+		NodeFlags.SetNumUninitialized(NumCells);
+		CellGeneration.SetNumZeroed(NumCells);
+		NumAllocations++;
+	}
+	if (bUseJumpLengths && (NumCells > ParentJumpLength.Num()))
+	{
+		ParentJumpLength.SetNumUninitialized(NumCells);
+		NumAllocations++;
+	}
+
+	Generation++;
+	if (Generation == 0)
+	{
+		// Wrapped around: an old stamp could match the new generation
+		FMemory::Memzero(CellGeneration.GetData(), CellGeneration.Num() * sizeof(uint32));
+		Generation = 1;
+	}
+}
+
+void FCityGen_DenseSearchStorage::Empty()
+{
+	GCost.Empty();
+	NodeFlags.Empty();
+	ParentJumpLength.Empty();
+	CellGeneration.Empty();
+	Generation = 0;
+}
+
+void FCityGen_DenseSearchStorage::GetPath(int32 EndIndex, TArray<FSG_GridCoordinate>& OutPath) const
+{
+	OutPath.Reset();
+
+	FSG_GridCoordinate CurrentCoord = ToCoord(EndIndex);
+	OutPath.Add(CurrentCoord);
+
+	int32 CurrentIndex = EndIndex;
+	uint8 ParentDirection = GetParentDirection(CurrentIndex);
+	while (ParentDirection != ParentDirectionNone)
+	{
+		const int32 NumSteps = GetParentJumpLength(CurrentIndex);
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			CurrentCoord = CurrentCoord + DirectionOffsets[ParentDirection];
+			OutPath.Add(CurrentCoord);
+		}
+
+		CurrentIndex = ToIndex(CurrentCoord);
+		ParentDirection = GetParentDirection(CurrentIndex);
+	}
+}
+
+FCityGen_IntegerCostModel::FCityGen_IntegerCostModel(float DistanceFactorForZ)
+{
+	HorizontalStepCost = UnitsPerCell;
+	VerticalStepCost = UnitsPerCell * FMath::Max(1, FMath::RoundToInt(DistanceFactorForZ));
+}
+
+void FCityGen_BucketQueue::Reset()
+{
+	for (int32 Priority = MinPriority; Priority <= MaxPriority; ++Priority)
+	{
+		Buckets[Priority].Reset();
+	}
+	MinPriority = 0;
+	MaxPriority = -1;
+	NumEntries = 0;
+}
+
+void FCityGen_BucketQueue::Empty()
+{
+	Buckets.Empty();
+	MinPriority = 0;
+	MaxPriority = -1;
+	NumEntries = 0;
+}
+
+void FCityGen_BucketQueue::Push(int32 Priority, const FEntry& Entry)
+{
+	check(Priority >= 0);
+
+	if (Priority >= Buckets.Num())
+	{
+		if (Priority >= Buckets.Max())
+		{
+			NumAllocations++;
+		}
+		Buckets.SetNum(Priority + 1);
+	}
+
+	TArray<FEntry>& Bucket = Buckets[Priority];
+	if (Bucket.Num() == Bucket.Max())
+	{
+		NumAllocations++;
+	}
+	Bucket.Add(Entry);
+
+	// The heuristic is not consistent, a priority can be lower than the one of the last popped entry
+	if (NumEntries == 0)
+	{
+		MinPriority = Priority;
+		MaxPriority = Priority;
+	}
+	else
+	{
+		MinPriority = FMath::Min(MinPriority, Priority);
+		MaxPriority = FMath::Max(MaxPriority, Priority);
+	}
+	NumEntries++;
+}
+
+bool FCityGen_BucketQueue::Pop(FEntry& OutEntry)
+{
+	if (NumEntries == 0)
+	{
+		return false;
+	}
+
+	while (Buckets[MinPriority].Num() == 0)
+	{
+		MinPriority++;
+	}
+
+	OutEntry = Buckets[MinPriority].Pop(EAllowShrinking::No);
+	NumEntries--;
+	return true;
+}
+
+SIZE_T FCityGen_BucketQueue::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Buckets.GetAllocatedSize();
+	for (const TArray<FEntry>& Bucket : Buckets)
+	{
+		AllocatedSize += Bucket.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+void FCityGen_SearchWorkspace::BeginSearch(const FCityGen_GridBounds& Bounds, bool bWithJumpLengths)
+{
+	Storage.Init(Bounds, bWithJumpLengths);
+	OpenHeap.Reset();
+	OpenBuckets.Reset();
+	OpenHeapCapacity = OpenHeap.Max();
+	NumSearches++;
+}
+
+void FCityGen_SearchWorkspace::EndSearch()
+{
+	if (OpenHeap.Max() > OpenHeapCapacity)
+	{
+		NumHeapAllocations++;
+	}
+}
+
+void FCityGen_SearchWorkspace::PushOpenNode(int32 CellIndex, float GCost, float HCost, uint32 Sequence)
+{
+	FCityGen_DenseOpenEntry Entry;
+	Entry.FCost = GCost + HCost;
+	Entry.HCost = HCost;
+	Entry.GCost = GCost;
+	Entry.Sequence = Sequence;
+	Entry.CellIndex = CellIndex;
+	OpenHeap.HeapPush(Entry, FCityGen_DenseOpenEntryPredicate());
+	Storage.SetOpen(CellIndex);
+}
+
+void FCityGen_SearchWorkspace::Empty()
+{
+	Storage.Empty();
+	OpenHeap.Empty();
+	OpenBuckets.Empty();
+	OpenHeapCapacity = 0;
+}
@@ -0,0 +1,117 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#include "CityGen_FreeRectPacker.h"
+
+namespace
+{
+	bool Overlaps(const FIntRect& A, const FIntRect& B)
+	{
+		return (A.Min.X < B.Max.X) && (A.Max.X > B.Min.X) && (A.Min.Y < B.Max.Y) && (A.Max.Y > B.Min.Y);
+	}
+
+	bool ContainsRect(const FIntRect& Outer, const FIntRect& Inner)
+	{
+		return (Inner.Min.X >= Outer.Min.X) && (Inner.Max.X <= Outer.Max.X) && (Inner.Min.Y >= Outer.Min.Y) && (Inner.Max.Y <= Outer.Max.Y);
+	}
+}
+
+void FCityGen_FreeRectPacker::Init(const FIntRect& InArea)
+{
+	Area = InArea;
+	FreeRects.Reset();
+	if ((Area.Width() > 0) && (Area.Height() > 0))
+	{
+		FreeRects.Add(Area);
+	}
+}
+
+bool FCityGen_FreeRectPacker::FindPosition(const FIntPoint& Size, FIntRect& OutRect, bool& bOutRotated) const
+{
+	int32 BestShortSide = TNumericLimits<int32>::Max();
+	int32 BestLongSide = TNumericLimits<int32>::Max();
+	bool bFound = false;
+
+	const int32 NumOrientations = (Size.X == Size.Y) ? 1 : 2;
+	for (const FIntRect& FreeRect : FreeRects)
+	{
+		for (int32 Orientation = 0; Orientation < NumOrientations; ++Orientation)
+		{
+			const FIntPoint OrientedSize = (Orientation == 0) ? Size : FIntPoint(Size.Y, Size.X);
+			const int32 LeftoverX = FreeRect.Width() - OrientedSize.X;
+			const int32 LeftoverY = FreeRect.Height() - OrientedSize.Y;
+			if ((LeftoverX < 0) || (LeftoverY < 0))
+			{
+				continue;
+			}
+
+			const int32 ShortSide = FMath::Min(LeftoverX, LeftoverY);
+			const int32 LongSide = FMath::Max(LeftoverX, LeftoverY);
+			if ((ShortSide < BestShortSide) || ((ShortSide == BestShortSide) && (LongSide < BestLongSide)))
+			{
+				BestShortSide = ShortSide;
+				BestLongSide = LongSide;
+				OutRect = FIntRect(FreeRect.Min, FreeRect.Min + OrientedSize);
+				bOutRotated = (Orientation == 1);
+				bFound = true;
+			}
+		}
+	}
+	return bFound;
+}
+
+void FCityGen_FreeRectPacker::Occupy(const FIntRect& Rect)
+{
+	SplitRects.Reset();
+	for (int32 Index = FreeRects.Num() - 1; Index >= 0; --Index)
+	{
+		const FIntRect FreeRect = FreeRects[Index];
+		if (!Overlaps(FreeRect, Rect))
+		{
+			continue;
+		}
+		FreeRects.RemoveAtSwap(Index, EAllowShrinking::No);
+
+		if (Rect.Min.X > FreeRect.Min.X)
+		{
+			SplitRects.Add(FIntRect(FreeRect.Min, FIntPoint(Rect.Min.X, FreeRect.Max.Y)));
+		}
+		if (Rect.Max.X < FreeRect.Max.X)
+		{
+			SplitRects.Add(FIntRect(FIntPoint(Rect.Max.X, FreeRect.Min.Y), FreeRect.Max));
+		}
+		if (Rect.Min.Y > FreeRect.Min.Y)
+		{
+			SplitRects.Add(FIntRect(FreeRect.Min, FIntPoint(FreeRect.Max.X, Rect.Min.Y)));
+		}
+		if (Rect.Max.Y < FreeRect.Max.Y)
+		{
+			SplitRects.Add(FIntRect(FIntPoint(FreeRect.Min.X, Rect.Max.Y), FreeRect.Max));
+		}
+	}
+
+	PruneSplitRects();
+	FreeRects.Append(SplitRects);
+}
+
+void FCityGen_FreeRectPacker::PruneSplitRects()
+{
+	// The kept free rectangles are not contained in each other, and one of them can not be contained in a split one:
+	// the split one is inside of a removed free rectangle, which would contain the kept one too
+	for (int32 Index = SplitRects.Num() - 1; Index >= 0; --Index)
+	{
+		const FIntRect& SplitRect = SplitRects[Index];
+		bool bIsContained = FreeRects.ContainsByPredicate([&SplitRect](const FIntRect& FreeRect) { return ContainsRect(FreeRect, SplitRect); });
+
+		// Among equal split rectangles, the one with the lowest index is kept
+		for (int32 OtherIndex = 0; (OtherIndex < SplitRects.Num()) && !bIsContained; ++OtherIndex)
+		{
+			const FIntRect& OtherRect = SplitRects[OtherIndex];
+			bIsContained = (OtherIndex != Index) && ContainsRect(OtherRect, SplitRect) && ((OtherRect != SplitRect) || (OtherIndex < Index));
+		}
+
+		if (bIsContained)
+		{
+			SplitRects.RemoveAt(Index, EAllowShrinking::No);
+		}
+	}
+}
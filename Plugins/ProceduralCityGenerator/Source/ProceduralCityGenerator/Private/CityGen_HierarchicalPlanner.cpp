@@ -0,0 +1,508 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#include "CityGen_HierarchicalPlanner.h"
+
+#include "Algo/Reverse.h"
+
+namespace
+{
+	int32 GetAxisValue(const FSG_GridCoordinate& Coord, int32 Axis)
+	{
+		return (Axis == 0) ? Coord.X : ((Axis == 1) ? Coord.Y : Coord.Z);
+	}
+
+	void SetAxisValue(FSG_GridCoordinate& Coord, int32 Axis, int32 Value)
+	{
+		int32& AxisValue = (Axis == 0) ? Coord.X : ((Axis == 1) ? Coord.Y : Coord.Z);
+		AxisValue = Value;
+	}
+
+	// Positive direction of each axis, see FCityGen_DenseSearchStorage::DirectionOffsets
+	constexpr uint8 PositiveAxisDirections[3] = { 0, 1, 4 };
+}
+
+void FCityGen_HierarchicalPlanner::Build(const FCityGen_GridBounds& InBounds, const FIntVector& InChunkSize, const FSG_GridBitVolume& InBlockedGridTiles, const FCityGen_CorridorCellStore& InCorridors, float InDistanceFactorForZ)
+{
+	Reset();
+
+	Bounds = InBounds;
+	ChunkSize = FIntVector(FMath::Max(InChunkSize.X, 1), FMath::Max(InChunkSize.Y, 1), FMath::Max(InChunkSize.Z, 1));
+	BlockedGridTiles = &InBlockedGridTiles;
+	Corridors = &InCorridors;
+	DistanceFactorForZ = InDistanceFactorForZ;
+
+	const FIntVector GridSize = Bounds.GetSize();
+	NumChunks = FIntVector(
+		FMath::DivideAndRoundUp(GridSize.X, ChunkSize.X),
+		FMath::DivideAndRoundUp(GridSize.Y, ChunkSize.Y),
+		FMath::DivideAndRoundUp(GridSize.Z, ChunkSize.Z));
+
+	Chunks.SetNum(NumChunks.X * NumChunks.Y * NumChunks.Z);
+	for (int32 ChunkZ = 0; ChunkZ < NumChunks.Z; ++ChunkZ)
+	{
+		for (int32 ChunkY = 0; ChunkY < NumChunks.Y; ++ChunkY)
+		{
+			for (int32 ChunkX = 0; ChunkX < NumChunks.X; ++ChunkX)
+			{
+				const FSG_GridCoordinate ChunkMin = Bounds.Min + FSG_GridCoordinate(ChunkX * ChunkSize.X, ChunkY * ChunkSize.Y, ChunkZ * ChunkSize.Z);
+				const FSG_GridCoordinate ChunkMax(
+					FMath::Min(ChunkMin.X + ChunkSize.X - 1, Bounds.Max.X),
+					FMath::Min(ChunkMin.Y + ChunkSize.Y - 1, Bounds.Max.Y),
+					FMath::Min(ChunkMin.Z + ChunkSize.Z - 1, Bounds.Max.Z));
+
+				FChunk& Chunk = Chunks[GetChunkIndex(ChunkMin)];
+				Chunk.Bounds.Add(ChunkMin);
+				Chunk.Bounds.Add(ChunkMax);
+			}
+		}
+	}
+
+	BuildEntrances();
+
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		UpdateChunkEdges(ChunkIndex);
+	}
+	NumChunkUpdates = 0;
+}
+
+void FCityGen_HierarchicalPlanner::Reset()
+{
+	Bounds.Reset();
+	NumChunks = FIntVector(0, 0, 0);
+	BlockedGridTiles = nullptr;
+	Corridors = nullptr;
+	Chunks.Empty();
+	Nodes.Empty();
+	CoordToNode.Empty();
+	OpenHeap.Empty();
+	NumChunkUpdates = 0;
+}
+
+int32 FCityGen_HierarchicalPlanner::GetChunkIndex(const FSG_GridCoordinate& Coord) const
+{
+	const int32 ChunkX = (Coord.X - Bounds.Min.X) / ChunkSize.X;
+	const int32 ChunkY = (Coord.Y - Bounds.Min.Y) / ChunkSize.Y;
+	const int32 ChunkZ = (Coord.Z - Bounds.Min.Z) / ChunkSize.Z;
+	return ChunkX + (ChunkY + ChunkZ * NumChunks.Y) * NumChunks.X;
+}
+
+float FCityGen_HierarchicalPlanner::GetStepCost(const FSG_GridCoordinate& From, const FSG_GridCoordinate& To) const
+{
+	const float AxisCost = (From.Z != To.Z) ? DistanceFactorForZ : 1.0f;
+	return Corridors->Contains(To) ? AxisCost * CityGenCorridorCost::MovementReductionFactorForCellWithCorridor : AxisCost;
+}
+
+float FCityGen_HierarchicalPlanner::GetHeuristic(const FSG_GridCoordinate& From, const FSG_GridCoordinate& To) const
+{
+	return FMath::Abs(From.X - To.X) + FMath::Abs(From.Y - To.Y) + FMath::Abs(From.Z - To.Z) * DistanceFactorForZ;
+}
+
+void FCityGen_HierarchicalPlanner::BuildEntrances()
+{
+	TArray<uint8> FaceCellStates; // 0: closed, 1: open, 2: already in an entrance
+	TArray<int32> CellsToVisit;
+	TArray<int32> EntranceCells;
+
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		const FCityGen_GridBounds ChunkBounds = Chunks[ChunkIndex].Bounds;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			// Only the face on the positive side, the other one is handled by the previous chunk
+			if (GetAxisValue(ChunkBounds.Max, Axis) >= GetAxisValue(Bounds.Max, Axis))
+			{
+				continue;
+			}
+
+			const FSG_GridCoordinate& Offset = FCityGen_DenseSearchStorage::DirectionOffsets[PositiveAxisDirections[Axis]];
+			const int32 AxisU = (Axis == 0) ? 1 : 0;
+			const int32 AxisV = (Axis == 2) ? 1 : 2;
+			const int32 MinU = GetAxisValue(ChunkBounds.Min, AxisU);
+			const int32 MinV = GetAxisValue(ChunkBounds.Min, AxisV);
+			const int32 SizeU = GetAxisValue(ChunkBounds.Max, AxisU) - MinU + 1;
+			const int32 SizeV = GetAxisValue(ChunkBounds.Max, AxisV) - MinV + 1;
+
+			auto GetFaceCell = [&](int32 FaceIndex)
+			{
+				FSG_GridCoordinate Coord = ChunkBounds.Max;
+				SetAxisValue(Coord, AxisU, MinU + (FaceIndex % SizeU));
+				SetAxisValue(Coord, AxisV, MinV + (FaceIndex / SizeU));
+				return Coord;
+			};
+
+			FaceCellStates.Init(0, SizeU * SizeV);
+			for (int32 FaceIndex = 0; FaceIndex < FaceCellStates.Num(); ++FaceIndex)
+			{
+				const FSG_GridCoordinate Coord = GetFaceCell(FaceIndex);
+				FaceCellStates[FaceIndex] = (IsWalkable(Coord) && IsWalkable(Coord + Offset)) ? 1 : 0;
+			}
+
+			// Each group of connected open cells of the face is one entrance, crossed by its middle cell
+			for (int32 FirstIndex = 0; FirstIndex < FaceCellStates.Num(); ++FirstIndex)
+			{
+				if (FaceCellStates[FirstIndex] != 1)
+				{
+					continue;
+				}
+
+				EntranceCells.Reset();
+				CellsToVisit.Reset();
+				CellsToVisit.Add(FirstIndex);
+				FaceCellStates[FirstIndex] = 2;
+				while (CellsToVisit.Num() > 0)
+				{
+					const int32 FaceIndex = CellsToVisit.Pop(EAllowShrinking::No);
+					EntranceCells.Add(FaceIndex);
+
+					const int32 U = FaceIndex % SizeU;
+					const int32 V = FaceIndex / SizeU;
+					const int32 Neighbours[4] = {
+						(U > 0) ? FaceIndex - 1 : INDEX_NONE,
+						(U < SizeU - 1) ? FaceIndex + 1 : INDEX_NONE,
+						(V > 0) ? FaceIndex - SizeU : INDEX_NONE,
+						(V < SizeV - 1) ? FaceIndex + SizeU : INDEX_NONE,
+					};
+					for (int32 NeighbourIndex : Neighbours)
+					{
+						if ((NeighbourIndex != INDEX_NONE) && (FaceCellStates[NeighbourIndex] == 1))
+						{
+							FaceCellStates[NeighbourIndex] = 2;
+							CellsToVisit.Add(NeighbourIndex);
+						}
+					}
+				}
+
+				EntranceCells.Sort();
+				const FSG_GridCoordinate InsideCoord = GetFaceCell(EntranceCells[EntranceCells.Num() / 2]);
+				const int32 InsideNode = FindOrAddNode(InsideCoord);
+				const int32 OutsideNode = FindOrAddNode(InsideCoord + Offset);
+				Nodes[InsideNode].Edges.Add({ OutsideNode, 0.0f, true });
+				Nodes[OutsideNode].Edges.Add({ InsideNode, 0.0f, true });
+			}
+		}
+	}
+}
+
+int32 FCityGen_HierarchicalPlanner::FindOrAddNode(const FSG_GridCoordinate& Coord)
+{
+	// A cell on the edge of a chunk can be used by entrances of several faces
+	if (const int32* ExistingNode = CoordToNode.Find(Coord))
+	{
+		return *ExistingNode;
+	}
+
+	const int32 NodeIndex = Nodes.AddDefaulted();
+	Nodes[NodeIndex].Coord = Coord;
+	Nodes[NodeIndex].ChunkIndex = GetChunkIndex(Coord);
+	Chunks[Nodes[NodeIndex].ChunkIndex].NodeIndices.Add(NodeIndex);
+	CoordToNode.Add(Coord, NodeIndex);
+	return NodeIndex;
+}
+
+void FCityGen_HierarchicalPlanner::UpdateChunkEdges(int32 ChunkIndex)
+{
+	const FChunk& Chunk = Chunks[ChunkIndex];
+	for (int32 NodeIndex : Chunk.NodeIndices)
+	{
+		FNode& Node = Nodes[NodeIndex];
+		Node.Edges.RemoveAll([](const FEdge& Edge) { return !Edge.bInterChunk; });
+
+		SearchInBounds(Node.Coord, Chunk.Bounds, false, nullptr);
+		for (int32 OtherNodeIndex : Chunk.NodeIndices)
+		{
+			if (OtherNodeIndex == NodeIndex)
+			{
+				continue;
+			}
+
+			const float Cost = Storage.GetGCost(Storage.ToIndex(Nodes[OtherNodeIndex].Coord));
+			if (Cost != TNumericLimits<float>::Max())
+			{
+				Node.Edges.Add({ OtherNodeIndex, Cost, false });
+			}
+		}
+	}
+	NumChunkUpdates++;
+}
+
+int32 FCityGen_HierarchicalPlanner::SearchInBounds(const FSG_GridCoordinate& Source, const FCityGen_GridBounds& SearchBounds, bool bReverse, const FSG_GridCoordinate* Target)
+{
+	Storage.Init(SearchBounds);
+	OpenHeap.Reset();
+
+	const FCityGen_DenseOpenEntryPredicate OpenHeapPredicate;
+	uint32 PushSequence = 0;
+
+	auto PushOpenNode = [&](int32 CellIndex, float GCost)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		Entry.FCost = GCost;
+		Entry.GCost = GCost;
+		Entry.Sequence = PushSequence++;
+		Entry.CellIndex = CellIndex;
+		OpenHeap.HeapPush(Entry, OpenHeapPredicate);
+		Storage.SetOpen(CellIndex);
+	};
+
+	const int32 SourceIndex = Storage.ToIndex(Source);
+	const int32 TargetIndex = (Target != nullptr) ? Storage.ToIndex(*Target) : INDEX_NONE;
+	Storage.SetGCost(SourceIndex, 0.0f);
+	PushOpenNode(SourceIndex, 0.0f);
+
+	int32 NumExpansions = 0;
+	while (OpenHeap.Num() > 0)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		OpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+
+		const int32 CurrentIndex = Entry.CellIndex;
+		if (!Storage.IsOpen(CurrentIndex) || (Storage.GetGCost(CurrentIndex) != Entry.GCost))
+		{
+			continue; // Stale entry: the node was closed or improved after this push
+		}
+
+		NumExpansions++;
+		Storage.SetClosed(CurrentIndex);
+		if (CurrentIndex == TargetIndex)
+		{
+			break;
+		}
+
+		const FSG_GridCoordinate CurrentCoords = Storage.ToCoord(CurrentIndex);
+		const float CurrentGCost = Storage.GetGCost(CurrentIndex);
+		for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+		{
+			const FSG_GridCoordinate NeighbourCoords = CurrentCoords + FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+			if (!Storage.IsInside(NeighbourCoords) || !IsWalkable(NeighbourCoords))
+			{
+				continue;
+			}
+
+			const float MovementCost = bReverse ? GetStepCost(NeighbourCoords, CurrentCoords) : GetStepCost(CurrentCoords, NeighbourCoords);
+			const int32 NeighbourIndex = Storage.ToIndex(NeighbourCoords);
+			const float NewGCost = CurrentGCost + MovementCost;
+			if (NewGCost >= Storage.GetGCost(NeighbourIndex))
+			{
+				continue;
+			}
+
+			Storage.SetGCost(NeighbourIndex, NewGCost);
+			Storage.SetParentDirection(NeighbourIndex, FCityGen_DenseSearchStorage::GetOppositeDirection(Direction));
+			PushOpenNode(NeighbourIndex, NewGCost);
+		}
+	}
+	return NumExpansions;
+}
+
+bool FCityGen_HierarchicalPlanner::FindPath(const FSG_GridCoordinate& Start, const FSG_GridCoordinate& Goal, TArray<FSG_GridCoordinate>& OutPath, int32& OutNumExpansions)
+{
+	OutPath.Reset();
+	OutNumExpansions = 0;
+	// A blocked start would be expanded like a free cell, and the path would leave from inside of a room
+	if (!IsBuilt() || !IsWalkable(Start) || !IsWalkable(Goal))
+	{
+		return false;
+	}
+
+	// Start and goal are temporary nodes, linked to the nodes of their chunk
+	const int32 NumNodes = Nodes.Num();
+	const int32 StartNode = NumNodes;
+	const int32 GoalNode = NumNodes + 1;
+	const int32 StartChunkIndex = GetChunkIndex(Start);
+	const int32 GoalChunkIndex = GetChunkIndex(Goal);
+
+	TArray<FEdge> StartEdges;
+	OutNumExpansions += SearchInBounds(Start, Chunks[StartChunkIndex].Bounds, false, nullptr);
+	for (int32 NodeIndex : Chunks[StartChunkIndex].NodeIndices)
+	{
+		const float Cost = Storage.GetGCost(Storage.ToIndex(Nodes[NodeIndex].Coord));
+		if (Cost != TNumericLimits<float>::Max())
+		{
+			StartEdges.Add({ NodeIndex, Cost, false });
+		}
+	}
+	if (StartChunkIndex == GoalChunkIndex)
+	{
+		const float Cost = Storage.GetGCost(Storage.ToIndex(Goal));
+		if (Cost != TNumericLimits<float>::Max())
+		{
+			StartEdges.Add({ GoalNode, Cost, false });
+		}
+	}
+
+	TMap<int32, float> CostsToGoal;
+	OutNumExpansions += SearchInBounds(Goal, Chunks[GoalChunkIndex].Bounds, true, nullptr);
+	for (int32 NodeIndex : Chunks[GoalChunkIndex].NodeIndices)
+	{
+		const float Cost = Storage.GetGCost(Storage.ToIndex(Nodes[NodeIndex].Coord));
+		if (Cost != TNumericLimits<float>::Max())
+		{
+			CostsToGoal.Add(NodeIndex, Cost);
+		}
+	}
+
+	auto GetNodeCoord = [&](int32 NodeIndex) -> const FSG_GridCoordinate&
+	{
+		return (NodeIndex == StartNode) ? Start : ((NodeIndex == GoalNode) ? Goal : Nodes[NodeIndex].Coord);
+	};
+
+	// A* on the abstract graph
+	TArray<float> GCosts;
+	TArray<int32> Parents;
+	GCosts.Init(TNumericLimits<float>::Max(), NumNodes + 2);
+	Parents.Init(INDEX_NONE, NumNodes + 2);
+
+	TArray<FCityGen_DenseOpenEntry> AbstractOpenHeap;
+	const FCityGen_DenseOpenEntryPredicate OpenHeapPredicate;
+	uint32 PushSequence = 0;
+
+	auto PushOpenNode = [&](int32 NodeIndex, float GCost)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		Entry.HCost = GetHeuristic(GetNodeCoord(NodeIndex), Goal);
+		Entry.FCost = GCost + Entry.HCost;
+		Entry.GCost = GCost;
+		Entry.Sequence = PushSequence++;
+		Entry.CellIndex = NodeIndex;
+		AbstractOpenHeap.HeapPush(Entry, OpenHeapPredicate);
+	};
+
+	auto Relax = [&](int32 FromNode, int32 ToNode, float Cost)
+	{
+		const float NewGCost = GCosts[FromNode] + Cost;
+		if (NewGCost >= GCosts[ToNode])
+		{
+			return;
+		}
+
+		GCosts[ToNode] = NewGCost;
+		Parents[ToNode] = FromNode;
+		PushOpenNode(ToNode, NewGCost);
+	};
+
+	GCosts[StartNode] = 0.0f;
+	PushOpenNode(StartNode, 0.0f);
+
+	// The heuristic is not consistent with the corridor cost reduction, so a node can be expanded more than once
+	const int32 MaxAbstractExpansions = 8 * (NumNodes + 2);
+	int32 NumAbstractExpansions = 0;
+	bool bFoundPath = false;
+	while (AbstractOpenHeap.Num() > 0)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		AbstractOpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+
+		const int32 CurrentNode = Entry.CellIndex;
+		if (GCosts[CurrentNode] != Entry.GCost)
+		{
+			continue; // Stale entry: the node was improved after this push
+		}
+
+		OutNumExpansions++;
+		if (++NumAbstractExpansions > MaxAbstractExpansions)
+		{
+			break;
+		}
+
+		if (CurrentNode == GoalNode)
+		{
+			bFoundPath = true;
+			break;
+		}
+
+		if (CurrentNode == StartNode)
+		{
+			for (const FEdge& Edge : StartEdges)
+			{
+				Relax(CurrentNode, Edge.TargetNode, Edge.Cost);
+			}
+			continue;
+		}
+
+		const FNode& Node = Nodes[CurrentNode];
+		for (const FEdge& Edge : Node.Edges)
+		{
+			const float Cost = Edge.bInterChunk ? GetStepCost(Node.Coord, Nodes[Edge.TargetNode].Coord) : Edge.Cost;
+			Relax(CurrentNode, Edge.TargetNode, Cost);
+		}
+		if (const float* CostToGoal = CostsToGoal.Find(CurrentNode))
+		{
+			Relax(CurrentNode, GoalNode, *CostToGoal);
+		}
+	}
+
+	if (!bFoundPath)
+	{
+		return false;
+	}
+
+	TArray<int32> AbstractPath;
+	for (int32 NodeIndex = GoalNode; NodeIndex != INDEX_NONE; NodeIndex = Parents[NodeIndex])
+	{
+		AbstractPath.Add(NodeIndex);
+	}
+	Algo::Reverse(AbstractPath);
+
+	// Refine each abstract edge: inter chunk edges are adjacent cells, intra chunk edges are searched inside their chunk only
+	TArray<FSG_GridCoordinate> SegmentCells;
+	OutPath.Add(Start);
+	for (int32 PathIndex = 1; PathIndex < AbstractPath.Num(); ++PathIndex)
+	{
+		const FSG_GridCoordinate& From = GetNodeCoord(AbstractPath[PathIndex - 1]);
+		const FSG_GridCoordinate& To = GetNodeCoord(AbstractPath[PathIndex]);
+		if (From == To)
+		{
+			continue;
+		}
+
+		const int32 ChunkIndex = GetChunkIndex(From);
+		if (ChunkIndex != GetChunkIndex(To))
+		{
+			OutPath.Add(To);
+			continue;
+		}
+
+		OutNumExpansions += SearchInBounds(From, Chunks[ChunkIndex].Bounds, false, &To);
+		if (!Storage.IsClosed(Storage.ToIndex(To)))
+		{
+			OutPath.Reset();
+			return false;
+		}
+
+		SegmentCells.Reset();
+		FSG_GridCoordinate Coord = To;
+		while (!(Coord == From))
+		{
+			SegmentCells.Add(Coord);
+			Coord = Coord + FCityGen_DenseSearchStorage::DirectionOffsets[Storage.GetParentDirection(Storage.ToIndex(Coord))];
+		}
+		for (int32 CellIndex = SegmentCells.Num() - 1; CellIndex >= 0; --CellIndex)
+		{
+			OutPath.Add(SegmentCells[CellIndex]);
+		}
+	}
+	return true;
+}
+
+void FCityGen_HierarchicalPlanner::OnCorridorCellsAdded(const TArray<FSG_GridCoordinate>& Cells)
+{
+	if (!IsBuilt())
+	{
+		return;
+	}
+
+	TSet<int32> ChunksToUpdate;
+	for (const FSG_GridCoordinate& Cell : Cells)
+	{
+		if (Bounds.Contains(Cell))
+		{
+			ChunksToUpdate.Add(GetChunkIndex(Cell));
+		}
+	}
+
+	for (int32 ChunkIndex : ChunksToUpdate)
+	{
+		UpdateChunkEdges(ChunkIndex);
+	}
+}
@@ -175,6 +175,15 @@ TArray<FSG_GridCoordinate> ACityGen_RoomBase::BuildListOfOverlappingCoordsFromBo
 	return OverlappingTiles;
 }
 
+FIntPoint ACityGen_RoomBase::GetRoomTileFootprint() const
+{
+	// The safe zone allows bounds a bit larger than a whole number of cells
+	const FVector RoomSize = GetRoomGlobalSize();
+	return FIntPoint(
+		FMath::Max(1, FMath::CeilToInt(RoomSize.X / TileSize.X - BoundSafeZonePercent)),
+		FMath::Max(1, FMath::CeilToInt(RoomSize.Y / TileSize.Y - BoundSafeZonePercent)));
+}
+
 void ACityGen_RoomBase::CloseAllDoors()
 {
 	for (FExitArrowData& ExitPoint : CachedExitPointsData)
@@ -183,6 +192,13 @@ void ACityGen_RoomBase::CloseAllDoors()
 	}
 }
 
+void ACityGen_RoomBase::ResetForReuse()
+{
+	// The exits are cached again, so none of them is used
+	RefreshCachedLocalGridCoord();
+	CloseAllDoors();
+}
+
 void ACityGen_RoomBase::SetExitState(bool bUsed, FExitArrowData& InOutExitPoint)
 {
 	bool bVisible = !bUsed;
@@ -230,19 +246,19 @@ void ACityGen_RoomBase::SetExitsUsed(const FCellConnectionState& state)
 
 	// Compute list of local space coord to open
 	TArray<FSG_GridCoordinate> DoorsToOpen;
-	if (state.bConnectNorth)
+	if (state.IsConnectedNorth())
 	{
 		DoorsToOpen.Add(FSG_GridCoordinate(1, 0, 0).RotateBy(rotationNorm));
 	}
-	if (state.bConnectEast)
+	if (state.IsConnectedEast())
 	{
 		DoorsToOpen.Add(FSG_GridCoordinate(0, 1, 0).RotateBy(rotationNorm));
 	}
-	if (state.bConnectSouth)
+	if (state.IsConnectedSouth())
 	{
 		DoorsToOpen.Add(FSG_GridCoordinate(-1, 0, 0).RotateBy(rotationNorm));
 	}
-	if (state.bConnectWest)
+	if (state.IsConnectedWest())
 	{
 		DoorsToOpen.Add(FSG_GridCoordinate(0, -1, 0).RotateBy(rotationNorm));
 	}
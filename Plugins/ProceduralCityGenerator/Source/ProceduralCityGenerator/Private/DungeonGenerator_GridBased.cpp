@@ -2,16 +2,27 @@
 
 #include "DungeonGenerator_GridBased.h"
 
+#include "CityGen_ActorPool.h"
 #include "CityGen_LogChannels.h"
 #include "CityGen_NodeCoordinate.h"
 #include "CityGen_ObstacleBase.h"
 #include "CityGen_Roombase.h"
 
 #include "SimpleGridRuntime/Public/SG_GridComponent.h"
+#include "SimpleGridRuntime/Public/SG_MortonKey.h"
 
+#include "Algo/Count.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "Components/ArrowComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Misc/ScopeExit.h"
 #include "Components/BoxComponent.h"
 #include "Components/SceneComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
 #include <Kismet/GameplayStatics.h>
 #include "Runtime/Engine/Classes/Kismet/KismetSystemLibrary.h"
 #include "Runtime/Engine/Classes/Kismet/KismetMathLibrary.h"
@@ -40,19 +51,47 @@ ADungeonGenerator_GridBased::ADungeonGenerator_GridBased()
 	DungeonGridCmpt = CreateDefaultSubobject<USG_GridComponent>(TEXT("DungeonGridCmpt"));
 	DungeonGridCmpt->SetTileSize(TileSize);
 
+	CorridorActorPool = CreateDefaultSubobject<UCityGen_ActorPoolComponent>(TEXT("CorridorActorPool"));
+
 	DungeonGenRandomStream = FRandomStream(RandomSeed);
+
+	// Only ticks while spawning deferred corridors
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void ADungeonGenerator_GridBased::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bSpawningCorridorsFromTick)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	const double DeadlineSeconds = FPlatformTime::Seconds() + CorridorSpawnBudgetMs / 1000.0;
+	if (StepSpawnCorridors(DeadlineSeconds))
+	{
+		bSpawningCorridorsFromTick = false;
+		SetActorTickEnabled(false);
+		FinishSpawnCorridors();
+	}
 }
 
 void ADungeonGenerator_GridBased::ClearCorridorMeshes()
 {
+	CancelSpawnCorridors();
+
 	for (const auto& Corridor : AllSpawnedCorridors)
 	{
 		if (Corridor.Value != nullptr)
 		{
-			Corridor.Value->Destroy();
+			CorridorActorPool->ReleaseActor(Corridor.Value);
 		}
 	}
 	AllSpawnedCorridors.Empty();
+	ClearCorridorInstances();
 
 	for (ACityGen_RoomBase* Room : AllRooms)
 	{
@@ -66,8 +105,24 @@ void ADungeonGenerator_GridBased::ClearCorridorMeshes()
 
 	AllRooms.Empty();
 	TilesToIgnore.Empty();
-	BlockedGridTiles.Empty();
+	HierarchicalPlanner.Reset();
+	BlockedGridTiles.Reset();
 	RequestedCorridors.Empty();
+	PairRecords.Empty();
+	PlannedRoomTransforms.Empty();
+}
+
+void ADungeonGenerator_GridBased::WarmUpCorridorPool(int32 NumActorsPerCorridorType)
+{
+	for (int32 TypeIndex = 0; TypeIndex < (int32)ECorridorPieceType::Num; ++TypeIndex)
+	{
+		CorridorActorPool->WarmUp(GetCorridorPieceClass((ECorridorPieceType)TypeIndex), NumActorsPerCorridorType);
+	}
+}
+
+UCityGen_ActorPoolComponent* ADungeonGenerator_GridBased::GetCorridorActorPool() const
+{
+	return CorridorActorPool;
 }
 
 #if WITH_EDITOR
@@ -84,18 +139,13 @@ void ADungeonGenerator_GridBased::DebugDrawConnectedPath()
 	const FVector DebugDrawOffset_Center = CellCenter;
 	const FVector DebugDrawOffset_Arrow = CellCenter + FVector(0,0,1) * DungeonGridCmpt->GetTileSize().Z * 0.75f;
 
-	TArray<FSG_GridCoordinate> coords;
-	RequestedCorridors.GetKeys(coords);
-	for(const auto& coord : coords)
+	RequestedCorridors.ForEach([&](const FSG_GridCoordinate& coord, const FCellConnectionState& connectState)
 	{
-		const FCellConnectionState& connectState = RequestedCorridors[coord];
-		TArray<bool> DirArray = connectState.GetDirectionArray();
-
 		FVector PositionBlock = DungeonGridCmpt->GridToWorld(coord);
 		DrawDebugSphere(GetWorld(), PositionBlock + DebugDrawOffset_Center, 100.0, 8, FColor::Black, false, DebugLifeTime);
 		for(uint32 rotIndex = 0; rotIndex < 4; ++rotIndex)
 		{
-			if(DirArray[rotIndex] == false)
+			if(!connectState.IsConnected(rotIndex))
 			{
 				continue;
 			}
@@ -104,7 +154,7 @@ void ADungeonGenerator_GridBased::DebugDrawConnectedPath()
 
 			DrawDebugDirectionalArrow(GetWorld(), PositionBlock + DebugDrawOffset_Center, PositionBlockDest + DebugDrawOffset_Arrow, 100.0f, FColor::Blue, false, DebugLifeTime);
 		}
-	}
+	});
 }
 #endif // WITH_EDITOR
 
@@ -122,53 +172,127 @@ TArray<ACityGen_RoomBase*> ADungeonGenerator_GridBased::GetAllRoomsArray() const
 	return TArray<ACityGen_RoomBase*>();
 }
 
-void ADungeonGenerator_GridBased::InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms)
-{
-	// Nothing by default
-}
-
-bool ADungeonGenerator_GridBased::ConnectRoomsInOrder()
+TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase* >> ADungeonGenerator_GridBased::GetNetworkRoomsToConnectArray() const
 {
-	AllRooms = GetAllRoomsArray();
+	TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase* >> Result;
 
-	if (AllRooms.Num() < 2)
+	TArray<ACityGen_RoomBase*> Rooms;
+	for (const TPair<ACityGen_RoomBase*, ACityGen_RoomBase* >& RoomPair : GetRoomsToConnectArray())
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("Not enough rooms to connect."));
-		return false;
+		Rooms.AddUnique(RoomPair.Key);
+		Rooms.AddUnique(RoomPair.Value);
 	}
-	if(AllSpawnedCorridors.Num() > 0)
+	if (Rooms.Num() < 2)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("There is still corridors left from previous generation, clearing them."));
-		ClearCorridorMeshes();
+		return Result;
 	}
 
-	check(TilesToIgnore.Num() == 0);
-	check(AllSpawnedCorridors.Num() == 0);
-	check(RequestedCorridors.Num() == 0);
-
-	// Clear previously setup blocked gridTiles
-	BlockedGridTiles.Empty();
+	// Distance between the closest unblocked exits of two rooms
+	auto GetRoomDistance = [this](ACityGen_RoomBase* RoomA, ACityGen_RoomBase* RoomB)
+	{
+		float MinDistance = TNumericLimits<float>::Max();
+		for (const FExitArrowData& ExitA : RoomA->GetCachedExitPointsDataRef())
+		{
+			if (IsGridTileBlocked(ExitA.DungeonGridCoord.position))
+			{
+				continue;
+			}
+			for (const FExitArrowData& ExitB : RoomB->GetCachedExitPointsDataRef())
+			{
+				if (!IsGridTileBlocked(ExitB.DungeonGridCoord.position))
+				{
+					MinDistance = FMath::Min(MinDistance, GetDistance(ExitA.DungeonGridCoord.position, ExitB.DungeonGridCoord.position));
+				}
+			}
+		}
+		return MinDistance;
+	};
+
+	// Prim from the first room, dense version as the graph is complete
+	const int32 NumRooms = Rooms.Num();
+	TArray<bool> bInTree;
+	bInTree.Init(false, NumRooms);
+	TArray<float> BestDistance;
+	BestDistance.Init(TNumericLimits<float>::Max(), NumRooms);
+	TArray<int32> BestParent;
+	BestParent.Init(INDEX_NONE, NumRooms);
+
+	int32 LastAdded = 0;
+	bInTree[0] = true;
+	for (int32 NumInTree = 1; NumInTree < NumRooms; ++NumInTree)
+	{
+		int32 NextRoom = INDEX_NONE;
+		for (int32 RoomIndex = 0; RoomIndex < NumRooms; ++RoomIndex)
+		{
+			if (bInTree[RoomIndex])
+			{
+				continue;
+			}
 
-	//UpdateBlockedTiles_Obstacles();
-	SnapRoomsToGrid();
-	UpdateBlockedTiles_RoomBounds();
-	UpdateBlockedTiles_ClosedExits();
-	UpdateBlockedTiles_TilesToIgnore();
+			const float Distance = GetRoomDistance(Rooms[RoomIndex], Rooms[LastAdded]);
+			if (Distance < BestDistance[RoomIndex])
+			{
+				BestDistance[RoomIndex] = Distance;
+				BestParent[RoomIndex] = LastAdded;
+			}
+			if ((NextRoom == INDEX_NONE) || (BestDistance[RoomIndex] < BestDistance[NextRoom]))
+			{
+				NextRoom = RoomIndex;
+			}
+		}
 
-	bool bFoundPathBetweenAllRooms = true;
-	TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase* >> RoomsToConnect = GetRoomsToConnectArray();
-	for(const auto& RoomToConnect : RoomsToConnect)
-	{
-		if (AddCorridorConnectingRooms(RoomToConnect.Key, RoomToConnect.Value) == false)
+		if (BestParent[NextRoom] == INDEX_NONE)
 		{
-			bFoundPathBetweenAllRooms = false;
+			UE_LOG(LogCityGen, Warning, TEXT("%d rooms have no unblocked exit, they are not connected."), NumRooms - NumInTree);
+			break;
 		}
+
+		bInTree[NextRoom] = true;
+		Result.Add(TPair<ACityGen_RoomBase*, ACityGen_RoomBase* >(Rooms[NextRoom], Rooms[BestParent[NextRoom]]));
+		LastAdded = NextRoom;
 	}
+	return Result;
+}
+
+void ADungeonGenerator_GridBased::InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms)
+{
+	// Nothing by default
+}
+
+bool ADungeonGenerator_GridBased::AddRoomToConnect(ACityGen_RoomBase* Room)
+{
+	// No room to connect by default
+	return false;
+}
+
+bool ADungeonGenerator_GridBased::RemoveRoomToConnect(ACityGen_RoomBase* Room)
+{
+	// No room to connect by default
+	return false;
+}
+
+ACityGen_RoomBase* ADungeonGenerator_GridBased::GetFlowFieldHub() const
+{
+	// No hub by default
+	return nullptr;
+}
 
-	if (bFoundPathBetweenAllRooms)
+bool ADungeonGenerator_GridBased::ConnectRoomsInOrder()
+{
+	if (PlanCorridors())
 	{
+		UWorld* World = GetWorld();
+		if (bDeferCorridorSpawning && (World != nullptr) && World->IsGameWorld())
+		{
+			// The paths are committed, the visuals stream in from Tick
+			BeginSpawnCorridors();
+			bSpawningCorridorsFromTick = true;
+			SetActorTickEnabled(true);
+			return true;
+		}
+
 		SpawnCorridors();
-		UpdateDoorStatus();
+		FinishSpawnCorridors();
 		return true;
 	}
 
@@ -176,477 +300,3144 @@ bool ADungeonGenerator_GridBased::ConnectRoomsInOrder()
 	return false; // Failed to connect rooms
 }
 
-// This return an array without nullptr actors
-// The pair does not contains same actor
-bool ADungeonGenerator_GridBased::AddCorridorConnectingRooms(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom)
+bool ADungeonGenerator_GridBased::AddRoom(ACityGen_RoomBase* Room)
 {
-	check (FromRoom != ToRoom);
+	if (!AddRoomToConnect(Room))
+	{
+		return false;
+	}
+	return ReplanCorridors({ Room });
+}
 
-#if !WITH_SORTED_EXIT_ARROW
-	TArray<FExitArrowData>& FromExitPoints = FromRoom->GetCachedExitPointsDataRef();
-	TArray<FExitArrowData>& ToExitPoints = ToRoom->GetCachedExitPointsDataRef();
-	if ((FromExitPoints.Num() == 0) || (ToExitPoints.Num() == 0))
+bool ADungeonGenerator_GridBased::RemoveRoom(ACityGen_RoomBase* Room)
+{
+	if (!RemoveRoomToConnect(Room))
 	{
 		return false;
 	}
+	Room->CloseAllDoors();
+	return ReplanCorridors({ Room });
+}
 
-	bool bFoundExactMatchingDoors = false;
-	FExitArrowData* FromExitWithMinDistance = nullptr;
-	FExitArrowData* ToExitWithMinDistance = nullptr;
+bool ADungeonGenerator_GridBased::MoveRoom(ACityGen_RoomBase* Room, const FTransform& NewTransform)
+{
+	if (Room == nullptr)
+	{
+		return false;
+	}
+	Room->SetActorTransform(NewTransform);
+	return ReplanCorridors({ Room });
+}
 
-	// Special case: if the "FromRoom" and "ToRoom" both have a door matching and touching
-	for (auto& FromExit : FromExitPoints)
+bool ADungeonGenerator_GridBased::ReplanCorridors(const TArray<ACityGen_RoomBase*>& EditedRooms)
+{
+	// The queue of a deferred spawn is stale once the plan changes, its cells without actor are spawned with the diff below
+	const bool bWasSpawningCorridors = !AreCorridorsMaterialized();
+	CancelSpawnCorridors();
+
+	const bool bHasPlan = (PairRecords.Num() > 0) || (AllSpawnedCorridors.Num() > 0);
+	if (!bHasPlan || (ConnectionMode == ECorridorConnectionMode::SharedNetwork))
 	{
-		for (auto& ToExit : ToExitPoints)
-		{
-			// Need to test both way as the door maybe on a corner pointing to a different direction
-			if((FromExit.DungeonGridCoord.position == ToExit.DungeonDoorGridCoord) &&
-				(FromExit.DungeonDoorGridCoord == ToExit.DungeonGridCoord.position))
-			{
-				bFoundExactMatchingDoors = true;
-				FromExitWithMinDistance = &FromExit;
-				ToExitWithMinDistance = &ToExit;
-				break;
-			}
-		}
-		if(bFoundExactMatchingDoors)
-		{
-			break;
-		}
+		// A room joins the network through corridors of other rooms, the records do not tell which ones
+		ClearCorridorMeshes();
+		return ConnectRoomsInOrder();
 	}
 
-	// In that case no need to run pathfinding
-	if(bFoundExactMatchingDoors)
+	AllRooms = GetAllRoomsArray();
+	for (ACityGen_RoomBase* Room : EditedRooms)
 	{
-		// Marks the exit as used (useful to open doors)
-		FromExitWithMinDistance->bIsUsed = true;
-		ToExitWithMinDistance->bIsUsed = true;
-		return true;
+		if (AllRooms.Contains(Room))
+		{
+			Room->SnapRoomToGrid(DungeonGridCmpt);
+			Room->UpdateGridCoordCaches(DungeonGridCmpt);
+		}
 	}
+	UpdateDungeonGridBounds();
 
-	float MinDistance = FLT_MAX;
-	for(auto& FromExit : FromExitPoints)
+	// The hierarchical planner is built without corridors, the kept ones are added once known
+	const FCityGen_CorridorCellStore OldCorridors = MoveTemp(RequestedCorridors);
+	RequestedCorridors.Empty();
+	PlanCorridors_BlockTiles();
+
+	// A record is kept if its pair is still to connect, none of its rooms was edited and all its cells are still free
+	TMultiMap<TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>, int32> ValidRecordIndices;
+	for (int32 RecordIndex = 0; RecordIndex < PairRecords.Num(); ++RecordIndex)
 	{
-		// Skip exit blocked
-		if (IsGridTileBlocked(FromExit.DungeonGridCoord.position))
+		const FCorridorPairRecord& Record = PairRecords[RecordIndex];
+		if (EditedRooms.Contains(Record.FromRoom) || EditedRooms.Contains(Record.ToRoom))
 		{
 			continue;
 		}
 
-		for (auto& ToExit : ToExitPoints)
+		const bool bCrossesChangedCell = Record.Links.ContainsByPredicate([this](const FCorridorPairRecord::FLink& Link)
 		{
-			// Skip exit blocked
-			if(IsGridTileBlocked(ToExit.DungeonGridCoord.position))
-			{
-				continue;
-			}
-
-			float currentDistance = GetDistance(FromExit.DungeonGridCoord.position, ToExit.DungeonGridCoord.position);
-
-			if(currentDistance < MinDistance)
-			{
-				MinDistance = currentDistance;
-				FromExitWithMinDistance = &FromExit;
-				ToExitWithMinDistance = &ToExit;
-			}
+			return IsCellClosedToCorridors(Link.Coord);
+		});
+		if (!bCrossesChangedCell)
+		{
+			ValidRecordIndices.Add(TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>(Record.FromRoom, Record.ToRoom), RecordIndex);
 		}
 	}
 
-	if((FromExitWithMinDistance == nullptr) || (ToExitWithMinDistance == nullptr))
+	TArray<FCorridorPairRecord> KeptRecords;
+	TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>> PairsToSearch;
+	for (const TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>& RoomToConnect : PendingRoomsToConnect)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Failed to find a door combinaison for the room, maybe one room have all its exit blocked?"));
-		return false;
+		const int32* pRecordIndex = ValidRecordIndices.Find(RoomToConnect);
+		if (pRecordIndex != nullptr)
+		{
+			const int32 RecordIndex = *pRecordIndex;
+			ValidRecordIndices.RemoveSingle(RoomToConnect, RecordIndex);
+			KeptRecords.Add(MoveTemp(PairRecords[RecordIndex]));
+		}
+		else
+		{
+			PairsToSearch.Add(RoomToConnect);
+		}
 	}
+	PairRecords = MoveTemp(KeptRecords);
 
-	bool bFindPathBetweenRooms = FindPath(FromExitWithMinDistance->DungeonGridCoord.position, FromExitWithMinDistance->DungeonDoorGridCoord, ToExitWithMinDistance->DungeonGridCoord.position, ToExitWithMinDistance->DungeonDoorGridCoord);
-	if (bFindPathBetweenRooms == false)
+	// Put back the connections and used exits of the kept pairs
+	for (ACityGen_RoomBase* Room : AllRooms)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Failed to find a path within the recursive loop hard coded limit for this exit pair, move to next."));
-		return false;
+		Room->CloseAllDoors();
 	}
-	else
+	TArray<FSG_GridCoordinate> KeptCells;
+	for (const FCorridorPairRecord& Record : PairRecords)
 	{
-		// Marks the exit as used (useful to open doors)
-		FromExitWithMinDistance->bIsUsed = true;
-		ToExitWithMinDistance->bIsUsed = true;
-		return true;
+		for (const FCorridorPairRecord::FLink& Link : Record.Links)
+		{
+			RequestedCorridors.FindOrAdd(Link.Coord).MakeConnection(Link.Coord, Link.OtherCoord, Link.bIsARoom);
+		}
+		for (const FSG_GridCoordinate& ExitCoord : Record.UsedExitCoords)
+		{
+			for (ACityGen_RoomBase* Room : { Record.FromRoom, Record.ToRoom })
+			{
+				FExitArrowData* pExit = Room->GetCachedExitPointsDataRef().FindByPredicate([&ExitCoord](const FExitArrowData& Exit) { return Exit.DungeonGridCoord.position == ExitCoord; });
+				if (pExit != nullptr)
+				{
+					pExit->bIsUsed = true;
+				}
+			}
+		}
 	}
-#else
-	FSG_GridCoordinate FromSnappedLocationGS = FromRoom->GetRoomGridCoord().position;
-	FSG_GridCoordinate ToSnappedLocationGS = ToRoom->GetRoomGridCoord().position;
-
-	TArray<FExitArrowData*> SortedExits_FromRoom;
-	bool bGetExitFromRoom = GetSortedExitArrows(FromRoom, ToSnappedLocationGS, SortedExits_FromRoom);
-	if (bGetExitFromRoom == false)
+	if (HierarchicalPlanner.IsBuilt())
 	{
-		return false;
+		RequestedCorridors.GetKeys(KeptCells);
+		HierarchicalPlanner.OnCorridorCellsAdded(KeptCells);
 	}
-	TArray<FExitArrowData*> SortedExits_ToRoom;
-	bool bGetExitToRoom = GetSortedExitArrows(ToRoom, FromSnappedLocationGS, SortedExits_ToRoom);
-	if (bGetExitToRoom == false)
+
+	const int32 NumKeptPairs = PairRecords.Num();
+	PendingRoomsToConnect = MoveTemp(PairsToSearch);
+	PlanCorridors_StepPairs(TNumericLimits<double>::Max());
+	const int32 NumSearchedPairs = PendingRoomsToConnect.Num();
+	const bool bConnectedAllRooms = PlanCorridors_Finish();
+
+	if (CorridorOutputMode == ECorridorOutputMode::InstancedMeshes)
 	{
-		return false;
+		// Instances are cheap to add, and a HISM moves its last instance when one is removed
+		ClearCorridorInstances();
+		SpawnCorridors();
+		FinishSpawnCorridors();
+
+		UE_LOG(LogCityGen, Log, TEXT("Incremental corridor re-plan: %d pairs kept, %d pairs searched, %d corridor instances"),
+			NumKeptPairs, NumSearchedPairs, GetNumCorridorInstances());
+		return bConnectedAllRooms;
 	}
 
-	// Loop through SortedExits_FromRoom and SortedExits_ToRoom to find the best exit pair
-	bool bFindPathBetweenRooms = false;
-	for (int32 j = 0; j < SortedExits_FromRoom.Num(); ++j)
+	// Only the cells whose connections changed get a new actor, and the ones the cancelled spawn did not reach yet
+	int32 NumDestroyedCorridors = 0;
+	OldCorridors.ForEach([&](const FSG_GridCoordinate& Coord, const FCellConnectionState& OldConnection)
 	{
-		FExitArrowData* pFromExit = SortedExits_FromRoom[j];
-		if (!pFromExit->ArrowCmpt)
+		const FCellConnectionState* pNewConnection = RequestedCorridors.Find(Coord);
+		if ((pNewConnection != nullptr) && (*pNewConnection == OldConnection))
 		{
-			continue;
+			return;
 		}
-		FSG_GridCoordinate FromDoorCoordinate = pFromExit->DungeonDoorGridCoord;
 
-		// TODO : Maybe we could have a first selection of exit<>exit to: 1) remove invalid 2) select the one with closest manhatan distance
-		for (int32 k = 0; k < SortedExits_ToRoom.Num(); ++k)
+		ACityGen_RoomBase* pCorridorActor = nullptr;
+		if (AllSpawnedCorridors.RemoveAndCopyValue(Coord, pCorridorActor) && (pCorridorActor != nullptr))
 		{
-			FExitArrowData* pToExit = SortedExits_ToRoom[k];
-			if (!pToExit->ArrowCmpt)
-			{
-				continue;
-			}
-			FSG_GridCoordinate ToDoorCoordinate = pToExit->DungeonDoorGridCoord;
-
-			TilesToIgnore.Add(FromSnappedLocationGS);
-			TilesToIgnore.Add(ToSnappedLocationGS);
-			UpdateBlockedTiles_TilesToIgnore();
-
-#if 0
-			// Optional: Visualize blocked tiles
-			for (const FSG_GridCoordinate& Tile : BlockedGridTiles)
-			{
-				FVector Location = DungeonGridCmpt->GridToWorld(Tile) + TileSize / 2.0; // Centered
-				UKismetSystemLibrary::DrawDebugBox(this, Location, TileSize / 2.0, FLinearColor::Black, FRotator::ZeroRotator, 10.f);
-			}
-#endif
-
-			bFindPathBetweenRooms = FindPath(pFromExit->DungeonGridCoord.position, FromDoorCoordinate, pToExit->DungeonGridCoord.position, ToDoorCoordinate);
-			if (bFindPathBetweenRooms == false)
-			{
-				UE_LOG(LogTemp, Warning, TEXT("Failed to find a path within the recursive loop hard coded limit for this exit pair, move to next."));
-			}
-			else
-			{
-				// Marks the exit as used (useful to open doors)
-				pFromExit->bIsUsed = true;
-				pToExit->bIsUsed = true;
-				break; // path found
-			}
+			CorridorActorPool->ReleaseActor(pCorridorActor);
+			NumDestroyedCorridors++;
 		}
-		if (bFindPathBetweenRooms)
+	});
+
+	int32 NumSpawnedCorridors = 0;
+	RequestedCorridors.ForEach([&](const FSG_GridCoordinate& Coord, const FCellConnectionState& NewConnection)
+	{
+		const FCellConnectionState* pOldConnection = OldCorridors.Find(Coord);
+		const bool bHasActor = !bWasSpawningCorridors || AllSpawnedCorridors.Contains(Coord);
+		if ((pOldConnection != nullptr) && (*pOldConnection == NewConnection) && bHasActor)
 		{
-			return true;
+			return;
 		}
-	}
-	UE_LOG(LogCityGen, Error, TEXT("No path found"));
-	return false;
-#endif
-}
 
-#if WITH_SORTED_EXIT_ARROW
+		SpawnCorridorAt(Coord);
+		NumSpawnedCorridors++;
+	});
 
-// SORTING EXITS BASED ON CLOSEST TO FURTHEST from given location
-bool ADungeonGenerator_GridBased::GetSortedExitArrows(ACityGen_RoomBase* FromRoom, const FSG_GridCoordinate& ToLocationGS, TArray<FExitArrowData*>& OutSortedExitData) const
+	FinishSpawnCorridors();
+
+	UE_LOG(LogCityGen, Log, TEXT("Incremental corridor re-plan: %d pairs kept, %d pairs searched, %d corridor actors destroyed, %d spawned"),
+		NumKeptPairs, NumSearchedPairs, NumDestroyedCorridors, NumSpawnedCorridors);
+	return bConnectedAllRooms;
+}
+
+void ADungeonGenerator_GridBased::BeginPairRecord(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom)
 {
-	TMap<float, FExitArrowData*> DistanceMap; // Use int32 for distance keys
+	check(ActivePairRecordIndex == INDEX_NONE);
+	ActivePairRecordIndex = PairRecords.AddDefaulted();
+	PairRecords[ActivePairRecordIndex].FromRoom = FromRoom;
+	PairRecords[ActivePairRecordIndex].ToRoom = ToRoom;
+}
 
-	if (!FromRoom)
+void ADungeonGenerator_GridBased::EndPairRecord(bool bConnected)
+{
+	check(ActivePairRecordIndex == PairRecords.Num() - 1);
+	if (!bConnected)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("GetSortedExitArrows: Null room pointers"));
-		return false;
+		PairRecords.RemoveAt(ActivePairRecordIndex, EAllowShrinking::No);
 	}
+	ActivePairRecordIndex = INDEX_NONE;
+}
 
-	// Loop over all exit points on FromRoom
-	TArray<FExitArrowData>& FromRoomExitPoints = FromRoom->GetCachedExitPointsDataRef();
-	for (FExitArrowData& ExitData : FromRoomExitPoints)
+void ADungeonGenerator_GridBased::AddCorridorConnection(const FSG_GridCoordinate& Coord, const FSG_GridCoordinate& OtherCoord, bool bIsARoom)
+{
+	RequestedCorridors.FindOrAdd(Coord).MakeConnection(Coord, OtherCoord, bIsARoom);
+	if (ActivePairRecordIndex != INDEX_NONE)
 	{
-		// Calculate local grid distance directly using GridCoords (no world conversions)
-		float Distance = GetDistance(ExitData.DungeonGridCoord.position, ToLocationGS);
-
-		// Use Distance as the key for sorting
-		// To handle potential duplicates, add a small offset (like index) or use TMultiMap if necessary
-		while (DistanceMap.Contains(Distance))
-		{
-			Distance++;
-		}
-
-		DistanceMap.Add(Distance, &ExitData);
+		PairRecords[ActivePairRecordIndex].Links.Add({ Coord, OtherCoord, bIsARoom });
 	}
-
-	// Sort by distance ascending
-	DistanceMap.KeySort(TLess<float>());
-
-	// Copy to output array in sorted order
-	for (auto& Pair : DistanceMap)
+	if (PathCacheCapture != nullptr)
 	{
-		OutSortedExitData.Add(Pair.Value);
+		PathCacheCapture->Add({ Coord, OtherCoord, bIsARoom });
 	}
-
-	return true;
 }
-#endif // WITH_SORTED_EXIT_ARROW
 
-#if WITH_EDITOR
-void ADungeonGenerator_GridBased::SnapRoomsToGridEd()
+void ADungeonGenerator_GridBased::MarkExitsUsed(FExitArrowData* FromExit, FExitArrowData* ToExit)
 {
-	TArray<ACityGen_RoomBase*> Rooms = GetAllRoomsArray(); // Need to call this function as 'AllRooms' may not be set yet if we wll from editor button
-	for (ACityGen_RoomBase* Room : Rooms)
+	for (FExitArrowData* pExit : { FromExit, ToExit })
 	{
-		check(Room);
-		Room->SnapRoomToGrid(DungeonGridCmpt);
-		Room->UpdateGridCoordCaches(DungeonGridCmpt);
+		if (pExit == nullptr)
+		{
+			continue;
+		}
+
+		pExit->bIsUsed = true;
+		if (ActivePairRecordIndex != INDEX_NONE)
+		{
+			PairRecords[ActivePairRecordIndex].UsedExitCoords.Add(pExit->DungeonGridCoord.position);
+		}
 	}
 }
-#endif // WITH_EDITOR
 
-void ADungeonGenerator_GridBased::SnapRoomsToGrid()
+bool ADungeonGenerator_GridBased::PlanCorridors()
 {
-	for (ACityGen_RoomBase* Room : AllRooms)
+	if (!PlanCorridors_SnapRooms())
 	{
-		Room->SnapRoomToGrid(DungeonGridCmpt);
-		Room->UpdateGridCoordCaches(DungeonGridCmpt);
+		return false;
 	}
+	PlanCorridors_BlockTiles();
+	PlanCorridors_StepPairs(TNumericLimits<double>::Max());
+	return PlanCorridors_Finish();
 }
 
-#if WITH_EDITOR
-void ADungeonGenerator_GridBased::DebugDrawRoomsCachedData()
+bool ADungeonGenerator_GridBased::PlanCorridors_SnapRooms()
 {
-	TArray<ACityGen_RoomBase*> Rooms = GetAllRoomsArray(); // Need to call this function as 'AllRooms' may not be set yet if we wll from editor button
-	for (ACityGen_RoomBase* Room : Rooms)
+	AllRooms = GetAllRoomsArray();
+
+	if (AllRooms.Num() < 2)
 	{
-		check(Room);
-		Room->DebugDrawRoomCachedData(DungeonGridCmpt);
+		UE_LOG(LogCityGen, Warning, TEXT("Not enough rooms to connect."));
+		return false;
+	}
+	if((AllSpawnedCorridors.Num() > 0) || (GetNumCorridorInstances() > 0))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("There is still corridors left from previous generation, clearing them."));
+		ClearCorridorMeshes();
 	}
+
+	check(TilesToIgnore.Num() == 0);
+	check(AllSpawnedCorridors.Num() == 0);
+	check(RequestedCorridors.Num() == 0);
+	PairRecords.Reset();
+
+	//UpdateBlockedTiles_Obstacles();
+	SnapRoomsToGrid();
+	UpdateDungeonGridBounds();
+	return true;
 }
-#endif // WITH_EDITOR
 
-#if 0
-void ADungeonGenerator_GridBased::UpdateBlockedTiles_Obstacles()
+void ADungeonGenerator_GridBased::PlanCorridors_BlockTiles()
 {
-	for (AActor* Obstacle : Obstacles)
-	{
-		if (Obstacle == nullptr)
-		{
-			continue;
-		}
+	// Clear previously setup blocked gridTiles
+	BlockedGridTiles.Init(DungeonGridBounds.Min, DungeonGridBounds.GetSize());
+	RequestedCorridors.SetBounds(DungeonGridBounds.Min, DungeonGridBounds.GetSize());
 
-		ACityGen_ObstacleBase* ObstacleBase = Cast<ACityGen_ObstacleBase>(Obstacle);
-		if (!ObstacleBase)
-		{
-			continue;
-		}
+	UpdateBlockedTiles_RoomBounds();
+	UpdateBlockedTiles_ClosedExits();
+	UpdateBlockedTiles_TilesToIgnore();
 
-		// Get world grid coords directly
-		TArray<FSG_GridCoordinate> WorldAffectedTiles =
-			ObstacleBase->GetWorldTilesOverlappingBounds(ObstacleBase->GetObstacleBounds(), 1.0f);
+	// A hashed set element is the coordinate plus the hash next index and hash index (see TSetElement)
+	const int32 NumBlockedTiles = BlockedGridTiles.CountSetBits();
+	UE_LOG(LogCityGen, Log, TEXT("Blocked tiles: %d, bit volume %llu bytes (hashed set would be about %llu bytes)"),
+		NumBlockedTiles,
+		(uint64)BlockedGridTiles.GetAllocatedSize(),
+		(uint64)NumBlockedTiles * (sizeof(FSG_GridCoordinate) + 2 * sizeof(int32)));
 
-		for (const FSG_GridCoordinate& Tile : WorldAffectedTiles)
+	LastSearchStats = FCorridorSearchStats();
+
+	HierarchicalPlanner.Reset();
+	if (CorridorSearchAlgorithm == ECorridorSearchAlgorithm::Hierarchical)
+	{
+		// Built before the first search as the blocked tiles do not change after that, counted in the search time
+		const double StartTime = FPlatformTime::Seconds();
+		HierarchicalPlanner.Build(DungeonGridBounds, HierarchicalChunkSize, BlockedGridTiles, RequestedCorridors, DistanceFactorForZ);
+		LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		UE_LOG(LogCityGen, Log, TEXT("Hierarchical planner: %d chunks, %d abstract nodes"), HierarchicalPlanner.GetNumChunks(), HierarchicalPlanner.GetNumNodes());
+	}
+
+	NetworkRooms.Reset();
+	if (ConnectionMode == ECorridorConnectionMode::SharedNetwork)
+	{
+		PendingRoomsToConnect = GetNetworkRoomsToConnectArray();
+		if (PendingRoomsToConnect.Num() > 0)
 		{
-			BlockedGridTiles.Add(Tile); // Already in world coords
+			NetworkRooms.Add(PendingRoomsToConnect[0].Value); // Root of the tree
 		}
 	}
+	else
+	{
+		PendingRoomsToConnect = GetRoomsToConnectArray();
+	}
+	NextPairIndex = 0;
+	bAllPendingPairsConnected = true;
+	bHasPausedSearch = false;
+	ActivePairRecordIndex = INDEX_NONE;
 }
-#endif
 
-void ADungeonGenerator_GridBased::UpdateBlockedTiles_ClosedExits()
+bool ADungeonGenerator_GridBased::PlanCorridors_StepPairs(double DeadlineSeconds)
 {
-	if(bUseBlockedExit == false)
+#if !WITH_SORTED_EXIT_ARROW
+	ACityGen_RoomBase* FlowFieldHub = (ConnectionMode == ECorridorConnectionMode::RoomPairs) ? GetFlowFieldHub() : nullptr;
+	if ((FlowFieldHub != nullptr) && !PendingRoomsToConnect.ContainsByPredicate([FlowFieldHub](const TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>& RoomToConnect) { return RoomToConnect.Key != FlowFieldHub; }))
 	{
-		return;
+		// The flow field is not time sliced
+		if (NextPairIndex < PendingRoomsToConnect.Num())
+		{
+			bAllPendingPairsConnected &= ConnectHubPairsWithFlowField(FlowFieldHub, PendingRoomsToConnect);
+			NextPairIndex = PendingRoomsToConnect.Num();
+		}
+		return true;
 	}
 
-	for (ACityGen_RoomBase* Room : AllRooms)
+	if (bUseParallelCorridorSearch && !bUseMultiExitSearch && (ConnectionMode == ECorridorConnectionMode::RoomPairs) && (CorridorSearchAlgorithm == ECorridorSearchAlgorithm::BinaryHeap) && bUseDenseSearchStorage)
 	{
-		const TArray<FExitArrowData>& CachedBlockedExitPoints = Room->GetCachedBlockedExitPointsData();
-		for (const FExitArrowData& BlockedExitData : CachedBlockedExitPoints)
+		// One batch per iteration, a batch can not be paused
+		const int32 BatchSize = GetParallelSearchBatchSize();
+		while (NextPairIndex < PendingRoomsToConnect.Num())
 		{
-			BlockedGridTiles.Add(BlockedExitData.DungeonGridCoord.position);
+			if (FPlatformTime::Seconds() >= DeadlineSeconds)
+			{
+				return false;
+			}
+
+			const int32 NumPairs = FMath::Min(BatchSize, PendingRoomsToConnect.Num() - NextPairIndex);
+			bAllPendingPairsConnected &= ConnectRoomPairsInParallel(MakeArrayView(PendingRoomsToConnect).Slice(NextPairIndex, NumPairs));
+			NextPairIndex += NumPairs;
 		}
+		return true;
 	}
-}
+#endif // !WITH_SORTED_EXIT_ARROW
 
-void ADungeonGenerator_GridBased::UpdateBlockedTiles_RoomBounds()
-{
-	for (ACityGen_RoomBase* RoomBase : AllRooms)
+	while (NextPairIndex < PendingRoomsToConnect.Num())
 	{
-		if (RoomBase == nullptr)
+		if (FPlatformTime::Seconds() >= DeadlineSeconds)
 		{
-			continue;
+			return false;
 		}
 
-		TArray<FSG_GridCoordinate> AffectedTiles = RoomBase->BuildListOfOverlappingCoordsFromBounds();
-		for(const auto& affectTile : AffectedTiles)
+		const TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>& RoomToConnect = PendingRoomsToConnect[NextPairIndex];
+		if (!bHasPausedSearch)
+		{
+			BeginPairRecord(RoomToConnect.Key, RoomToConnect.Value);
+		}
+#if !WITH_SORTED_EXIT_ARROW
+		// Only the dense search can be paused in the middle, the other algorithms run a pair entirely
+		if ((CorridorSearchAlgorithm == ECorridorSearchAlgorithm::BinaryHeap) && bUseDenseSearchStorage && (ConnectionMode == ECorridorConnectionMode::RoomPairs))
 		{
-			BlockedGridTiles.Add(affectTile);
+			bool bConnected = false;
+			if (!AddCorridorConnectingRooms_Resumable(RoomToConnect.Key, RoomToConnect.Value, DeadlineSeconds, bConnected))
+			{
+				return false; // Search paused, resumed by the next call
+			}
+			EndPairRecord(bConnected);
+			bAllPendingPairsConnected &= bConnected;
+			NextPairIndex++;
+			continue;
 		}
+#endif // !WITH_SORTED_EXIT_ARROW
+
+		const bool bConnected = AddCorridorConnectingRooms(RoomToConnect.Key, RoomToConnect.Value);
+		EndPairRecord(bConnected);
+		bAllPendingPairsConnected &= bConnected;
+		NextPairIndex++;
 	}
+	return true;
 }
 
-void ADungeonGenerator_GridBased::UpdateBlockedTiles_TilesToIgnore()
+bool ADungeonGenerator_GridBased::PlanCorridors_Finish()
 {
-	for (FSG_GridCoordinate Tiles : TilesToIgnore)
+	LastSearchStats.NumCorridorCells = RequestedCorridors.Num();
+
+	UE_LOG(LogCityGen, Log, TEXT("Corridor search (%s, %s): %d corridor cells, %d searches, %d failed, %d expansions, %d workspace allocations, %.3f ms"),
+		*UEnum::GetValueAsString(CorridorSearchAlgorithm),
+		*UEnum::GetValueAsString(ConnectionMode),
+		LastSearchStats.NumCorridorCells,
+		LastSearchStats.NumSearches,
+		LastSearchStats.NumFailedSearches,
+		LastSearchStats.NumExpansions,
+		LastSearchStats.NumAllocations,
+		LastSearchStats.SearchTimeMs);
+	UE_LOG(LogCityGen, Log, TEXT("Corridor cells store: %llu bytes"), (uint64)RequestedCorridors.GetAllocatedSize());
+	if (HierarchicalPlanner.IsBuilt())
+	{
+		UE_LOG(LogCityGen, Log, TEXT("Hierarchical planner: %d chunk updates"), HierarchicalPlanner.NumChunkUpdates);
+	}
+	if (bUsePathCache)
+	{
+		UE_LOG(LogCityGen, Log, TEXT("Path cache: %d hits, %d misses, %d paths cached"), LastSearchStats.NumPathCacheHits, LastSearchStats.NumPathCacheMisses, PathCache.Num());
+	}
+	if (LastSearchStats.NumBoundedPaths > 0)
+	{
+		UE_LOG(LogCityGen, Log, TEXT("Dense paths (weight %.2f%s): suboptimality bound %.3f max, %.3f average over %d paths, %d anytime restarts, %d improvements"),
+			HeuristicWeight,
+			bUseAnytimeSearch ? TEXT(", anytime") : TEXT(""),
+			LastSearchStats.MaxSuboptimalityBound,
+			LastSearchStats.AverageSuboptimalityBound,
+			LastSearchStats.NumBoundedPaths,
+			LastSearchStats.NumAnytimeRestarts,
+			LastSearchStats.NumAnytimeImprovements);
+	}
+
+	PlannedRoomTransforms.Reset();
+	for (ACityGen_RoomBase* Room : AllRooms)
 	{
-		BlockedGridTiles.Remove(Tiles);
+		PlannedRoomTransforms.Add(Room, Room->GetActorTransform());
 	}
+
+	PendingRoomsToConnect.Empty();
+	return bAllPendingPairsConnected;
 }
 
-// @param OutVector: Return location in world space of the first gridCoord of the path
-// @return: false if failed to find a path within the recursive loop hard coded limit
-bool ADungeonGenerator_GridBased::FindPath(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords)
+float ADungeonGenerator_GridBased::GetPlanCorridorsProgress() const
 {
-	TMap<FSG_GridCoordinate, FCityGen_NodeCoord> OpenNodesMap;
-	TMap<FSG_GridCoordinate, FCityGen_NodeCoord> ClosedNodesMap;
-	TArray<FSG_GridCoordinate> OpenSet;
-	TArray<FSG_GridCoordinate> ClosedSet;
+	return (PendingRoomsToConnect.Num() > 0) ? (float)NextPairIndex / (float)PendingRoomsToConnect.Num() : 1.0f;
+}
 
-	FCityGen_NodeCoord StartNode;
+// This return an array without nullptr actors
+// The pair does not contains same actor
+bool ADungeonGenerator_GridBased::AddCorridorConnectingRooms(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom)
+{
+	check (FromRoom != ToRoom);
 
-	StartNode.GCost = 0;
-	StartNode.HCost = 0;
-	StartNode.NodeCoordinate = StartDoorGridCoords;
-	StartNode.bHaveParent = false;
-	StartNode.ParentCoordinate = StartDoorGridCoords;
+#if !WITH_SORTED_EXIT_ARROW
+	if (ConnectionMode == ECorridorConnectionMode::SharedNetwork)
+	{
+		return AddCorridorConnectingRoomToNetwork(FromRoom, ToRoom);
+	}
 
-	FCityGen_NodeCoord EndNode;
+	FExitArrowData* FromExitWithMinDistance = nullptr;
+	FExitArrowData* ToExitWithMinDistance = nullptr;
+	bool bNeedPath = true;
+	if (!SelectExitsToConnect(FromRoom, ToRoom, FromExitWithMinDistance, ToExitWithMinDistance, bNeedPath))
+	{
+		return false;
+	}
 
-	EndNode.NodeCoordinate = EndDoorGridCoords;
-	EndNode.bHaveParent = false;
-	EndNode.ParentCoordinate = EndDoorGridCoords;
+	// If the doors are touching no need to run pathfinding
+	if (bNeedPath && bUseMultiExitSearch)
+	{
+		// The selected pair is only used to know that both rooms have an unblocked exit, the search picks the exits
+		if (!FindPath_MultiExit(FromRoom, ToRoom, FromExitWithMinDistance, ToExitWithMinDistance))
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("Failed to find a path between any exits of the rooms, move to next."));
+			return false;
+		}
+	}
+	else if (bNeedPath)
+	{
+		bool bFindPathBetweenRooms = FindPath(FromExitWithMinDistance->DungeonGridCoord.position, FromExitWithMinDistance->DungeonDoorGridCoord, ToExitWithMinDistance->DungeonGridCoord.position, ToExitWithMinDistance->DungeonDoorGridCoord);
+		if (bFindPathBetweenRooms == false)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to find a path within the recursive loop hard coded limit for this exit pair, move to next."));
+			return false;
+		}
+	}
 
-	OpenSet.Add(StartDoorGridCoords); // Add Start node to Open set
-	OpenNodesMap.Add(StartDoorGridCoords, StartNode);
+	MarkExitsUsed(FromExitWithMinDistance, ToExitWithMinDistance);
+	return true;
+#else
+	FSG_GridCoordinate FromSnappedLocationGS = FromRoom->GetRoomGridCoord().position;
+	FSG_GridCoordinate ToSnappedLocationGS = ToRoom->GetRoomGridCoord().position;
 
-	int32 numIterations = 0;
-	const int32 maxIterations = 800; // To avoid infinite loop in case of setting mistake
-	while (OpenSet.Num() && numIterations <= maxIterations)
+	TArray<FExitArrowData*> SortedExits_FromRoom;
+	bool bGetExitFromRoom = GetSortedExitArrows(FromRoom, ToSnappedLocationGS, SortedExits_FromRoom);
+	if (bGetExitFromRoom == false)
 	{
-		numIterations = numIterations + 1;
-		if (numIterations > maxIterations)
+		return false;
+	}
+	TArray<FExitArrowData*> SortedExits_ToRoom;
+	bool bGetExitToRoom = GetSortedExitArrows(ToRoom, FromSnappedLocationGS, SortedExits_ToRoom);
+	if (bGetExitToRoom == false)
+	{
+		return false;
+	}
+
+	// Loop through SortedExits_FromRoom and SortedExits_ToRoom to find the best exit pair
+	bool bFindPathBetweenRooms = false;
+	for (int32 j = 0; j < SortedExits_FromRoom.Num(); ++j)
+	{
+		FExitArrowData* pFromExit = SortedExits_FromRoom[j];
+		if (!pFromExit->ArrowCmpt)
 		{
-			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
-			return false;
+			continue;
 		}
-		
-		FSG_GridCoordinate CurrentCoords = OpenSet[0];
-		FCityGen_NodeCoord CurrentNode = OpenNodesMap[CurrentCoords];
+		FSG_GridCoordinate FromDoorCoordinate = pFromExit->DungeonDoorGridCoord;
 
-		for (int32 i = 0; i < OpenSet.Num(); i++) // Find node with lowest fCost in Open set
+		// TODO : Maybe we could have a first selection of exit<>exit to: 1) remove invalid 2) select the one with closest manhatan distance
+		for (int32 k = 0; k < SortedExits_ToRoom.Num(); ++k)
 		{
-			// check distance logic
-			if (OpenNodesMap[OpenSet[i]].ComputeFCost() <= OpenNodesMap[CurrentCoords].ComputeFCost())
+			FExitArrowData* pToExit = SortedExits_ToRoom[k];
+			if (!pToExit->ArrowCmpt)
 			{
-				CurrentCoords = OpenSet[i];
-				CurrentNode = OpenNodesMap[CurrentCoords];
+				continue;
 			}
-		}
+			FSG_GridCoordinate ToDoorCoordinate = pToExit->DungeonDoorGridCoord;
 
-		// Move node from Open set to Closed set
-		OpenSet.Remove(CurrentCoords);
-		OpenNodesMap.Remove(CurrentCoords);
-		ClosedSet.Add(CurrentCoords);
-		ClosedNodesMap.Add(CurrentCoords, CurrentNode);
+			TilesToIgnore.Add(FromSnappedLocationGS);
+			TilesToIgnore.Add(ToSnappedLocationGS);
+			UpdateBlockedTiles_TilesToIgnore();
 
-		#if 0
-			// DEBUG
-			UE_LOG(LogCityGen, Log, TEXT("OpenSet Size: %d"), OpenSet.Num());
-			
-			UKismetSystemLibrary::DrawDebugBox(
-				this,
-				DungeonGridCmpt->GridToWorld(StartDoorGridCoords) + TileSize / 2.0,
-				TileSize / 2.0,
-				FLinearColor::Red,
-				FRotator::ZeroRotator,
-				10.1f
-			);
+#if 0
+			// Optional: Visualize blocked tiles
+			for (const FSG_GridCoordinate& Tile : BlockedGridTiles)
+			{
+				FVector Location = DungeonGridCmpt->GridToWorld(Tile) + TileSize / 2.0; // Centered
+				UKismetSystemLibrary::DrawDebugBox(this, Location, TileSize / 2.0, FLinearColor::Black, FRotator::ZeroRotator, 10.f);
+			}
+#endif
 
-			UKismetSystemLibrary::DrawDebugBox(
-				this,
-				DungeonGridCmpt->GridToWorld(EndDoorGridCoords) + TileSize / 2.0,
-				TileSize / 2.0,
+			bFindPathBetweenRooms = FindPath(pFromExit->DungeonGridCoord.position, FromDoorCoordinate, pToExit->DungeonGridCoord.position, ToDoorCoordinate);
+			if (bFindPathBetweenRooms == false)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Failed to find a path within the recursive loop hard coded limit for this exit pair, move to next."));
+			}
+			else
+			{
+				// Marks the exit as used (useful to open doors)
+				pFromExit->bIsUsed = true;
+				pToExit->bIsUsed = true;
+				break; // path found
+			}
+		}
+		if (bFindPathBetweenRooms)
+		{
+			return true;
+		}
+	}
+	UE_LOG(LogCityGen, Error, TEXT("No path found"));
+	return false;
+#endif
+}
+
+#if !WITH_SORTED_EXIT_ARROW
+bool ADungeonGenerator_GridBased::SelectExitsToConnect(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit, bool& bOutNeedPath) const
+{
+	TArray<FExitArrowData>& FromExitPoints = FromRoom->GetCachedExitPointsDataRef();
+	TArray<FExitArrowData>& ToExitPoints = ToRoom->GetCachedExitPointsDataRef();
+	if ((FromExitPoints.Num() == 0) || (ToExitPoints.Num() == 0))
+	{
+		return false;
+	}
+
+	// Special case: if the "FromRoom" and "ToRoom" both have a door matching and touching
+	for (auto& FromExit : FromExitPoints)
+	{
+		for (auto& ToExit : ToExitPoints)
+		{
+			// Need to test both way as the door maybe on a corner pointing to a different direction
+			if((FromExit.DungeonGridCoord.position == ToExit.DungeonDoorGridCoord) &&
+				(FromExit.DungeonDoorGridCoord == ToExit.DungeonGridCoord.position))
+			{
+				OutFromExit = &FromExit;
+				OutToExit = &ToExit;
+				bOutNeedPath = false;
+				return true;
+			}
+		}
+	}
+
+	OutFromExit = nullptr;
+	OutToExit = nullptr;
+	bOutNeedPath = true;
+
+	float MinDistance = FLT_MAX;
+	for(auto& FromExit : FromExitPoints)
+	{
+		// Skip exit blocked
+		if (IsGridTileBlocked(FromExit.DungeonGridCoord.position))
+		{
+			continue;
+		}
+
+		for (auto& ToExit : ToExitPoints)
+		{
+			// Skip exit blocked
+			if(IsGridTileBlocked(ToExit.DungeonGridCoord.position))
+			{
+				continue;
+			}
+
+			float currentDistance = GetDistance(FromExit.DungeonGridCoord.position, ToExit.DungeonGridCoord.position);
+
+			if(currentDistance < MinDistance)
+			{
+				MinDistance = currentDistance;
+				OutFromExit = &FromExit;
+				OutToExit = &ToExit;
+			}
+		}
+	}
+
+	if((OutFromExit == nullptr) || (OutToExit == nullptr))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to find a door combinaison for the room, maybe one room have all its exit blocked?"));
+		return false;
+	}
+	return true;
+}
+
+// Same as AddCorridorConnectingRooms with the dense search, which is paused when reaching the deadline
+bool ADungeonGenerator_GridBased::AddCorridorConnectingRooms_Resumable(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, double DeadlineSeconds, bool& bOutConnected)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumAllocationsBefore = SearchWorkspaces[0].GetNumAllocations();
+	ON_SCOPE_EXIT
+	{
+		LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		LastSearchStats.NumAllocations += SearchWorkspaces[0].GetNumAllocations() - NumAllocationsBefore;
+	};
+
+	if (!bHasPausedSearch)
+	{
+		check(FromRoom != ToRoom);
+
+		bool bNeedPath = true;
+		if (!SelectExitsToConnect(FromRoom, ToRoom, PausedSearchFromExit, PausedSearchToExit, bNeedPath))
+		{
+			bOutConnected = false;
+			return true;
+		}
+
+		if (bNeedPath)
+		{
+			LastSearchStats.NumSearches++;
+			const bool bSearchStarted = bUseMultiExitSearch
+				? BeginSearch_MultiExit(SearchWorkspaces[0], PausedSearchState, FromRoom, ToRoom)
+				: BeginSearch_Dense(SearchWorkspaces[0], PausedSearchState, PausedSearchFromExit->DungeonGridCoord.position, PausedSearchToExit->DungeonGridCoord.position);
+			if (!bSearchStarted)
+			{
+				LastSearchStats.NumFailedSearches++;
+				bOutConnected = false;
+				return true;
+			}
+			bHasPausedSearch = true;
+		}
+		else
+		{
+			// Doors are touching
+			MarkExitsUsed(PausedSearchFromExit, PausedSearchToExit);
+			bOutConnected = true;
+			return true;
+		}
+	}
+
+	TArray<FSG_GridCoordinate> Path;
+	const ECityGen_SearchStatus Status = ContinueSearch_Dense(SearchWorkspaces[0], PausedSearchState, DeadlineSeconds, Path);
+	if (Status == ECityGen_SearchStatus::InProgress)
+	{
+		return false;
+	}
+
+	bHasPausedSearch = false;
+	LastSearchStats.NumExpansions += PausedSearchState.NumIterations;
+	if (Status == ECityGen_SearchStatus::Failed)
+	{
+		const TCHAR* SearchName = bUseMultiExitSearch ? TEXT("Multi goal search between the exits of the rooms") : TEXT("Search of the exit pair");
+		if (PausedSearchState.NumIterations > PausedSearchState.MaxIterations)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("%s hit its expansion budget (MaxExpansionsPerPair = %d), move to next."), SearchName, MaxExpansionsPerPair);
+		}
+		else
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("%s found no path, move to next."), SearchName);
+		}
+		LastSearchStats.NumFailedSearches++;
+		bOutConnected = false;
+		return true;
+	}
+
+	if (bUseMultiExitSearch)
+	{
+		GetPathEndExits(FromRoom, ToRoom, Path, PausedSearchFromExit, PausedSearchToExit);
+	}
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+	CommitPath(Path, PausedSearchFromExit->DungeonGridCoord.position, PausedSearchFromExit->DungeonDoorGridCoord, PausedSearchToExit->DungeonGridCoord.position, PausedSearchToExit->DungeonDoorGridCoord);
+
+	MarkExitsUsed(PausedSearchFromExit, PausedSearchToExit);
+	bOutConnected = true;
+	return true;
+}
+
+bool ADungeonGenerator_GridBased::BeginSearch_MultiExit(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom) const
+{
+	TArray<FSG_GridCoordinate, TInlineAllocator<8>> StartCoords;
+	for (const FExitArrowData& FromExit : FromRoom->GetCachedExitPointsDataRef())
+	{
+		if (!IsGridTileBlocked(FromExit.DungeonGridCoord.position))
+		{
+			StartCoords.Add(FromExit.DungeonGridCoord.position);
+		}
+	}
+
+	TArray<FSG_GridCoordinate, TInlineAllocator<8>> GoalCoords;
+	for (const FExitArrowData& ToExit : ToRoom->GetCachedExitPointsDataRef())
+	{
+		if (!IsGridTileBlocked(ToExit.DungeonGridCoord.position))
+		{
+			GoalCoords.Add(ToExit.DungeonGridCoord.position);
+		}
+	}
+
+	if ((StartCoords.Num() == 0) || (GoalCoords.Num() == 0))
+	{
+		return false;
+	}
+	return BeginSearch_Dense(Workspace, State, StartCoords, GoalCoords, HeuristicWeight);
+}
+
+bool ADungeonGenerator_GridBased::FindPath_MultiExit(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumAllocationsBefore = SearchWorkspaces[0].GetNumAllocations();
+
+	FCityGen_DenseSearchState State;
+	TArray<FSG_GridCoordinate> Path;
+	ECityGen_SearchStatus Status = ECityGen_SearchStatus::Failed;
+	if (BeginSearch_MultiExit(SearchWorkspaces[0], State, FromRoom, ToRoom))
+	{
+		Status = ContinueSearch_Dense(SearchWorkspaces[0], State, TNumericLimits<double>::Max(), Path);
+	}
+	const bool bFoundPath = (Status == ECityGen_SearchStatus::Found);
+
+	LastSearchStats.NumSearches++;
+	LastSearchStats.NumFailedSearches += bFoundPath ? 0 : 1;
+	LastSearchStats.NumExpansions += State.NumIterations;
+	LastSearchStats.NumAllocations += SearchWorkspaces[0].GetNumAllocations() - NumAllocationsBefore;
+	LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	if (!bFoundPath)
+	{
+		return false;
+	}
+
+	GetPathEndExits(FromRoom, ToRoom, Path, OutFromExit, OutToExit);
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+	CommitPath(Path, OutFromExit->DungeonGridCoord.position, OutFromExit->DungeonDoorGridCoord, OutToExit->DungeonGridCoord.position, OutToExit->DungeonDoorGridCoord);
+	return true;
+}
+
+void ADungeonGenerator_GridBased::GetPathEndExits(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, const TArray<FSG_GridCoordinate>& Path, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit) const
+{
+	// The path goes from the reached goal back to the seed it came from
+	OutFromExit = FromRoom->GetCachedExitPointsDataRef().FindByPredicate([&Path](const FExitArrowData& Exit) { return Exit.DungeonGridCoord.position == Path.Last(); });
+	OutToExit = ToRoom->GetCachedExitPointsDataRef().FindByPredicate([&Path](const FExitArrowData& Exit) { return Exit.DungeonGridCoord.position == Path[0]; });
+	check(OutFromExit != nullptr && OutToExit != nullptr);
+}
+
+bool ADungeonGenerator_GridBased::AddCorridorConnectingRoomToNetwork(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ParentRoom)
+{
+	check(FromRoom != ParentRoom);
+
+	// The parent is the closest room of the tree, it gives the touching doors and checks that both rooms have an unblocked exit
+	FExitArrowData* FromExit = nullptr;
+	FExitArrowData* ToExit = nullptr;
+	bool bNeedPath = true;
+	if (!SelectExitsToConnect(FromRoom, ParentRoom, FromExit, ToExit, bNeedPath))
+	{
+		return false;
+	}
+
+	if (bNeedPath && !FindPath_ToNetwork(FromRoom, FromExit, ToExit))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Failed to find a path from the room to the corridor network, move to next."));
+		return false;
+	}
+
+	MarkExitsUsed(FromExit, ToExit);
+	NetworkRooms.Add(FromRoom);
+	return true;
+}
+
+bool ADungeonGenerator_GridBased::FindPath_ToNetwork(ACityGen_RoomBase* FromRoom, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumAllocationsBefore = SearchWorkspaces[0].GetNumAllocations();
+
+	TArray<FSG_GridCoordinate> StartCoords;
+	for (const FExitArrowData& FromExit : FromRoom->GetCachedExitPointsDataRef())
+	{
+		if (!IsGridTileBlocked(FromExit.DungeonGridCoord.position))
+		{
+			StartCoords.Add(FromExit.DungeonGridCoord.position);
+		}
+	}
+
+	TArray<FSG_GridCoordinate> GoalCoords;
+	for (ACityGen_RoomBase* NetworkRoom : NetworkRooms)
+	{
+		for (const FExitArrowData& ToExit : NetworkRoom->GetCachedExitPointsDataRef())
+		{
+			if (!IsGridTileBlocked(ToExit.DungeonGridCoord.position))
+			{
+				GoalCoords.Add(ToExit.DungeonGridCoord.position);
+			}
+		}
+	}
+	RequestedCorridors.ForEach([this, &GoalCoords](const FSG_GridCoordinate& Coord, const FCellConnectionState& Connection)
+	{
+		// Joining an elevator would need a corridor piece with both vertical and horizontal openings
+		if (!Connection.IsVertical() && !IsGridTileBlocked(Coord))
+		{
+			GoalCoords.Add(Coord);
+		}
+	});
+
+	FCityGen_DenseSearchState State;
+	TArray<FSG_GridCoordinate> Path;
+	ECityGen_SearchStatus Status = ECityGen_SearchStatus::Failed;
+	if ((StartCoords.Num() > 0) && (GoalCoords.Num() > 0) && BeginSearch_Dense(SearchWorkspaces[0], State, StartCoords, GoalCoords, HeuristicWeight))
+	{
+		Status = ContinueSearch_Dense(SearchWorkspaces[0], State, TNumericLimits<double>::Max(), Path);
+	}
+	const bool bFoundPath = (Status == ECityGen_SearchStatus::Found);
+
+	LastSearchStats.NumSearches++;
+	LastSearchStats.NumFailedSearches += bFoundPath ? 0 : 1;
+	LastSearchStats.NumExpansions += State.NumIterations;
+	LastSearchStats.NumAllocations += SearchWorkspaces[0].GetNumAllocations() - NumAllocationsBefore;
+	LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	if (!bFoundPath)
+	{
+		return false;
+	}
+
+	// The path goes from the reached goal back to the exit it came from
+	OutFromExit = FromRoom->GetCachedExitPointsDataRef().FindByPredicate([&Path](const FExitArrowData& Exit) { return Exit.DungeonGridCoord.position == Path.Last(); });
+	check(OutFromExit != nullptr);
+
+	OutToExit = nullptr;
+	for (ACityGen_RoomBase* NetworkRoom : NetworkRooms)
+	{
+		OutToExit = NetworkRoom->GetCachedExitPointsDataRef().FindByPredicate([&Path](const FExitArrowData& Exit) { return Exit.DungeonGridCoord.position == Path[0]; });
+		if (OutToExit != nullptr)
+		{
+			break;
+		}
+	}
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+	if (OutToExit != nullptr)
+	{
+		CommitPath(Path, OutFromExit->DungeonGridCoord.position, OutFromExit->DungeonDoorGridCoord, OutToExit->DungeonGridCoord.position, OutToExit->DungeonDoorGridCoord);
+	}
+	else
+	{
+		// Ends on a corridor cell, which gets one more connection
+		AddCorridorConnection(OutFromExit->DungeonGridCoord.position, OutFromExit->DungeonDoorGridCoord, true);
+		CommitPathCells(Path);
+	}
+	return true;
+}
+
+bool ADungeonGenerator_GridBased::ConnectRoomPairsInParallel(TArrayView<const TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>> RoomsToConnect)
+{
+	// The exits only depend on the blocked tiles, they can all be selected first
+	bool bFoundPathBetweenAllRooms = true;
+	TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>> PairRooms;
+	TArray<TPair<FExitArrowData*, FExitArrowData*>> PairExits;
+	TArray<TPair<FSG_GridCoordinate, FSG_GridCoordinate>> PairEndpoints;
+	for (const auto& RoomToConnect : RoomsToConnect)
+	{
+		check(RoomToConnect.Key != RoomToConnect.Value);
+
+		FExitArrowData* FromExit = nullptr;
+		FExitArrowData* ToExit = nullptr;
+		bool bNeedPath = true;
+		if (!SelectExitsToConnect(RoomToConnect.Key, RoomToConnect.Value, FromExit, ToExit, bNeedPath))
+		{
+			bFoundPathBetweenAllRooms = false;
+			continue;
+		}
+
+		if (!bNeedPath)
+		{
+			BeginPairRecord(RoomToConnect.Key, RoomToConnect.Value);
+			MarkExitsUsed(FromExit, ToExit);
+			EndPairRecord(true);
+			continue;
+		}
+		PairRooms.Add(RoomToConnect);
+		PairExits.Emplace(FromExit, ToExit);
+		PairEndpoints.Emplace(FromExit->DungeonGridCoord.position, ToExit->DungeonGridCoord.position);
+	}
+
+	const bool bFoundAllPaths = SearchPathsInParallel(PairEndpoints, [this, &PairRooms, &PairExits](int32 PairIndex, const TArray<FSG_GridCoordinate>& Path)
+	{
+		FExitArrowData* FromExit = PairExits[PairIndex].Key;
+		FExitArrowData* ToExit = PairExits[PairIndex].Value;
+
+		UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+		BeginPairRecord(PairRooms[PairIndex].Key, PairRooms[PairIndex].Value);
+		CommitPath(Path, FromExit->DungeonGridCoord.position, FromExit->DungeonDoorGridCoord, ToExit->DungeonGridCoord.position, ToExit->DungeonDoorGridCoord);
+		MarkExitsUsed(FromExit, ToExit);
+		EndPairRecord(true);
+	});
+	return bFoundPathBetweenAllRooms && bFoundAllPaths;
+}
+
+bool ADungeonGenerator_GridBased::ConnectHubPairsWithFlowField(ACityGen_RoomBase* Hub, const TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>>& RoomsToConnect)
+{
+	FCityGen_SearchWorkspace& Workspace = SearchWorkspaces[0];
+	FCityGen_DenseSearchStorage& Storage = Workspace.Storage;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumAllocationsBefore = Workspace.GetNumAllocations();
+	ON_SCOPE_EXIT
+	{
+		LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		LastSearchStats.NumAllocations += Workspace.GetNumAllocations() - NumAllocationsBefore;
+	};
+
+	// Every hub exit is a source with no cost
+	Workspace.BeginSearch(DungeonGridBounds);
+	uint32 PushSequence = 0;
+	for (const FExitArrowData& HubExit : Hub->GetCachedExitPointsDataRef())
+	{
+		const FSG_GridCoordinate& Coord = HubExit.DungeonGridCoord.position;
+		if (!Storage.IsInside(Coord) || IsGridTileBlocked(Coord) || Storage.IsOpen(Storage.ToIndex(Coord)))
+		{
+			continue;
+		}
+		Storage.SetGCost(Storage.ToIndex(Coord), 0.0f);
+		Workspace.PushOpenNode(Storage.ToIndex(Coord), 0.0f, 0.0f, PushSequence++);
+	}
+	LastSearchStats.NumSearches++;
+	LastSearchStats.NumExpansions += ExpandFlowField(Workspace, PushSequence);
+
+	bool bFoundPathBetweenAllRooms = true;
+	TArray<FSG_GridCoordinate> Path;
+	TArray<FSG_GridCoordinate> NewCorridorCells;
+	for (const TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>& RoomToConnect : RoomsToConnect)
+	{
+		ACityGen_RoomBase* Room = RoomToConnect.Value;
+		check(RoomToConnect.Key == Hub && Room != Hub);
+
+		FExitArrowData* HubExit = nullptr;
+		FExitArrowData* RoomExit = nullptr;
+		bool bNeedPath = true;
+		if (!SelectExitsToConnect(Hub, Room, HubExit, RoomExit, bNeedPath))
+		{
+			bFoundPathBetweenAllRooms = false;
+			continue;
+		}
+
+		BeginPairRecord(Hub, Room);
+		if (!bNeedPath)
+		{
+			MarkExitsUsed(HubExit, RoomExit);
+			EndPairRecord(true);
+			continue;
+		}
+
+		// The exit of the room closest to the hub along the field
+		RoomExit = nullptr;
+		float MinGCost = TNumericLimits<float>::Max();
+		for (FExitArrowData& Exit : Room->GetCachedExitPointsDataRef())
+		{
+			const FSG_GridCoordinate& Coord = Exit.DungeonGridCoord.position;
+			if (!Storage.IsInside(Coord) || IsGridTileBlocked(Coord))
+			{
+				continue;
+			}
+
+			const float GCost = Storage.GetGCost(Storage.ToIndex(Coord));
+			if (GCost < MinGCost)
+			{
+				MinGCost = GCost;
+				RoomExit = &Exit;
+			}
+		}
+		if (RoomExit == nullptr)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("No exit of the room is reached by the hub flow field, move to next."));
+			LastSearchStats.NumFailedSearches++;
+			bFoundPathBetweenAllRooms = false;
+			EndPairRecord(false);
+			continue;
+		}
+
+		// The path goes from the room exit back to the hub exit it came from
+		Storage.GetPath(Storage.ToIndex(RoomExit->DungeonGridCoord.position), Path);
+		HubExit = Hub->GetCachedExitPointsDataRef().FindByPredicate([&Path](const FExitArrowData& Exit) { return Exit.DungeonGridCoord.position == Path.Last(); });
+		check(HubExit != nullptr);
+
+		NewCorridorCells.Reset();
+		for (const FSG_GridCoordinate& Cell : Path)
+		{
+			if (!RequestedCorridors.Contains(Cell))
+			{
+				NewCorridorCells.Add(Cell);
+			}
+		}
+
+		UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+		CommitPath(Path, HubExit->DungeonGridCoord.position, HubExit->DungeonDoorGridCoord, RoomExit->DungeonGridCoord.position, RoomExit->DungeonDoorGridCoord);
+		MarkExitsUsed(HubExit, RoomExit);
+		EndPairRecord(true);
+
+		// Entering the new corridor cells is cheaper: costs only decrease, so relaxing from the improved cells keeps the field exact
+		for (const FSG_GridCoordinate& Cell : NewCorridorCells)
+		{
+			const int32 CellIndex = Storage.ToIndex(Cell);
+			for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+			{
+				const FSG_GridCoordinate NeighbourCoords = Cell + FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+				if (!Storage.IsInside(NeighbourCoords))
+				{
+					continue;
+				}
+
+				const float NeighbourGCost = Storage.GetGCost(Storage.ToIndex(NeighbourCoords));
+				if (NeighbourGCost == TNumericLimits<float>::Max())
+				{
+					continue;
+				}
+
+				const float NewGCost = NeighbourGCost + GetDistance(NeighbourCoords, Cell) * CityGenCorridorCost::MovementReductionFactorForCellWithCorridor;
+				if (NewGCost < Storage.GetGCost(CellIndex))
+				{
+					Storage.SetGCost(CellIndex, NewGCost);
+					Storage.SetParentDirection(CellIndex, Direction);
+					Workspace.PushOpenNode(CellIndex, NewGCost, 0.0f, PushSequence++);
+				}
+			}
+		}
+		LastSearchStats.NumExpansions += ExpandFlowField(Workspace, PushSequence);
+	}
+
+	Workspace.EndSearch();
+	return bFoundPathBetweenAllRooms;
+}
+
+int32 ADungeonGenerator_GridBased::ExpandFlowField(FCityGen_SearchWorkspace& Workspace, uint32& PushSequence) const
+{
+	FCityGen_DenseSearchStorage& Storage = Workspace.Storage;
+	TArray<FCityGen_DenseOpenEntry>& OpenHeap = Workspace.OpenHeap;
+	const FCityGen_DenseOpenEntryPredicate OpenHeapPredicate;
+
+	int32 NumExpansions = 0;
+	while (OpenHeap.Num() > 0)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		OpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+
+		const int32 CurrentIndex = Entry.CellIndex;
+		if (!Storage.IsOpen(CurrentIndex) || (Storage.GetGCost(CurrentIndex) != Entry.GCost))
+		{
+			continue; // Stale entry: the node was closed or improved after this push
+		}
+
+		NumExpansions++;
+		Storage.SetClosed(CurrentIndex);
+
+		// No heuristic: a closed node already has its lowest cost, unless a later corridor lowers it
+		const FSG_GridCoordinate CurrentCoords = Storage.ToCoord(CurrentIndex);
+		const float CurrentGCost = Storage.GetGCost(CurrentIndex);
+		const uint8 WalkableNeighbours = GetWalkableNeighbourMask(CurrentCoords);
+		for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+		{
+			const FSG_GridCoordinate NeighbourCoords = CurrentCoords + FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+			if ((WalkableNeighbours & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			float MovementCost = GetDistance(CurrentCoords, NeighbourCoords);
+			if (RequestedCorridors.Contains(NeighbourCoords))
+			{
+				MovementCost *= CityGenCorridorCost::MovementReductionFactorForCellWithCorridor;
+			}
+
+			const int32 NeighbourIndex = Storage.ToIndex(NeighbourCoords);
+			const float NewGCost = CurrentGCost + MovementCost;
+			if (NewGCost >= Storage.GetGCost(NeighbourIndex))
+			{
+				continue;
+			}
+
+			Storage.SetGCost(NeighbourIndex, NewGCost);
+			Storage.SetParentDirection(NeighbourIndex, FCityGen_DenseSearchStorage::GetOppositeDirection(Direction));
+			Workspace.PushOpenNode(NeighbourIndex, NewGCost, 0.0f, PushSequence++);
+		}
+	}
+	return NumExpansions;
+}
+#else
+
+// SORTING EXITS BASED ON CLOSEST TO FURTHEST from given location
+bool ADungeonGenerator_GridBased::GetSortedExitArrows(ACityGen_RoomBase* FromRoom, const FSG_GridCoordinate& ToLocationGS, TArray<FExitArrowData*>& OutSortedExitData) const
+{
+	TMap<float, FExitArrowData*> DistanceMap; // Use int32 for distance keys
+
+	if (!FromRoom)
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("GetSortedExitArrows: Null room pointers"));
+		return false;
+	}
+
+	// Loop over all exit points on FromRoom
+	TArray<FExitArrowData>& FromRoomExitPoints = FromRoom->GetCachedExitPointsDataRef();
+	for (FExitArrowData& ExitData : FromRoomExitPoints)
+	{
+		// Calculate local grid distance directly using GridCoords (no world conversions)
+		float Distance = GetDistance(ExitData.DungeonGridCoord.position, ToLocationGS);
+
+		// Use Distance as the key for sorting
+		// To handle potential duplicates, add a small offset (like index) or use TMultiMap if necessary
+		while (DistanceMap.Contains(Distance))
+		{
+			Distance++;
+		}
+
+		DistanceMap.Add(Distance, &ExitData);
+	}
+
+	// Sort by distance ascending
+	DistanceMap.KeySort(TLess<float>());
+
+	// Copy to output array in sorted order
+	for (auto& Pair : DistanceMap)
+	{
+		OutSortedExitData.Add(Pair.Value);
+	}
+
+	return true;
+}
+#endif // WITH_SORTED_EXIT_ARROW
+
+int32 ADungeonGenerator_GridBased::GetParallelSearchBatchSize() const
+{
+	return (ParallelSearchBatchSize > 0) ? ParallelSearchBatchSize : (FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+}
+
+// Pairs are searched by batches on worker threads, all against the corridors committed before the batch
+// Results are committed in pair order. A search which may have read a cell that became a corridor earlier in the same batch
+// is run again (see IsSpeculativeSearchInvalidated): the result is always the same as the sequential search
+bool ADungeonGenerator_GridBased::SearchPathsInParallel(TArrayView<const TPair<FSG_GridCoordinate, FSG_GridCoordinate>> PairEndpoints, TFunctionRef<void(int32 PairIndex, const TArray<FSG_GridCoordinate>& Path)> CommitPair)
+{
+	struct FPairSearch
+	{
+		bool bFoundPath = false;
+		FCityGen_DenseSearchResult Result;
+		TArray<FSG_GridCoordinate> Path;
+	};
+
+	bool bFoundAllPaths = true;
+	TArray<FPairSearch> PairSearches;
+	PairSearches.SetNum(PairEndpoints.Num());
+
+	const int32 BatchSize = GetParallelSearchBatchSize();
+	if (ParallelSearchWorkspaces.Num() < BatchSize)
+	{
+		ParallelSearchWorkspaces.SetNum(BatchSize);
+	}
+
+	auto GetNumAllocations = [this]()
+	{
+		int32 NumAllocations = 0;
+		for (const FCityGen_SearchWorkspace& Workspace : ParallelSearchWorkspaces)
+		{
+			NumAllocations += Workspace.GetNumAllocations();
+		}
+		return NumAllocations;
+	};
+
+	TArray<FSG_GridCoordinate> CellsAddedInBatch;
+	for (int32 BatchStart = 0; BatchStart < PairSearches.Num(); BatchStart += BatchSize)
+	{
+		const int32 BatchCount = FMath::Min(BatchSize, PairSearches.Num() - BatchStart);
+		const double StartTime = FPlatformTime::Seconds();
+		const int32 NumAllocationsBefore = GetNumAllocations();
+
+		// Nothing is written in RequestedCorridors until all the searches of the batch are done
+		ParallelFor(BatchCount, [this, &PairSearches, PairEndpoints, BatchStart](int32 BatchIndex)
+		{
+			const int32 PairIndex = BatchStart + BatchIndex;
+			FPairSearch& PairSearch = PairSearches[PairIndex];
+			PairSearch.bFoundPath = SearchPath_Dense(ParallelSearchWorkspaces[BatchIndex], PairEndpoints[PairIndex].Key, PairEndpoints[PairIndex].Value, false, false, PairSearch.Path, PairSearch.Result);
+		});
+		LastSearchStats.NumSearches += BatchCount;
+
+		CellsAddedInBatch.Reset();
+		for (int32 BatchIndex = 0; BatchIndex < BatchCount; ++BatchIndex)
+		{
+			const int32 PairIndex = BatchStart + BatchIndex;
+			FPairSearch& PairSearch = PairSearches[PairIndex];
+			FCityGen_SearchWorkspace& Workspace = ParallelSearchWorkspaces[BatchIndex];
+			LastSearchStats.NumExpansions += PairSearch.Result.NumExpansions;
+
+			if (IsSpeculativeSearchInvalidated(Workspace.Storage, PairSearch.Result, PairEndpoints[PairIndex].Value, CellsAddedInBatch))
+			{
+				PairSearch.bFoundPath = SearchPath_Dense(Workspace, PairEndpoints[PairIndex].Key, PairEndpoints[PairIndex].Value, false, false, PairSearch.Path, PairSearch.Result);
+				LastSearchStats.NumSearches++;
+				LastSearchStats.NumSpeculativeReruns++;
+				LastSearchStats.NumExpansions += PairSearch.Result.NumExpansions;
+			}
+
+			if (!PairSearch.bFoundPath)
+			{
+				if (PairSearch.Result.NumExpansions >= MaxExpansionsPerPair)
+				{
+					UE_LOG(LogCityGen, Warning, TEXT("Speculative parallel search hit MaxExpansionsPerPair (%d) for pair %d, move to next."), MaxExpansionsPerPair, PairIndex);
+				}
+				else
+				{
+					UE_LOG(LogCityGen, Warning, TEXT("Speculative parallel search found no path for pair %d, move to next."), PairIndex);
+				}
+				LastSearchStats.NumFailedSearches++;
+				bFoundAllPaths = false;
+				continue;
+			}
+
+			for (const FSG_GridCoordinate& Cell : PairSearch.Path)
+			{
+				if (!RequestedCorridors.Contains(Cell))
+				{
+					CellsAddedInBatch.Add(Cell);
+				}
+			}
+
+			FCityGen_DenseSearchResult BoundResult = PairSearch.Result;
+			BoundResult.NumExpansions = 0; // Already counted above
+			LastSearchStats.AddDenseSearchResult(BoundResult, true);
+
+			CommitPair(PairIndex, PairSearch.Path);
+		}
+
+		LastSearchStats.NumAllocations += GetNumAllocations() - NumAllocationsBefore;
+		LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+
+	return bFoundAllPaths;
+}
+
+bool ADungeonGenerator_GridBased::IsSpeculativeSearchInvalidated(const FCityGen_DenseSearchStorage& Storage, const FCityGen_DenseSearchResult& Result, const FSG_GridCoordinate& Goal, TArrayView<const FSG_GridCoordinate> CellsAddedInBatch) const
+{
+	// The search only read the corridor cost of the cells it reached. Becoming a corridor lowers the G of a reached cell by
+	// at most the discount of the longest step: while its F stays above every F popped by the search, the cell is never
+	// popped and the search pops the same nodes in the same order. An expanded cell always changes the search
+	const float MaxCostReduction = (1.0f - CityGenCorridorCost::MovementReductionFactorForCellWithCorridor) * FMath::Max(1.0f, DistanceFactorForZ);
+	const float Weight = FMath::Max(HeuristicWeight, 1.0f);
+	for (const FSG_GridCoordinate& Cell : CellsAddedInBatch)
+	{
+		const int32 Index = Storage.ToIndex(Cell);
+		if (!Storage.IsTouched(Index))
+		{
+			continue;
+		}
+		if (Storage.WasExpanded(Index))
+		{
+			return true;
+		}
+
+		// Only the goals are touched without a G, they end the search once popped so they were expanded if reached
+		const float GCost = Storage.GetGCost(Index);
+		if (GCost == TNumericLimits<float>::Max())
+		{
+			continue;
+		}
+		const float MinFCost = GCost - MaxCostReduction + Weight * GetDistance(Cell, Goal);
+		if (MinFCost <= Result.MaxPoppedFCost + UE_KINDA_SMALL_NUMBER)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+#if WITH_EDITOR
+void ADungeonGenerator_GridBased::SnapRoomsToGridEd()
+{
+	TArray<ACityGen_RoomBase*> Rooms = GetAllRoomsArray(); // Need to call this function as 'AllRooms' may not be set yet if we wll from editor button
+	for (ACityGen_RoomBase* Room : Rooms)
+	{
+		check(Room);
+		Room->SnapRoomToGrid(DungeonGridCmpt);
+		Room->UpdateGridCoordCaches(DungeonGridCmpt);
+	}
+}
+#endif // WITH_EDITOR
+
+void ADungeonGenerator_GridBased::SnapRoomsToGrid()
+{
+	for (ACityGen_RoomBase* Room : AllRooms)
+	{
+		Room->SnapRoomToGrid(DungeonGridCmpt);
+		Room->UpdateGridCoordCaches(DungeonGridCmpt);
+	}
+}
+
+void ADungeonGenerator_GridBased::ClearPathCache()
+{
+	PathCache.Empty(FMath::Max(PathCacheSize, 1));
+}
+
+#if WITH_EDITOR
+void ADungeonGenerator_GridBased::ReplanMovedRooms()
+{
+	TArray<ACityGen_RoomBase*> MovedRooms;
+	for (ACityGen_RoomBase* Room : GetAllRoomsArray())
+	{
+		const FTransform* pPlannedTransform = PlannedRoomTransforms.Find(Room);
+		if ((pPlannedTransform == nullptr) || !pPlannedTransform->Equals(Room->GetActorTransform()))
+		{
+			MovedRooms.Add(Room);
+		}
+	}
+
+	if (MovedRooms.Num() > 0)
+	{
+		ReplanCorridors(MovedRooms);
+	}
+}
+
+void ADungeonGenerator_GridBased::DebugDrawRoomsCachedData()
+{
+	TArray<ACityGen_RoomBase*> Rooms = GetAllRoomsArray(); // Need to call this function as 'AllRooms' may not be set yet if we wll from editor button
+	for (ACityGen_RoomBase* Room : Rooms)
+	{
+		check(Room);
+		Room->DebugDrawRoomCachedData(DungeonGridCmpt);
+	}
+}
+
+void ADungeonGenerator_GridBased::BenchmarkCorridorSearch()
+{
+	// The runs clear the corridors and used exits, the generated ones would be lost
+	if ((RequestedCorridors.Num() > 0) || (AllSpawnedCorridors.Num() > 0) || (GetNumCorridorInstances() > 0))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("BenchmarkCorridorSearch: clear the generated corridors before running the benchmark"));
+		return;
+	}
+
+	// Same rooms and same pairs for every algorithm, so the stats can be compared directly
+	ClearCorridorMeshes();
+
+	struct FBenchmarkSettings
+	{
+		ECorridorSearchAlgorithm Algorithm;
+		bool bUseDenseSearchStorage;
+		bool bUseParallelCorridorSearch;
+		bool bUseMultiExitSearch;
+		ECorridorConnectionMode ConnectionMode = ECorridorConnectionMode::RoomPairs;
+		bool bUsePathCache = false; // Run once to fill the cache, the second run is logged
+		float HeuristicWeight = 1.0f;
+		bool bUseAnytimeSearch = false;
+	};
+
+	const ECorridorSearchAlgorithm PreviousAlgorithm = CorridorSearchAlgorithm;
+	const bool bPreviousUseDenseSearchStorage = bUseDenseSearchStorage;
+	const bool bPreviousUseParallelCorridorSearch = bUseParallelCorridorSearch;
+	const bool bPreviousUseMultiExitSearch = bUseMultiExitSearch;
+	const ECorridorConnectionMode PreviousConnectionMode = ConnectionMode;
+	const bool bPreviousUsePathCache = bUsePathCache;
+	const float PreviousHeuristicWeight = HeuristicWeight;
+	const bool bPreviousUseAnytimeSearch = bUseAnytimeSearch;
+	const FBenchmarkSettings SettingsToCompare[] = {
+		{ ECorridorSearchAlgorithm::LinearScan, false, false, false },
+		{ ECorridorSearchAlgorithm::BinaryHeap, false, false, false },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, false, false },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, true, false },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, false, true },
+		{ ECorridorSearchAlgorithm::JumpPointSearch, true, false, false },
+		{ ECorridorSearchAlgorithm::Bidirectional, true, false, false },
+		{ ECorridorSearchAlgorithm::Hierarchical, true, false, false },
+		{ ECorridorSearchAlgorithm::BucketQueue, true, false, false },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, false, false, ECorridorConnectionMode::SharedNetwork },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, false, false, ECorridorConnectionMode::RoomPairs, true },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, false, false, ECorridorConnectionMode::RoomPairs, false, 2.0f },
+		{ ECorridorSearchAlgorithm::BinaryHeap, true, false, false, ECorridorConnectionMode::RoomPairs, false, 3.0f, true },
+	};
+	for (const FBenchmarkSettings& Settings : SettingsToCompare)
+	{
+		CorridorSearchAlgorithm = Settings.Algorithm;
+		bUseDenseSearchStorage = Settings.bUseDenseSearchStorage;
+		bUseParallelCorridorSearch = Settings.bUseParallelCorridorSearch;
+		bUseMultiExitSearch = Settings.bUseMultiExitSearch;
+		ConnectionMode = Settings.ConnectionMode;
+		bUsePathCache = Settings.bUsePathCache;
+		HeuristicWeight = Settings.HeuristicWeight;
+		bUseAnytimeSearch = Settings.bUseAnytimeSearch;
+		if (bUsePathCache)
+		{
+			ClearPathCache();
+			PlanCorridors();
+			ClearCorridorMeshes();
+		}
+		const bool bSuccess = PlanCorridors();
+		UE_LOG(LogCityGen, Display, TEXT("Benchmark %s%s%s%s%s%s (weight %.1f%s): success=%d corridor cells=%d searches=%d failed=%d expansions=%d allocations=%d reruns=%d cache hits=%d max bound=%.3f time=%.3f ms"),
+			*UEnum::GetValueAsString(Settings.Algorithm),
+			Settings.bUseDenseSearchStorage ? TEXT(" (dense storage)") : TEXT(""),
+			Settings.bUseParallelCorridorSearch ? TEXT(" (parallel)") : TEXT(""),
+			Settings.bUseMultiExitSearch ? TEXT(" (multi exit)") : TEXT(""),
+			(Settings.ConnectionMode == ECorridorConnectionMode::SharedNetwork) ? TEXT(" (shared network)") : TEXT(""),
+			Settings.bUsePathCache ? TEXT(" (path cache, warm)") : TEXT(""),
+			Settings.HeuristicWeight,
+			Settings.bUseAnytimeSearch ? TEXT(", anytime") : TEXT(""),
+			bSuccess ? 1 : 0,
+			LastSearchStats.NumCorridorCells,
+			LastSearchStats.NumSearches,
+			LastSearchStats.NumFailedSearches,
+			LastSearchStats.NumExpansions,
+			LastSearchStats.NumAllocations,
+			LastSearchStats.NumSpeculativeReruns,
+			LastSearchStats.NumPathCacheHits,
+			LastSearchStats.MaxSuboptimalityBound,
+			LastSearchStats.SearchTimeMs);
+
+		// Reset requested corridors and used exits for the next run
+		ClearCorridorMeshes();
+	}
+	CorridorSearchAlgorithm = PreviousAlgorithm;
+	bUseDenseSearchStorage = bPreviousUseDenseSearchStorage;
+	bUseParallelCorridorSearch = bPreviousUseParallelCorridorSearch;
+	bUseMultiExitSearch = bPreviousUseMultiExitSearch;
+	ConnectionMode = PreviousConnectionMode;
+	bUsePathCache = bPreviousUsePathCache;
+	HeuristicWeight = PreviousHeuristicWeight;
+	bUseAnytimeSearch = bPreviousUseAnytimeSearch;
+
+	BenchmarkStarSpokes(40);
+	BenchmarkLongStraights();
+}
+
+void ADungeonGenerator_GridBased::InitBenchmarkGrid(const FSG_GridCoordinate& Min, const FSG_GridCoordinate& Max)
+{
+	DungeonGridBounds.Reset();
+	DungeonGridBounds.Add(Min);
+	DungeonGridBounds.Add(Max);
+	BlockedGridTiles.Init(DungeonGridBounds.Min, DungeonGridBounds.GetSize());
+	RequestedCorridors.SetBounds(DungeonGridBounds.Min, DungeonGridBounds.GetSize());
+}
+
+void ADungeonGenerator_GridBased::BenchmarkStarSpokes(int32 NumSpokes)
+{
+	// Square hub in the middle of an empty grid, each spoke goes from a cell next to the hub to a cell on a circle around it
+	// The spokes of a batch start next to each other, their searches reach the cells committed earlier in the batch
+	const int32 HubHalfSize = FMath::Max(NumSpokes / 4, 1);
+	const int32 Radius = HubHalfSize + 24;
+	const FCityGen_GridBounds PreviousBounds = DungeonGridBounds;
+	InitBenchmarkGrid(FSG_GridCoordinate(-Radius - 2, -Radius - 2, 0), FSG_GridCoordinate(Radius + 2, Radius + 2, 0));
+	for (int32 Y = -HubHalfSize; Y <= HubHalfSize; ++Y)
+	{
+		for (int32 X = -HubHalfSize; X <= HubHalfSize; ++X)
+		{
+			BlockedGridTiles.Set(FSG_GridCoordinate(X, Y, 0));
+		}
+	}
+
+	TArray<TPair<FSG_GridCoordinate, FSG_GridCoordinate>> PairEndpoints;
+	for (int32 SpokeIndex = 0; SpokeIndex < NumSpokes; ++SpokeIndex)
+	{
+		const float Angle = UE_TWO_PI * SpokeIndex / NumSpokes;
+		const float Cos = FMath::Cos(Angle);
+		const float Sin = FMath::Sin(Angle);
+		const float DoorDistance = (HubHalfSize + 1) / FMath::Max(FMath::Abs(Cos), FMath::Abs(Sin)); // On the ring of cells around the hub
+		PairEndpoints.Emplace(
+			FSG_GridCoordinate(FMath::RoundToInt(Cos * DoorDistance), FMath::RoundToInt(Sin * DoorDistance), 0),
+			FSG_GridCoordinate(FMath::RoundToInt(Cos * Radius), FMath::RoundToInt(Sin * Radius), 0));
+	}
+
+	auto GetCorridorCells = [this]()
+	{
+		TArray<FSG_GridCoordinate> Cells;
+		RequestedCorridors.GetKeys(Cells);
+		TSet<FSG_GridCoordinate> CellSet;
+		CellSet.Append(Cells);
+		return CellSet;
+	};
+
+	// Same searches as FindPath_Dense, one pair after the other
+	const double SequentialStartTime = FPlatformTime::Seconds();
+	int32 NumSequentialExpansions = 0;
+	int32 NumSequentialFailures = 0;
+	TArray<FSG_GridCoordinate> Path;
+	for (const TPair<FSG_GridCoordinate, FSG_GridCoordinate>& Endpoints : PairEndpoints)
+	{
+		FCityGen_DenseSearchResult Result;
+		if (SearchPath_Dense(SearchWorkspaces[0], Endpoints.Key, Endpoints.Value, false, false, Path, Result))
+		{
+			CommitPathCells(Path);
+		}
+		else
+		{
+			NumSequentialFailures++;
+		}
+		NumSequentialExpansions += Result.NumExpansions;
+	}
+	const double SequentialTimeMs = (FPlatformTime::Seconds() - SequentialStartTime) * 1000.0;
+	const TSet<FSG_GridCoordinate> SequentialCells = GetCorridorCells();
+
+	RequestedCorridors.Reset();
+	LastSearchStats = FCorridorSearchStats();
+	SearchPathsInParallel(PairEndpoints, [this](int32 PairIndex, const TArray<FSG_GridCoordinate>& PairPath)
+	{
+		CommitPathCells(PairPath);
+	});
+	const TSet<FSG_GridCoordinate> ParallelCells = GetCorridorCells();
+	const bool bSameCorridors = (ParallelCells.Num() == SequentialCells.Num()) && ParallelCells.Includes(SequentialCells);
+
+	UE_LOG(LogCityGen, Display, TEXT("Benchmark star with %d spokes: sequential expansions=%d failed=%d time=%.3f ms, parallel searches=%d expansions=%d reruns=%d failed=%d time=%.3f ms, same corridors=%d"),
+		NumSpokes,
+		NumSequentialExpansions,
+		NumSequentialFailures,
+		SequentialTimeMs,
+		LastSearchStats.NumSearches,
+		LastSearchStats.NumExpansions,
+		LastSearchStats.NumSpeculativeReruns,
+		LastSearchStats.NumFailedSearches,
+		LastSearchStats.SearchTimeMs,
+		bSameCorridors ? 1 : 0);
+
+	ClearCorridorMeshes();
+	DungeonGridBounds = PreviousBounds;
+}
+
+void ADungeonGenerator_GridBased::BenchmarkLongStraights()
+{
+	// Lanes along X split by walls open at both ends, each pair goes from one end of a lane to the other,
+	// and the last one across the whole grid. The rooms of the pairs are the cells just outside of the grid
+	const int32 GridLength = 256;
+	const int32 LaneWidth = 8;
+	const int32 NumLanes = 8;
+	const FCityGen_GridBounds PreviousBounds = DungeonGridBounds;
+	InitBenchmarkGrid(FSG_GridCoordinate(0, 0, 0), FSG_GridCoordinate(GridLength - 1, NumLanes * LaneWidth - 1, 0));
+	for (int32 Lane = 1; Lane < NumLanes; ++Lane)
+	{
+		for (int32 X = LaneWidth; X < GridLength - LaneWidth; ++X)
+		{
+			BlockedGridTiles.Set(FSG_GridCoordinate(X, Lane * LaneWidth, 0));
+		}
+	}
+
+	TArray<TPair<FSG_GridCoordinate, FSG_GridCoordinate>> PairEndpoints;
+	for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+	{
+		const int32 Y = Lane * LaneWidth + LaneWidth / 2;
+		PairEndpoints.Emplace(FSG_GridCoordinate(0, Y, 0), FSG_GridCoordinate(GridLength - 1, Y, 0));
+	}
+	PairEndpoints.Emplace(FSG_GridCoordinate(0, 0, 0), FSG_GridCoordinate(GridLength - 1, NumLanes * LaneWidth - 1, 0));
+
+	// Long paths would hit the usual budget before the comparison means anything
+	const int32 PreviousMaxExpansionsPerPair = MaxExpansionsPerPair;
+	MaxExpansionsPerPair = GridLength * NumLanes * LaneWidth;
+
+	const FSG_GridCoordinate WestRoomOffset(-1, 0, 0);
+	const FSG_GridCoordinate EastRoomOffset(1, 0, 0);
+	for (const ECorridorSearchAlgorithm Algorithm : { ECorridorSearchAlgorithm::BinaryHeap, ECorridorSearchAlgorithm::JumpPointSearch })
+	{
+		RequestedCorridors.Reset();
+		LastSearchStats = FCorridorSearchStats();
+
+		const double StartTime = FPlatformTime::Seconds();
+		int32 NumPathsFound = 0;
+		int32 NumExpansions = 0;
+		for (const TPair<FSG_GridCoordinate, FSG_GridCoordinate>& Endpoints : PairEndpoints)
+		{
+			int32 NumPairExpansions = 0;
+			const bool bFoundPath = (Algorithm == ECorridorSearchAlgorithm::JumpPointSearch)
+				? FindPath_JumpPoint(Endpoints.Key, Endpoints.Key + WestRoomOffset, Endpoints.Value, Endpoints.Value + EastRoomOffset, NumPairExpansions)
+				: FindPath_Dense(Endpoints.Key, Endpoints.Key + WestRoomOffset, Endpoints.Value, Endpoints.Value + EastRoomOffset, NumPairExpansions);
+			NumPathsFound += bFoundPath ? 1 : 0;
+			NumExpansions += NumPairExpansions;
+		}
+
+		UE_LOG(LogCityGen, Display, TEXT("Benchmark long straights %s: paths=%d/%d corridor cells=%d expansions=%d time=%.3f ms"),
+			*UEnum::GetValueAsString(Algorithm),
+			NumPathsFound,
+			PairEndpoints.Num(),
+			RequestedCorridors.Num(),
+			NumExpansions,
+			(FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+
+	MaxExpansionsPerPair = PreviousMaxExpansionsPerPair;
+	ClearCorridorMeshes();
+	DungeonGridBounds = PreviousBounds;
+}
+
+void ADungeonGenerator_GridBased::BenchmarkGridKeys()
+{
+	TArray<FSG_GridCoordinate> Cells;
+	RequestedCorridors.GetKeys(Cells);
+
+	FRandomStream RandomStream(RandomSeed);
+	if (Cells.Num() == 0)
+	{
+		const FIntVector BoxSize(128, 128, 4);
+		for (int32 Z = 0; Z < BoxSize.Z; ++Z)
+		{
+			for (int32 Y = 0; Y < BoxSize.Y; ++Y)
+			{
+				for (int32 X = 0; X < BoxSize.X; ++X)
+				{
+					if (RandomStream.FRand() < 0.25f)
+					{
+						Cells.Add(FSG_GridCoordinate(X, Y, Z));
+					}
+				}
+			}
+		}
+	}
+
+	FCityGen_GridBounds Bounds;
+	for (const FSG_GridCoordinate& Cell : Cells)
+	{
+		Bounds.Add(Cell);
+	}
+
+	// Half of the queries are cells of the set, the other half any cell of the bounds
+	const int32 NumQueries = 1 << 20;
+	TArray<FSG_GridCoordinate> Queries;
+	Queries.Reserve(NumQueries);
+	for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+	{
+		if ((QueryIndex & 1) == 0)
+		{
+			Queries.Add(Cells[RandomStream.RandHelper(Cells.Num())]);
+		}
+		else
+		{
+			Queries.Add(FSG_GridCoordinate(
+				RandomStream.RandRange(Bounds.Min.X, Bounds.Max.X),
+				RandomStream.RandRange(Bounds.Min.Y, Bounds.Max.Y),
+				RandomStream.RandRange(Bounds.Min.Z, Bounds.Max.Z)));
+		}
+	}
+
+	auto LogResult = [&Cells, NumQueries](const TCHAR* Name, double BuildSeconds, double LookupSeconds, int32 NumFound, SIZE_T AllocatedSize)
+	{
+		UE_LOG(LogCityGen, Display, TEXT("Benchmark grid keys %s: cells=%d build=%.3f ms lookups=%.1f per us found=%d memory=%llu bytes"),
+			Name,
+			Cells.Num(),
+			BuildSeconds * 1000.0,
+			NumQueries / (FMath::Max(LookupSeconds, 1e-9) * 1000000.0),
+			NumFound,
+			(uint64)AllocatedSize);
+	};
+
+	{
+		double StartTime = FPlatformTime::Seconds();
+		TSet<FSG_GridCoordinate> Set;
+		for (const FSG_GridCoordinate& Cell : Cells)
+		{
+			Set.Add(Cell);
+		}
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		int32 NumFound = 0;
+		for (const FSG_GridCoordinate& Query : Queries)
+		{
+			NumFound += Set.Contains(Query) ? 1 : 0;
+		}
+		LogResult(TEXT("TSet<FSG_GridCoordinate>"), BuildSeconds, FPlatformTime::Seconds() - StartTime, NumFound, Set.GetAllocatedSize());
+	}
+
+	{
+		double StartTime = FPlatformTime::Seconds();
+		TSet<FSG_MortonKey> Set;
+		for (const FSG_GridCoordinate& Cell : Cells)
+		{
+			Set.Add(FSG_MortonKey(Cell));
+		}
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		int32 NumFound = 0;
+		for (const FSG_GridCoordinate& Query : Queries)
+		{
+			NumFound += Set.Contains(FSG_MortonKey(Query)) ? 1 : 0;
+		}
+		LogResult(TEXT("TSet<FSG_MortonKey>"), BuildSeconds, FPlatformTime::Seconds() - StartTime, NumFound, Set.GetAllocatedSize());
+	}
+
+	{
+		double StartTime = FPlatformTime::Seconds();
+		FSG_MortonCellSet Set;
+		for (const FSG_GridCoordinate& Cell : Cells)
+		{
+			Set.Add(Cell);
+		}
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		int32 NumFound = 0;
+		for (const FSG_GridCoordinate& Query : Queries)
+		{
+			NumFound += Set.Contains(Query) ? 1 : 0;
+		}
+		LogResult(TEXT("FSG_MortonCellSet"), BuildSeconds, FPlatformTime::Seconds() - StartTime, NumFound, Set.GetAllocatedSize());
+	}
+
+	// The sum keeps the compiler from removing the loops
+	uint64 Checksum = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (const FSG_GridCoordinate& Query : Queries)
+	{
+		Checksum += FSG_MortonKey::Encode(Query.X, Query.Y, Query.Z);
+	}
+	const double EncodeSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (const FSG_GridCoordinate& Query : Queries)
+	{
+		Checksum += FSG_MortonKey::EncodePortable(Query.X, Query.Y, Query.Z);
+	}
+	const double EncodePortableSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int32 NumMismatches = 0;
+	for (const FSG_GridCoordinate& Query : Queries)
+	{
+		const uint64 Code = FSG_MortonKey::Encode(Query.X, Query.Y, Query.Z);
+		const bool bMatches = (Code == FSG_MortonKey::EncodePortable(Query.X, Query.Y, Query.Z))
+			&& (FSG_MortonKey::Decode(Code) == Query)
+			&& (FSG_MortonKey::DecodePortable(Code) == Query);
+		NumMismatches += bMatches ? 0 : 1;
+	}
+
+	UE_LOG(LogCityGen, Display, TEXT("Benchmark grid keys encode (%s): %.1f per us, portable: %.1f per us, round trip mismatches=%d, checksum=%llu"),
+		SG_MORTON_USE_BMI2 ? TEXT("BMI2") : TEXT("portable"),
+		NumQueries / (FMath::Max(EncodeSeconds, 1e-9) * 1000000.0),
+		NumQueries / (FMath::Max(EncodePortableSeconds, 1e-9) * 1000000.0),
+		NumMismatches,
+		Checksum);
+}
+
+void ADungeonGenerator_GridBased::ValidateCorridorPieceTable()
+{
+	const FCorridorPieceTable& Table = FCorridorPieceTable::Get();
+
+	int32 NumErrors = 0;
+	int32 NumValidMasks = 0;
+	for (int32 Mask = 0; Mask < CellConnectionMask::NumMasks; ++Mask)
+	{
+		const FCorridorPieceTable::FEntry& Entry = Table.Entries[Mask];
+		const uint8 Horizontal = Mask & CellConnectionMask::Horizontal;
+		const bool bUp = (Mask & CellConnectionMask::Up) != 0;
+		const bool bDown = (Mask & CellConnectionMask::Down) != 0;
+		const int32 NumHorizontal = (int32)FMath::CountBits(Horizontal);
+
+		// Expected piece, written from the connections only
+		bool bExpectValid = true;
+		ECorridorPieceType ExpectedType = ECorridorPieceType::Straight;
+		if (bUp || bDown)
+		{
+			ExpectedType = (bUp && bDown) ? ECorridorPieceType::ElevatorUpAndDown : (bUp ? ECorridorPieceType::ElevatorUp : ECorridorPieceType::ElevatorDown);
+		}
+		else if (NumHorizontal == 4)
+		{
+			ExpectedType = ECorridorPieceType::CrossJunction;
+		}
+		else if (NumHorizontal == 3)
+		{
+			ExpectedType = ECorridorPieceType::TJunction;
+		}
+		else if (NumHorizontal == 2)
+		{
+			const bool bOpposite = (Horizontal == (CellConnectionMask::North | CellConnectionMask::South)) || (Horizontal == (CellConnectionMask::East | CellConnectionMask::West));
+			ExpectedType = bOpposite ? ECorridorPieceType::Straight : ECorridorPieceType::Corner;
+		}
+		else
+		{
+			bExpectValid = false; // Dead end or isolated cell
+		}
+
+		bool bEntryOk = (Entry.bValid == bExpectValid) && (!bExpectValid || (Entry.Type == ExpectedType));
+
+		// Yaws the spawn functions used before the table, written out per piece: the entry must give exactly these
+		TArray<float, TInlineAllocator<4>> ExpectedYaws;
+		if (bUp || bDown)
+		{
+			ExpectedYaws = { 0.0f };
+		}
+		else if (ExpectedType == ECorridorPieceType::CrossJunction)
+		{
+			ExpectedYaws = { 0.0f, 90.0f, 180.0f, -90.0f };
+		}
+		else if (ExpectedType == ECorridorPieceType::TJunction)
+		{
+			const uint8 Missing = CellConnectionMask::Horizontal & ~Horizontal;
+			ExpectedYaws = { (Missing == CellConnectionMask::West) ? 0.0f : (Missing == CellConnectionMask::North) ? 90.0f : (Missing == CellConnectionMask::East) ? 180.0f : -90.0f };
+		}
+		else if (Horizontal == (CellConnectionMask::North | CellConnectionMask::South))
+		{
+			ExpectedYaws = { 0.0f, 180.0f };
+		}
+		else if (Horizontal == (CellConnectionMask::East | CellConnectionMask::West))
+		{
+			ExpectedYaws = { 90.0f, -90.0f };
+		}
+		else if (ExpectedType == ECorridorPieceType::Corner)
+		{
+			const bool bNorth = (Horizontal & CellConnectionMask::North) != 0;
+			const bool bEast = (Horizontal & CellConnectionMask::East) != 0;
+			ExpectedYaws = { bNorth ? (bEast ? 0.0f : -90.0f) : (bEast ? 90.0f : 180.0f) };
+		}
+
+		// Compared as sets of quarter turns, -90 and 270 are the same yaw
+		auto GetQuarterTurnsMask = [](float Yaw) -> uint8
+		{
+			const int32 NumQuarterTurns = FMath::RoundToInt(Yaw / 90.0f);
+			return FMath::IsNearlyEqual(Yaw, NumQuarterTurns * 90.0f) ? (uint8)(1 << (((NumQuarterTurns % 4) + 4) % 4)) : 0;
+		};
+		if (bEntryOk && bExpectValid)
+		{
+			uint8 ExpectedQuarterTurns = 0;
+			for (const float Yaw : ExpectedYaws)
+			{
+				ExpectedQuarterTurns |= GetQuarterTurnsMask(Yaw);
+			}
+			uint8 EntryQuarterTurns = 0;
+			for (int32 YawVariant = 0; YawVariant < Entry.NumYawVariants; ++YawVariant)
+			{
+				const uint8 QuarterTurns = GetQuarterTurnsMask(Entry.BaseYaw + YawVariant * 360.0f / Entry.NumYawVariants);
+				bEntryOk &= (QuarterTurns != 0);
+				EntryQuarterTurns |= QuarterTurns;
+			}
+			bEntryOk &= (Entry.NumYawVariants == ExpectedYaws.Num()) && (EntryQuarterTurns == ExpectedQuarterTurns);
+		}
+
+		if (!bEntryOk)
+		{
+			UE_LOG(LogCityGen, Error, TEXT("Corridor piece table: mask 0x%02x gives %s (valid=%d, yaw=%.0f, %d variants), expected %s (valid=%d, yaw=%.0f, %d variants)"),
+				Mask, *UEnum::GetValueAsString(Entry.Type), Entry.bValid ? 1 : 0, Entry.BaseYaw, Entry.NumYawVariants,
+				*UEnum::GetValueAsString(ExpectedType), bExpectValid ? 1 : 0, (ExpectedYaws.Num() > 0) ? ExpectedYaws[0] : 0.0f, ExpectedYaws.Num());
+			NumErrors++;
+		}
+		NumValidMasks += Entry.bValid ? 1 : 0;
+	}
+
+	UE_LOG(LogCityGen, Display, TEXT("Corridor piece table: %d masks checked, %d with a piece, %d errors"), CellConnectionMask::NumMasks, NumValidMasks, NumErrors);
+}
+
+#endif // WITH_EDITOR
+
+#if 0
+void ADungeonGenerator_GridBased::UpdateBlockedTiles_Obstacles()
+{
+	for (AActor* Obstacle : Obstacles)
+	{
+		if (Obstacle == nullptr)
+		{
+			continue;
+		}
+
+		ACityGen_ObstacleBase* ObstacleBase = Cast<ACityGen_ObstacleBase>(Obstacle);
+		if (!ObstacleBase)
+		{
+			continue;
+		}
+
+		// Get world grid coords directly
+		TArray<FSG_GridCoordinate> WorldAffectedTiles =
+			ObstacleBase->GetWorldTilesOverlappingBounds(ObstacleBase->GetObstacleBounds(), 1.0f);
+
+		for (const FSG_GridCoordinate& Tile : WorldAffectedTiles)
+		{
+			BlockedGridTiles.Set(Tile); // Already in world coords
+		}
+	}
+}
+#endif
+
+void ADungeonGenerator_GridBased::UpdateBlockedTiles_ClosedExits()
+{
+	if(bUseBlockedExit == false)
+	{
+		return;
+	}
+
+	for (ACityGen_RoomBase* Room : AllRooms)
+	{
+		const TArray<FExitArrowData>& CachedBlockedExitPoints = Room->GetCachedBlockedExitPointsData();
+		for (const FExitArrowData& BlockedExitData : CachedBlockedExitPoints)
+		{
+			BlockedGridTiles.Set(BlockedExitData.DungeonGridCoord.position);
+		}
+	}
+}
+
+void ADungeonGenerator_GridBased::UpdateBlockedTiles_RoomBounds()
+{
+	for (ACityGen_RoomBase* RoomBase : AllRooms)
+	{
+		if (RoomBase == nullptr)
+		{
+			continue;
+		}
+
+		// Whole X runs are written a word at a time
+		for (const FBoundCoords& RoomBound : RoomBase->GetCachedBoundsDungeonGridCoord())
+		{
+			BlockedGridTiles.SetBox(RoomBound.Min.SnapToGrid(), RoomBound.Max.SnapToGrid(), true);
+		}
+	}
+}
+
+void ADungeonGenerator_GridBased::UpdateBlockedTiles_TilesToIgnore()
+{
+	for (FSG_GridCoordinate Tiles : TilesToIgnore)
+	{
+		BlockedGridTiles.Clear(Tiles);
+	}
+}
+
+// Should be called after SnapRoomsToGrid, as it rely on the rooms grid coord caches
+void ADungeonGenerator_GridBased::UpdateDungeonGridBounds()
+{
+	DungeonGridBounds.Reset();
+
+	for (ACityGen_RoomBase* RoomBase : AllRooms)
+	{
+		if (RoomBase == nullptr)
+		{
+			continue;
+		}
+
+		for (const FBoundCoords& RoomBound : RoomBase->GetCachedBoundsDungeonGridCoord())
+		{
+			DungeonGridBounds.Add(RoomBound.Min.SnapToGrid());
+			DungeonGridBounds.Add(RoomBound.Max.SnapToGrid());
+		}
+		for (const FExitArrowData& ExitData : RoomBase->GetCachedExitPointsData())
+		{
+			DungeonGridBounds.Add(ExitData.DungeonGridCoord.position);
+			DungeonGridBounds.Add(ExitData.DungeonDoorGridCoord);
+		}
+		for (const FExitArrowData& BlockedExitData : RoomBase->GetCachedBlockedExitPointsData())
+		{
+			DungeonGridBounds.Add(BlockedExitData.DungeonGridCoord.position);
+		}
+	}
+
+	DungeonGridBounds.ExpandBy(SearchBoundsMargin);
+}
+
+// @param OutVector: Return location in world space of the first gridCoord of the path
+// @return: false if failed to find a path within the recursive loop hard coded limit
+bool ADungeonGenerator_GridBased::FindPath(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int32 NumAllocationsBefore = SearchWorkspaces[0].GetNumAllocations() + SearchWorkspaces[1].GetNumAllocations();
+
+	// A search stopped by the time limit depends on the machine, its path is not a cached answer for these doors
+	const bool bIsSearchTimeLimited = (MaxSearchTimeMsPerPair > 0.0f) && (CorridorSearchAlgorithm == ECorridorSearchAlgorithm::BinaryHeap) && bUseDenseSearchStorage;
+	const bool bCachePath = bUsePathCache && !bIsSearchTimeLimited;
+
+	FCityGen_PathCacheKey CacheKey;
+	TArray<FCorridorPairRecord::FLink> CapturedLinks;
+	if (bCachePath)
+	{
+		CacheKey = MakePathCacheKey(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords);
+		if (ReplayCachedPath(CacheKey))
+		{
+			LastSearchStats.NumPathCacheHits++;
+			LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			return true;
+		}
+		LastSearchStats.NumPathCacheMisses++;
+		PathCacheCapture = &CapturedLinks;
+	}
+
+	int32 NumExpansions = 0;
+	bool bFoundPath = false;
+	switch (CorridorSearchAlgorithm)
+	{
+	case ECorridorSearchAlgorithm::LinearScan:
+		bFoundPath = FindPath_LinearScan(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		break;
+	case ECorridorSearchAlgorithm::JumpPointSearch:
+		bFoundPath = FindPath_JumpPoint(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		break;
+	case ECorridorSearchAlgorithm::Bidirectional:
+		bFoundPath = FindPath_Bidirectional(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		break;
+	case ECorridorSearchAlgorithm::Hierarchical:
+		bFoundPath = FindPath_Hierarchical(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		break;
+	case ECorridorSearchAlgorithm::BucketQueue:
+		bFoundPath = FindPath_BucketQueue(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		break;
+	case ECorridorSearchAlgorithm::BinaryHeap:
+	default:
+		if (bUseDenseSearchStorage)
+		{
+			bFoundPath = FindPath_Dense(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		}
+		else
+		{
+			bFoundPath = FindPath_BinaryHeap(StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords, NumExpansions);
+		}
+		break;
+	}
+
+	PathCacheCapture = nullptr;
+	if (bCachePath && bFoundPath)
+	{
+		if (PathCache.Max() != PathCacheSize)
+		{
+			PathCache.Empty(FMath::Max(PathCacheSize, 1));
+		}
+		PathCache.Add(CacheKey, MoveTemp(CapturedLinks));
+	}
+
+	LastSearchStats.NumSearches++;
+	LastSearchStats.NumFailedSearches += bFoundPath ? 0 : 1;
+	LastSearchStats.NumExpansions += NumExpansions;
+	LastSearchStats.NumAllocations += SearchWorkspaces[0].GetNumAllocations() + SearchWorkspaces[1].GetNumAllocations() - NumAllocationsBefore;
+	LastSearchStats.SearchTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	return bFoundPath;
+}
+
+FCityGen_PathCacheKey ADungeonGenerator_GridBased::MakePathCacheKey(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords) const
+{
+	FCityGen_PathCacheKey Key;
+	Key.StartDoor = StartDoorGridCoords;
+	Key.StartRoom = StartRoomGridCoords;
+	Key.EndDoor = EndDoorGridCoords;
+	Key.EndRoom = EndRoomGridCoords;
+
+	FCityGen_GridBounds Region;
+	Region.Add(StartDoorGridCoords);
+	Region.Add(EndDoorGridCoords);
+	Region.ExpandBy(PathCacheRegionMargin);
+
+	// The same query gives another path with other search settings
+	uint32 Hash = GetTypeHash(CorridorSearchAlgorithm);
+	Hash = HashCombineFast(Hash, GetTypeHash(bUseDenseSearchStorage));
+	Hash = HashCombineFast(Hash, GetTypeHash(DistanceFactorForZ));
+	Hash = HashCombineFast(Hash, GetTypeHash(HierarchicalChunkSize));
+	Hash = HashCombineFast(Hash, GetTypeHash(HeuristicWeight));
+	Hash = HashCombineFast(Hash, GetTypeHash(bUseAnytimeSearch));
+	Hash = HashCombineFast(Hash, GetTypeHash(AnytimeWeightStep));
+	Hash = HashCombineFast(Hash, GetTypeHash(MaxExpansionsPerPair));
+	Hash = HashCombineFast(Hash, BlockedGridTiles.GetBoxHash(Region.Min, Region.Max));
+
+	// Only the presence of the corridor cells is hashed: the searches read nothing else from them (the step discount),
+	// and replaying the links merges them with the connections already there, like committing the searched path would
+	// Summed so the iteration order of the store does not matter
+	uint32 CorridorHash = 0;
+	RequestedCorridors.ForEach([&Region, &CorridorHash](const FSG_GridCoordinate& Coord, const FCellConnectionState& Connection)
+	{
+		if (Region.Contains(Coord))
+		{
+			CorridorHash += HashCombineFast(GetTypeHash(Coord), 0x9e3779b9);
+		}
+	});
+	Key.RegionHash = HashCombineFast(Hash, CorridorHash);
+	return Key;
+}
+
+bool ADungeonGenerator_GridBased::ReplayCachedPath(const FCityGen_PathCacheKey& Key)
+{
+	const TArray<FCorridorPairRecord::FLink>* pCachedLinks = PathCache.FindAndTouch(Key);
+	if (pCachedLinks == nullptr)
+	{
+		return false;
+	}
+
+	// Cells out of the region are not in the key, the room cells at the end of the links are blocked
+	const bool bIsStillValid = !pCachedLinks->ContainsByPredicate([this](const FCorridorPairRecord::FLink& Link)
+	{
+		return IsCellClosedToCorridors(Link.Coord);
+	});
+	if (!bIsStillValid)
+	{
+		PathCache.Remove(Key);
+		return false;
+	}
+
+	TArray<FSG_GridCoordinate> PathCells;
+	for (const FCorridorPairRecord::FLink& Link : *pCachedLinks)
+	{
+		AddCorridorConnection(Link.Coord, Link.OtherCoord, Link.bIsARoom);
+		PathCells.AddUnique(Link.Coord);
+	}
+	if (CorridorSearchAlgorithm == ECorridorSearchAlgorithm::Hierarchical)
+	{
+		HierarchicalPlanner.OnCorridorCellsAdded(PathCells);
+	}
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND (cached)"));
+	return true;
+}
+
+// Reference implementation: the open set is scanned linearly for the lowest F cost at each iteration
+bool ADungeonGenerator_GridBased::FindPath_LinearScan(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	TMap<FSG_GridCoordinate, FCityGen_NodeCoord> OpenNodesMap;
+	TMap<FSG_GridCoordinate, FCityGen_NodeCoord> ClosedNodesMap;
+	TArray<FSG_GridCoordinate> OpenSet;
+	TArray<FSG_GridCoordinate> ClosedSet;
+	const FCityGen_IntegerCostModel CostModel(DistanceFactorForZ);
+
+	FCityGen_NodeCoord StartNode;
+
+	StartNode.GCost = 0;
+	StartNode.HCost = 0;
+	StartNode.NodeCoordinate = StartDoorGridCoords;
+	StartNode.bHaveParent = false;
+	StartNode.ParentCoordinate = StartDoorGridCoords;
+
+	FCityGen_NodeCoord EndNode;
+
+	EndNode.NodeCoordinate = EndDoorGridCoords;
+	EndNode.bHaveParent = false;
+	EndNode.ParentCoordinate = EndDoorGridCoords;
+
+	OpenSet.Add(StartDoorGridCoords); // Add Start node to Open set
+	OpenNodesMap.Add(StartDoorGridCoords, StartNode);
+
+	int32 numIterations = 0;
+	const int32 maxIterations = MaxExpansionsPerPair; // To avoid infinite loop in case of setting mistake
+	while (OpenSet.Num() && numIterations <= maxIterations)
+	{
+		numIterations = numIterations + 1;
+		OutNumExpansions = numIterations;
+		if (numIterations > maxIterations)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
+			return false;
+		}
+		
+		FSG_GridCoordinate CurrentCoords = OpenSet[0];
+		FCityGen_NodeCoord CurrentNode = OpenNodesMap[CurrentCoords];
+
+		for (int32 i = 0; i < OpenSet.Num(); i++) // Find node with lowest fCost in Open set
+		{
+			// check distance logic
+			if (OpenNodesMap[OpenSet[i]].ComputeFCost() <= OpenNodesMap[CurrentCoords].ComputeFCost())
+			{
+				CurrentCoords = OpenSet[i];
+				CurrentNode = OpenNodesMap[CurrentCoords];
+			}
+		}
+
+		// Move node from Open set to Closed set
+		OpenSet.Remove(CurrentCoords);
+		OpenNodesMap.Remove(CurrentCoords);
+		ClosedSet.Add(CurrentCoords);
+		ClosedNodesMap.Add(CurrentCoords, CurrentNode);
+
+		#if 0
+			// DEBUG
+			UE_LOG(LogCityGen, Log, TEXT("OpenSet Size: %d"), OpenSet.Num());
+			
+			UKismetSystemLibrary::DrawDebugBox(
+				this,
+				DungeonGridCmpt->GridToWorld(StartDoorGridCoords) + TileSize / 2.0,
+				TileSize / 2.0,
+				FLinearColor::Red,
+				FRotator::ZeroRotator,
+				10.1f
+			);
+
+			UKismetSystemLibrary::DrawDebugBox(
+				this,
+				DungeonGridCmpt->GridToWorld(EndDoorGridCoords) + TileSize / 2.0,
+				TileSize / 2.0,
 				FLinearColor::Yellow,
 				FRotator::ZeroRotator,
 				10.1f
 			);
 		#endif
 
-		if (CurrentCoords == EndDoorGridCoords)
+		if (CurrentCoords == EndDoorGridCoords)
+		{
+			// We need to add the room location in order that the corridors spawning take them in account
+			AddCorridorConnection(StartDoorGridCoords, StartRoomGridCoords, true);
+			AddCorridorConnection(EndDoorGridCoords, EndRoomGridCoords, true);
+
+			UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+			RetracePath(StartDoorGridCoords, EndDoorGridCoords, ClosedNodesMap);
+			return true;
+		}
+
+		// For each neighbor of current node:
+		FSG_GridCoordinate Neighbours[FSG_GridNeighbours::Num3D];
+		FSG_GridNeighbours::GetNeighbours(CurrentCoords, Neighbours);
+
+		for (int32 i = 0; i < FSG_GridNeighbours::Num3D; i++)
+		{
+			// Adding nodes
+			const FSG_GridCoordinate& CurrentNeighbourCoordinate = Neighbours[i];
+
+			if (IsGridTileBlocked(CurrentNeighbourCoordinate))
+			{
+				continue;
+			}
+
+			// The cost is lower if this is already used in a previous path
+			int32 MovementCost = CostModel.GetStepCost(CurrentCoords, CurrentNeighbourCoordinate, RequestedCorridors.Contains(CurrentNeighbourCoordinate));
+
+			int32 CurrentNeighbour_NewGCost = CurrentNode.GCost + MovementCost;
+			int32 CurrentNeighbour_NewHCost = CostModel.GetDistance(Neighbours[i], EndDoorGridCoords);
+			int32 CurrentNeighbour_NewFCost = CurrentNeighbour_NewHCost + CurrentNeighbour_NewGCost;
+
+			if (ClosedNodesMap.Contains(CurrentNeighbourCoordinate))
+			{
+				const FCityGen_NodeCoord& AlreadyVisitedNode = ClosedNodesMap[CurrentNeighbourCoordinate];
+				if (AlreadyVisitedNode.ComputeFCost() < CurrentNeighbour_NewFCost)
+				{
+					continue;
+				}
+			}
+
+			if (OpenNodesMap.Contains(CurrentNeighbourCoordinate))
+			{
+				FCityGen_NodeCoord& AlreadyVisitedNode = OpenNodesMap[CurrentNeighbourCoordinate];
+				if (AlreadyVisitedNode.ComputeFCost() < CurrentNeighbour_NewFCost)
+				{
+					continue;
+				}
+				
+				AlreadyVisitedNode.GCost = CurrentNeighbour_NewGCost;
+				AlreadyVisitedNode.HCost = CurrentNeighbour_NewHCost;
+				AlreadyVisitedNode.bHaveParent = true;
+				AlreadyVisitedNode.ParentCoordinate = CurrentCoords;
+			}
+			else
+			{
+				FCityGen_NodeCoord NewNeighbourNode;
+				NewNeighbourNode.GCost = CurrentNeighbour_NewGCost;
+				NewNeighbourNode.HCost = CurrentNeighbour_NewHCost;
+				NewNeighbourNode.bHaveParent = true;
+				NewNeighbourNode.ParentCoordinate = CurrentCoords;
+				NewNeighbourNode.NodeCoordinate = CurrentNeighbourCoordinate;
+
+				OpenSet.Add(CurrentNeighbourCoordinate);
+				OpenNodesMap.Add(CurrentNeighbourCoordinate, NewNeighbourNode);
+			}
+		}
+	}
+
+	UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), numIterations);
+	return false;
+}
+
+namespace
+{
+	// Entry of the binary heap open set
+	// Entries are never removed from the heap when a node is improved or closed, stale entries are skipped when popped
+	struct FCorridorOpenEntry
+	{
+		int32 FCost = 0;
+		int32 HCost = 0;
+		int32 GCost = 0; // GCost of the node when pushed, used to detect stale entries
+		uint32 Sequence = 0; // Push order
+		FSG_GridCoordinate Coord = {};
+	};
+
+	// Lowest F cost first, then lowest H cost (closest to the goal), then first pushed
+	// This makes the expansion order fully deterministic for a given set of rooms
+	struct FCorridorOpenEntryPredicate
+	{
+		FORCEINLINE bool operator()(const FCorridorOpenEntry& A, const FCorridorOpenEntry& B) const
+		{
+			if (A.FCost != B.FCost)
+			{
+				return A.FCost < B.FCost;
+			}
+			if (A.HCost != B.HCost)
+			{
+				return A.HCost < B.HCost;
+			}
+			return A.Sequence < B.Sequence;
+		}
+	};
+}
+
+// Same search as FindPath_LinearScan, but the lowest F cost node is popped from a binary heap
+bool ADungeonGenerator_GridBased::FindPath_BinaryHeap(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	TMap<FSG_GridCoordinate, FCityGen_NodeCoord> OpenNodesMap;
+	TMap<FSG_GridCoordinate, FCityGen_NodeCoord> ClosedNodesMap;
+	TArray<FCorridorOpenEntry> OpenHeap;
+	const FCorridorOpenEntryPredicate OpenHeapPredicate;
+	uint32 PushSequence = 0;
+	const FCityGen_IntegerCostModel CostModel(DistanceFactorForZ);
+
+	auto PushOpenNode = [&OpenHeap, &OpenHeapPredicate, &PushSequence](const FCityGen_NodeCoord& Node)
+	{
+		FCorridorOpenEntry Entry;
+		Entry.FCost = Node.ComputeFCost();
+		Entry.HCost = Node.HCost;
+		Entry.GCost = Node.GCost;
+		Entry.Sequence = PushSequence++;
+		Entry.Coord = Node.NodeCoordinate;
+		OpenHeap.HeapPush(Entry, OpenHeapPredicate);
+	};
+
+	FCityGen_NodeCoord StartNode;
+	StartNode.GCost = 0;
+	StartNode.HCost = 0;
+	StartNode.NodeCoordinate = StartDoorGridCoords;
+	StartNode.bHaveParent = false;
+	StartNode.ParentCoordinate = StartDoorGridCoords;
+
+	OpenNodesMap.Add(StartDoorGridCoords, StartNode);
+	PushOpenNode(StartNode);
+
+	int32 numIterations = 0;
+	const int32 maxIterations = MaxExpansionsPerPair; // To avoid infinite loop in case of setting mistake
+	while (OpenHeap.Num() > 0)
+	{
+		FCorridorOpenEntry Entry;
+		OpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+
+		const FCityGen_NodeCoord* OpenNode = OpenNodesMap.Find(Entry.Coord);
+		if ((OpenNode == nullptr) || (OpenNode->GCost != Entry.GCost))
+		{
+			continue; // Stale entry: the node was closed or improved after this push
+		}
+
+		numIterations = numIterations + 1;
+		OutNumExpansions = numIterations;
+		if (numIterations > maxIterations)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
+			return false;
+		}
+
+		// Move node from Open set to Closed set
+		const FSG_GridCoordinate CurrentCoords = Entry.Coord;
+		const FCityGen_NodeCoord CurrentNode = *OpenNode;
+		OpenNodesMap.Remove(CurrentCoords);
+		ClosedNodesMap.Add(CurrentCoords, CurrentNode);
+
+		if (CurrentCoords == EndDoorGridCoords)
+		{
+			// We need to add the room location in order that the corridors spawning take them in account
+			AddCorridorConnection(StartDoorGridCoords, StartRoomGridCoords, true);
+			AddCorridorConnection(EndDoorGridCoords, EndRoomGridCoords, true);
+
+			UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+			RetracePath(StartDoorGridCoords, EndDoorGridCoords, ClosedNodesMap);
+			return true;
+		}
+
+		// For each neighbor of current node, same order as GetNeighbourNodes3D without allocating an array
+		for (const FSG_GridCoordinate& DirectionOffset : FCityGen_DenseSearchStorage::DirectionOffsets)
+		{
+			const FSG_GridCoordinate CurrentNeighbourCoordinate = CurrentCoords + DirectionOffset;
+			if (IsGridTileBlocked(CurrentNeighbourCoordinate))
+			{
+				continue;
+			}
+
+			// The cost is lower if this is already used in a previous path
+			int32 MovementCost = CostModel.GetStepCost(CurrentCoords, CurrentNeighbourCoordinate, RequestedCorridors.Contains(CurrentNeighbourCoordinate));
+
+			int32 CurrentNeighbour_NewGCost = CurrentNode.GCost + MovementCost;
+			int32 CurrentNeighbour_NewHCost = CostModel.GetDistance(CurrentNeighbourCoordinate, EndDoorGridCoords);
+			int32 CurrentNeighbour_NewFCost = CurrentNeighbour_NewHCost + CurrentNeighbour_NewGCost;
+
+			// The heuristic is not consistent with the corridor cost reduction, so a closed node can be re-opened
+			// It stays in the closed map (as the path retrace may go through it) until it is expanded again
+			if (const FCityGen_NodeCoord* AlreadyClosedNode = ClosedNodesMap.Find(CurrentNeighbourCoordinate))
+			{
+				if (AlreadyClosedNode->ComputeFCost() <= CurrentNeighbour_NewFCost)
+				{
+					continue;
+				}
+			}
+
+			FCityGen_NodeCoord* NeighbourNode = OpenNodesMap.Find(CurrentNeighbourCoordinate);
+			if (NeighbourNode != nullptr)
+			{
+				if (NeighbourNode->ComputeFCost() <= CurrentNeighbour_NewFCost)
+				{
+					continue;
+				}
+			}
+			else
+			{
+				NeighbourNode = &OpenNodesMap.Add(CurrentNeighbourCoordinate);
+				NeighbourNode->NodeCoordinate = CurrentNeighbourCoordinate;
+			}
+
+			NeighbourNode->GCost = CurrentNeighbour_NewGCost;
+			NeighbourNode->HCost = CurrentNeighbour_NewHCost;
+			NeighbourNode->bHaveParent = true;
+			NeighbourNode->ParentCoordinate = CurrentCoords;
+			PushOpenNode(*NeighbourNode);
+		}
+	}
+
+	UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), numIterations);
+	return false;
+}
+
+// Same search as FindPath_BinaryHeap, but the nodes live in flat arrays covering DungeonGridBounds
+// instead of hash maps, and the costs are float (the Z factor is not rounded)
+bool ADungeonGenerator_GridBased::FindPath_Dense(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	TArray<FSG_GridCoordinate> Path;
+	FCityGen_DenseSearchResult Result;
+	const bool bFoundPath = SearchPath_Dense(SearchWorkspaces[0], StartDoorGridCoords, EndDoorGridCoords, bUseAnytimeSearch, true, Path, Result);
+
+	// FindPath adds the expansions to the stats
+	OutNumExpansions = Result.NumExpansions;
+	Result.NumExpansions = 0;
+	LastSearchStats.AddDenseSearchResult(Result, bFoundPath);
+	if (!bFoundPath)
+	{
+		return false;
+	}
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+	CommitPath(Path, StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords);
+	return true;
+}
+
+bool ADungeonGenerator_GridBased::SearchPath_Dense(FCityGen_SearchWorkspace& Workspace, const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, bool bAnytime, bool bUseTimeLimit, TArray<FSG_GridCoordinate>& OutPath, FCityGen_DenseSearchResult& OutResult) const
+{
+	OutPath.Reset();
+	OutResult = FCityGen_DenseSearchResult();
+
+	const double DeadlineSeconds = (bUseTimeLimit && (MaxSearchTimeMsPerPair > 0.0f)) ? (FPlatformTime::Seconds() + MaxSearchTimeMsPerPair / 1000.0) : TNumericLimits<double>::Max();
+
+	// Restarting weighted A*: every search starts from scratch with a lower weight, each one usually finds a cheaper path
+	// The expansion budget and the deadline are shared by all the searches of the pair
+	float Weight = HeuristicWeight;
+	TArray<FSG_GridCoordinate> Path;
+	while (true)
+	{
+		FCityGen_DenseSearchState State;
+		if (!BeginSearch_Dense(Workspace, State, MakeArrayView(&StartDoorGridCoords, 1), MakeArrayView(&EndDoorGridCoords, 1), Weight))
+		{
+			break;
+		}
+		State.MaxIterations = MaxExpansionsPerPair - OutResult.NumExpansions;
+
+		const ECityGen_SearchStatus Status = ContinueSearch_Dense(Workspace, State, DeadlineSeconds, Path);
+		OutResult.NumExpansions += State.NumIterations;
+		OutResult.MaxPoppedFCost = State.MaxPoppedFCost;
+		if (Status == ECityGen_SearchStatus::InProgress)
+		{
+			// Out of time
+			Workspace.EndSearch();
+			break;
+		}
+		if (Status == ECityGen_SearchStatus::Failed)
+		{
+			break;
+		}
+
+		OutResult.CostLowerBound = FMath::Max(OutResult.CostLowerBound, State.CostLowerBound);
+		if ((OutPath.Num() == 0) || (State.PathCost < OutResult.PathCost))
+		{
+			OutResult.NumImprovements += (OutPath.Num() > 0) ? 1 : 0;
+			OutResult.PathCost = State.PathCost;
+			Swap(OutPath, Path);
+		}
+
+		const bool bIsOptimal = (OutResult.PathCost <= OutResult.CostLowerBound);
+		if (!bAnytime || bIsOptimal || (Weight <= 1.0f) || (OutResult.NumExpansions >= MaxExpansionsPerPair))
+		{
+			break;
+		}
+		Weight = FMath::Max(Weight - AnytimeWeightStep, 1.0f);
+		OutResult.NumRestarts++;
+	}
+	return OutPath.Num() > 0;
+}
+
+bool ADungeonGenerator_GridBased::BeginSearch_Dense(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& EndDoorGridCoords) const
+{
+	return BeginSearch_Dense(Workspace, State, MakeArrayView(&StartDoorGridCoords, 1), MakeArrayView(&EndDoorGridCoords, 1), HeuristicWeight);
+}
+
+bool ADungeonGenerator_GridBased::BeginSearch_Dense(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, TArrayView<const FSG_GridCoordinate> StartCoords, TArrayView<const FSG_GridCoordinate> GoalCoords, float InHeuristicWeight) const
+{
+	check(StartCoords.Num() > 0 && GoalCoords.Num() > 0);
+
+	// Cells outside of the bounds can not be reached, the search runs with the other ones
+	const auto IsInBounds = [this](const FSG_GridCoordinate& Coord) { return DungeonGridBounds.Contains(Coord); };
+	const int32 NumStartsInBounds = Algo::CountIf(StartCoords, IsInBounds);
+	const int32 NumGoalsInBounds = Algo::CountIf(GoalCoords, IsInBounds);
+	if ((NumStartsInBounds == 0) || (NumGoalsInBounds == 0))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Door outside of the dungeon grid bounds, can not find a path"));
+		return false;
+	}
+	if ((NumStartsInBounds < StartCoords.Num()) || (NumGoalsInBounds < GoalCoords.Num()))
+	{
+		UE_LOG(LogCityGen, Verbose, TEXT("Search ignores %d starts and %d goals outside of the dungeon grid bounds"),
+			StartCoords.Num() - NumStartsInBounds, GoalCoords.Num() - NumGoalsInBounds);
+	}
+
+	Workspace.BeginSearch(DungeonGridBounds);
+
+	State = FCityGen_DenseSearchState();
+	State.HeuristicWeight = FMath::Max(InHeuristicWeight, 1.0f);
+	State.MaxIterations = MaxExpansionsPerPair;
+	State.GoalBounds.Reset();
+	const bool bExactHeuristic = (NumGoalsInBounds <= FCityGen_DenseSearchState::MaxExactHeuristicGoals);
+	for (const FSG_GridCoordinate& Coord : GoalCoords)
+	{
+		if (!IsInBounds(Coord))
+		{
+			continue;
+		}
+		if (bExactHeuristic)
+		{
+			State.Goals.Add(Coord);
+		}
+		State.GoalBounds.Add(Coord);
+		Workspace.Storage.SetGoal(Workspace.Storage.ToIndex(Coord));
+	}
+
+	for (const FSG_GridCoordinate& Coord : StartCoords)
+	{
+		if (!IsInBounds(Coord))
+		{
+			continue;
+		}
+		const int32 StartIndex = Workspace.Storage.ToIndex(Coord);
+		if (Workspace.Storage.IsOpen(StartIndex))
+		{
+			continue; // Two exits on the same cell
+		}
+		Workspace.Storage.SetGCost(StartIndex, 0.0f);
+		Workspace.PushOpenNode(StartIndex, 0.0f, State.HeuristicWeight * GetDistanceToClosestGoal(Coord, State), State.PushSequence++);
+	}
+	return true;
+}
+
+ECityGen_SearchStatus ADungeonGenerator_GridBased::ContinueSearch_Dense(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, double DeadlineSeconds, TArray<FSG_GridCoordinate>& OutPath) const
+{
+	FCityGen_DenseSearchStorage& Storage = Workspace.Storage;
+	TArray<FCityGen_DenseOpenEntry>& OpenHeap = Workspace.OpenHeap;
+	const FCityGen_DenseOpenEntryPredicate OpenHeapPredicate;
+
+	// Reading the time has a cost, only done every few expansions. At least one node is expanded per call
+	const int32 NumExpansionsBetweenTimeChecks = 32;
+	int32 NumExpansionsInCall = 0;
+
+	while (OpenHeap.Num() > 0)
+	{
+		if ((NumExpansionsInCall > 0) && ((NumExpansionsInCall % NumExpansionsBetweenTimeChecks) == 0) && (FPlatformTime::Seconds() >= DeadlineSeconds))
+		{
+			return ECityGen_SearchStatus::InProgress;
+		}
+
+		FCityGen_DenseOpenEntry Entry;
+		OpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+		State.MaxPoppedFCost = FMath::Max(State.MaxPoppedFCost, Entry.FCost);
+
+		const int32 CurrentIndex = Entry.CellIndex;
+		if (!Storage.IsOpen(CurrentIndex) || (Storage.GetGCost(CurrentIndex) != Entry.GCost))
+		{
+			continue; // Stale entry: the node was closed or improved after this push
+		}
+
+		NumExpansionsInCall++;
+		State.NumIterations = State.NumIterations + 1;
+		if (State.NumIterations > State.MaxIterations)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
+			Workspace.EndSearch();
+			return ECityGen_SearchStatus::Failed;
+		}
+
+		Storage.SetClosed(CurrentIndex);
+
+		if (Storage.IsGoal(CurrentIndex))
+		{
+			State.EndIndex = CurrentIndex;
+			State.PathCost = Storage.GetGCost(CurrentIndex);
+			State.CostLowerBound = GetOpenCostLowerBound(Workspace, State);
+			Storage.GetPath(State.EndIndex, OutPath);
+			Workspace.EndSearch();
+			return ECityGen_SearchStatus::Found;
+		}
+
+		const FSG_GridCoordinate CurrentCoords = Storage.ToCoord(CurrentIndex);
+		const float CurrentGCost = Storage.GetGCost(CurrentIndex);
+		const uint8 WalkableNeighbours = GetWalkableNeighbourMask(CurrentCoords);
+		for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+		{
+			const FSG_GridCoordinate NeighbourCoords = CurrentCoords + FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+			if ((WalkableNeighbours & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			float MovementCost = GetDistance(CurrentCoords, NeighbourCoords);
+
+			// check if this is already used in a previous path, and lower the cost if it is
+			if (RequestedCorridors.Contains(NeighbourCoords))
+			{
+				MovementCost *= CityGenCorridorCost::MovementReductionFactorForCellWithCorridor;
+			}
+
+			// Same cell so same heuristic: comparing G is comparing F
+			// The heuristic is not consistent with the corridor cost reduction, so a closed node can be re-opened
+			const int32 NeighbourIndex = Storage.ToIndex(NeighbourCoords);
+			const float NewGCost = CurrentGCost + MovementCost;
+			if (NewGCost >= Storage.GetGCost(NeighbourIndex))
+			{
+				continue;
+			}
+
+			Storage.SetGCost(NeighbourIndex, NewGCost);
+			Storage.SetParentDirection(NeighbourIndex, FCityGen_DenseSearchStorage::GetOppositeDirection(Direction));
+			Workspace.PushOpenNode(NeighbourIndex, NewGCost, State.HeuristicWeight * GetDistanceToClosestGoal(NeighbourCoords, State), State.PushSequence++);
+		}
+	}
+
+	UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), State.NumIterations);
+	Workspace.EndSearch();
+	return ECityGen_SearchStatus::Failed;
+}
+
+bool ADungeonGenerator_GridBased::FindPath_BucketQueue(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	if (!DungeonGridBounds.Contains(StartDoorGridCoords) || !DungeonGridBounds.Contains(EndDoorGridCoords))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Door outside of the dungeon grid bounds, can not find a path"));
+		return false;
+	}
+
+	FCityGen_SearchWorkspace& Workspace = SearchWorkspaces[0];
+	Workspace.BeginSearch(DungeonGridBounds);
+	ON_SCOPE_EXIT { Workspace.EndSearch(); };
+
+	// The integer costs are stored in the float costs of the storage, exact below 2^24
+	FCityGen_DenseSearchStorage& Storage = Workspace.Storage;
+	FCityGen_BucketQueue& OpenBuckets = Workspace.OpenBuckets;
+	const FCityGen_IntegerCostModel CostModel(DistanceFactorForZ);
+
+	const int32 StartIndex = Storage.ToIndex(StartDoorGridCoords);
+	const int32 EndIndex = Storage.ToIndex(EndDoorGridCoords);
+	Storage.SetGCost(StartIndex, 0.0f);
+	Storage.SetOpen(StartIndex);
+	OpenBuckets.Push(CostModel.GetDistance(StartDoorGridCoords, EndDoorGridCoords), { StartIndex, 0 });
+
+	int32 numIterations = 0;
+	const int32 maxIterations = MaxExpansionsPerPair; // To avoid infinite loop in case of setting mistake
+	FCityGen_BucketQueue::FEntry Entry;
+	while (OpenBuckets.Pop(Entry))
+	{
+		const int32 CurrentIndex = Entry.CellIndex;
+		if (!Storage.IsOpen(CurrentIndex) || ((int32)Storage.GetGCost(CurrentIndex) != Entry.GCost))
+		{
+			continue; // Stale entry: the node was closed or improved after this push
+		}
+
+		numIterations = numIterations + 1;
+		OutNumExpansions = numIterations;
+		if (numIterations > maxIterations)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
+			return false;
+		}
+
+		Storage.SetClosed(CurrentIndex);
+
+		if (CurrentIndex == EndIndex)
+		{
+			TArray<FSG_GridCoordinate> Path;
+			Storage.GetPath(EndIndex, Path);
+
+			UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+			CommitPath(Path, StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords);
+			return true;
+		}
+
+		const FSG_GridCoordinate CurrentCoords = Storage.ToCoord(CurrentIndex);
+		const uint8 WalkableNeighbours = GetWalkableNeighbourMask(CurrentCoords);
+		for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+		{
+			const FSG_GridCoordinate NeighbourCoords = CurrentCoords + FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+			if ((WalkableNeighbours & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			// The heuristic is not consistent with the corridor cost reduction, so a closed node can be re-opened
+			const int32 NeighbourIndex = Storage.ToIndex(NeighbourCoords);
+			const int32 NewGCost = Entry.GCost + CostModel.GetStepCost(Direction, RequestedCorridors.Contains(NeighbourCoords));
+			if ((float)NewGCost >= Storage.GetGCost(NeighbourIndex))
+			{
+				continue;
+			}
+
+			Storage.SetGCost(NeighbourIndex, (float)NewGCost);
+			Storage.SetParentDirection(NeighbourIndex, FCityGen_DenseSearchStorage::GetOppositeDirection(Direction));
+			Storage.SetOpen(NeighbourIndex);
+			OpenBuckets.Push(NewGCost + CostModel.GetDistance(NeighbourCoords, EndDoorGridCoords), { NeighbourIndex, NewGCost });
+		}
+	}
+
+	UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), numIterations);
+	return false;
+}
+
+void ADungeonGenerator_GridBased::CommitPath(const TArray<FSG_GridCoordinate>& Path, const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords)
+{
+	// We need to add the room location in order that the corridors spawning take them in account
+	AddCorridorConnection(StartDoorGridCoords, StartRoomGridCoords, true);
+	AddCorridorConnection(EndDoorGridCoords, EndRoomGridCoords, true);
+
+	CommitPathCells(Path);
+}
+
+void ADungeonGenerator_GridBased::CommitPathCells(const TArray<FSG_GridCoordinate>& Path)
+{
+	for (int32 PathIndex = 1; PathIndex < Path.Num(); ++PathIndex)
+	{
+		const FSG_GridCoordinate& PreviousCoord = Path[PathIndex - 1];
+		const FSG_GridCoordinate& CurrentCoord = Path[PathIndex];
+		AddCorridorConnection(PreviousCoord, CurrentCoord, false);
+		AddCorridorConnection(CurrentCoord, PreviousCoord, false);
+	}
+}
+
+namespace
+{
+	// Jump Point Search on the 6-connected grid. Jumps are ordered X first, then Y, then Z:
+	// - A jump stops on the goal, or on a cell with a forced neighbour (a side cell only reachable through this cell)
+	// - A jump along Y also stops where a jump along X would find a jump point
+	// - A jump along Z also stops where a jump along X or Y would find a jump point
+	// Jumps also stop on and next to cells already used by a corridor: the cost is not uniform there,
+	// so the search falls back to expanding every cell like plain A*
+	struct FCorridorJumpPointContext
+	{
+		const FCityGen_GridBounds& Bounds;
+		const FSG_GridBitVolume& BlockedGridTiles;
+		const FCityGen_CorridorCellStore& RequestedCorridors;
+		const FSG_GridCoordinate& Goal;
+		FCityGen_IntegerCostModel CostModel;
+
+		bool IsWalkable(const FSG_GridCoordinate& Coord) const
+		{
+			return Bounds.Contains(Coord) && !BlockedGridTiles.IsSet(Coord);
+		}
+
+		bool IsCorridor(const FSG_GridCoordinate& Coord) const
+		{
+			return RequestedCorridors.Contains(Coord);
+		}
+
+		// Same integer cost as the bucket queue search, with the corridor reduction
+		int32 GetStepCost(uint8 Direction, const FSG_GridCoordinate& To) const
+		{
+			return CostModel.GetStepCost(Direction, IsCorridor(To));
+		}
+
+		bool HasForcedOrCorridorNeighbour(const FSG_GridCoordinate& Coord, uint8 Direction) const
+		{
+			const int32 Axis = FCityGen_DenseSearchStorage::GetDirectionAxis(Direction);
+			const FSG_GridCoordinate Previous = Coord - FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+			for (uint8 SideDirection = 0; SideDirection < FCityGen_DenseSearchStorage::NumDirections; ++SideDirection)
+			{
+				if (FCityGen_DenseSearchStorage::GetDirectionAxis(SideDirection) == Axis)
+				{
+					continue;
+				}
+
+				const FSG_GridCoordinate& SideOffset = FCityGen_DenseSearchStorage::DirectionOffsets[SideDirection];
+				if (!IsWalkable(Coord + SideOffset))
+				{
+					continue;
+				}
+				if (IsCorridor(Coord + SideOffset) || !IsWalkable(Previous + SideOffset))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// @return: false if the jump reach a blocked cell or the bounds without finding a jump point
+		bool Jump(const FSG_GridCoordinate& From, uint8 Direction, FSG_GridCoordinate& OutJumpPoint, int32& OutNumSteps, int32& OutCost) const
+		{
+			const int32 Axis = FCityGen_DenseSearchStorage::GetDirectionAxis(Direction);
+			const FSG_GridCoordinate& Offset = FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+
+			FSG_GridCoordinate Current = From;
+			OutNumSteps = 0;
+			OutCost = 0;
+			while (OutNumSteps < FCityGen_DenseSearchStorage::MaxParentJumpLength)
+			{
+				const FSG_GridCoordinate Next = Current + Offset;
+				if (!IsWalkable(Next))
+				{
+					return false;
+				}
+
+				OutCost += GetStepCost(Direction, Next);
+				++OutNumSteps;
+				Current = Next;
+
+				if ((Current == Goal) || IsCorridor(Current) || HasForcedOrCorridorNeighbour(Current, Direction))
+				{
+					OutJumpPoint = Current;
+					return true;
+				}
+
+				for (uint8 LowerDirection = 0; LowerDirection < FCityGen_DenseSearchStorage::NumDirections; ++LowerDirection)
+				{
+					if (FCityGen_DenseSearchStorage::GetDirectionAxis(LowerDirection) >= Axis)
+					{
+						continue;
+					}
+
+					FSG_GridCoordinate LowerJumpPoint;
+					int32 LowerNumSteps = 0;
+					int32 LowerCost = 0;
+					if (Jump(Current, LowerDirection, LowerJumpPoint, LowerNumSteps, LowerCost))
+					{
+						OutJumpPoint = Current;
+						return true;
+					}
+				}
+			}
+
+			// The parent jump length can not store more, stop here
+			OutJumpPoint = Current;
+			return true;
+		}
+	};
+}
+
+bool ADungeonGenerator_GridBased::FindPath_JumpPoint(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	if (!DungeonGridBounds.Contains(StartDoorGridCoords) || !DungeonGridBounds.Contains(EndDoorGridCoords))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Door outside of the dungeon grid bounds, can not find a path"));
+		return false;
+	}
+
+	const FCorridorJumpPointContext JumpContext{ DungeonGridBounds, BlockedGridTiles, RequestedCorridors, EndDoorGridCoords, FCityGen_IntegerCostModel(DistanceFactorForZ) };
+
+	FCityGen_SearchWorkspace& Workspace = SearchWorkspaces[0];
+	Workspace.BeginSearch(DungeonGridBounds, true);
+	ON_SCOPE_EXIT { Workspace.EndSearch(); };
+
+	// The integer costs are stored in the float costs of the storage and the heap, exact below 2^24
+	FCityGen_DenseSearchStorage& Storage = Workspace.Storage;
+	TArray<FCityGen_DenseOpenEntry>& OpenHeap = Workspace.OpenHeap;
+	const FCityGen_DenseOpenEntryPredicate OpenHeapPredicate;
+	uint32 PushSequence = 0;
+
+	auto PushOpenNode = [&](int32 CellIndex, int32 GCost, int32 HCost)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		Entry.FCost = (float)(GCost + HCost);
+		Entry.HCost = (float)HCost;
+		Entry.GCost = (float)GCost;
+		Entry.Sequence = PushSequence++;
+		Entry.CellIndex = CellIndex;
+		OpenHeap.HeapPush(Entry, OpenHeapPredicate);
+		Storage.SetOpen(CellIndex);
+	};
+
+	const int32 StartIndex = Storage.ToIndex(StartDoorGridCoords);
+	const int32 EndIndex = Storage.ToIndex(EndDoorGridCoords);
+	Storage.SetGCost(StartIndex, 0.0f);
+	PushOpenNode(StartIndex, 0, 0);
+
+	int32 numIterations = 0;
+	const int32 maxIterations = MaxExpansionsPerPair; // To avoid infinite loop in case of setting mistake
+	while (OpenHeap.Num() > 0)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		OpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+
+		const int32 CurrentIndex = Entry.CellIndex;
+		if (!Storage.IsOpen(CurrentIndex) || (Storage.GetGCost(CurrentIndex) != Entry.GCost))
+		{
+			continue; // Stale entry: the node was closed or improved after this push
+		}
+
+		numIterations = numIterations + 1;
+		OutNumExpansions = numIterations;
+		if (numIterations > maxIterations)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
+			return false;
+		}
+
+		Storage.SetClosed(CurrentIndex);
+
+		if (CurrentIndex == EndIndex)
+		{
+			// We need to add the room location in order that the corridors spawning take them in account
+			AddCorridorConnection(StartDoorGridCoords, StartRoomGridCoords, true);
+			AddCorridorConnection(EndDoorGridCoords, EndRoomGridCoords, true);
+
+			UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+			RetracePath(Storage, EndIndex);
+			return true;
+		}
+
+		// Every direction is tried from a jump point, except going back to the parent
+		const FSG_GridCoordinate CurrentCoords = Storage.ToCoord(CurrentIndex);
+		const int32 CurrentGCost = (int32)Storage.GetGCost(CurrentIndex);
+		const uint8 ParentDirection = Storage.GetParentDirection(CurrentIndex);
+		for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+		{
+			if (Direction == ParentDirection)
+			{
+				continue;
+			}
+
+			FSG_GridCoordinate JumpPoint;
+			int32 NumSteps = 0;
+			int32 JumpCost = 0;
+			if (!JumpContext.Jump(CurrentCoords, Direction, JumpPoint, NumSteps, JumpCost))
+			{
+				continue;
+			}
+
+			const int32 JumpPointIndex = Storage.ToIndex(JumpPoint);
+			const int32 NewGCost = CurrentGCost + JumpCost;
+			if ((float)NewGCost >= Storage.GetGCost(JumpPointIndex))
+			{
+				continue;
+			}
+
+			Storage.SetGCost(JumpPointIndex, (float)NewGCost);
+			Storage.SetParentDirection(JumpPointIndex, FCityGen_DenseSearchStorage::GetOppositeDirection(Direction));
+			Storage.SetParentJumpLength(JumpPointIndex, NumSteps);
+			PushOpenNode(JumpPointIndex, NewGCost, JumpContext.CostModel.GetDistance(JumpPoint, EndDoorGridCoords));
+		}
+	}
+
+	UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), numIterations);
+	return false;
+}
+
+bool ADungeonGenerator_GridBased::FindPath_Hierarchical(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	if (!HierarchicalPlanner.IsBuilt())
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Hierarchical planner not built, can not find a path"));
+		return false;
+	}
+
+	TArray<FSG_GridCoordinate> Path;
+	if (!HierarchicalPlanner.FindPath(StartDoorGridCoords, EndDoorGridCoords, Path, OutNumExpansions))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("No path found after %d expansions"), OutNumExpansions);
+		return false;
+	}
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+	CommitPath(Path, StartDoorGridCoords, StartRoomGridCoords, EndDoorGridCoords, EndRoomGridCoords);
+
+	// The new corridor lower the cost of its cells, only the chunks it crosses need new intra chunk edges
+	HierarchicalPlanner.OnCorridorCellsAdded(Path);
+	return true;
+}
+
+// Side 0 searches forward from the start door, side 1 backward from the end door
+// The side with the fewest open entries is expanded first. Each time a side reaches a node already reached by the other side,
+// the best meeting node is updated. The search stops when the lowest F cost of one side is not lower than the best path found
+// As for the forward search the heuristic is not consistent with the corridor cost reduction, the path is not always the shortest
+bool ADungeonGenerator_GridBased::FindPath_Bidirectional(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions)
+{
+	if (!DungeonGridBounds.Contains(StartDoorGridCoords) || !DungeonGridBounds.Contains(EndDoorGridCoords))
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Door outside of the dungeon grid bounds, can not find a path"));
+		return false;
+	}
+
+	const FSG_GridCoordinate Targets[2] = { EndDoorGridCoords, StartDoorGridCoords };
+	const FCityGen_DenseOpenEntryPredicate OpenHeapPredicate;
+	uint32 PushSequence = 0;
+
+	auto PushOpenNode = [&](int32 Side, int32 CellIndex, float GCost, float HCost)
+	{
+		FCityGen_DenseOpenEntry Entry;
+		Entry.FCost = GCost + HCost;
+		Entry.HCost = HCost;
+		Entry.GCost = GCost;
+		Entry.Sequence = PushSequence++;
+		Entry.CellIndex = CellIndex;
+		SearchWorkspaces[Side].OpenHeap.HeapPush(Entry, OpenHeapPredicate);
+		SearchWorkspaces[Side].Storage.SetOpen(CellIndex);
+	};
+
+	// Skip stale entries so the top of the heap is the lowest F cost of the open nodes
+	auto PruneStaleEntries = [&](int32 Side)
+	{
+		while (SearchWorkspaces[Side].OpenHeap.Num() > 0)
+		{
+			const FCityGen_DenseOpenEntry& Top = SearchWorkspaces[Side].OpenHeap.HeapTop();
+			if (SearchWorkspaces[Side].Storage.IsOpen(Top.CellIndex) && (SearchWorkspaces[Side].Storage.GetGCost(Top.CellIndex) == Top.GCost))
+			{
+				return;
+			}
+			SearchWorkspaces[Side].OpenHeap.HeapPopDiscard(OpenHeapPredicate, EAllowShrinking::No);
+		}
+	};
+
+	SearchWorkspaces[0].BeginSearch(DungeonGridBounds);
+	SearchWorkspaces[1].BeginSearch(DungeonGridBounds);
+	ON_SCOPE_EXIT
+	{
+		SearchWorkspaces[0].EndSearch();
+		SearchWorkspaces[1].EndSearch();
+	};
+
+	const int32 StartIndex = SearchWorkspaces[0].Storage.ToIndex(StartDoorGridCoords);
+	const int32 EndIndex = SearchWorkspaces[1].Storage.ToIndex(EndDoorGridCoords);
+	SearchWorkspaces[0].Storage.SetGCost(StartIndex, 0.0f);
+	SearchWorkspaces[1].Storage.SetGCost(EndIndex, 0.0f);
+	PushOpenNode(0, StartIndex, 0.0f, 0.0f);
+	PushOpenNode(1, EndIndex, 0.0f, 0.0f);
+
+	// Both storages cover the same bounds, so a cell has the same index on both sides
+	float BestPathCost = TNumericLimits<float>::Max();
+	int32 MeetingIndex = INDEX_NONE;
+	if (StartIndex == EndIndex)
+	{
+		BestPathCost = 0.0f;
+		MeetingIndex = StartIndex;
+	}
+
+	int32 numIterations = 0;
+	const int32 maxIterations = MaxExpansionsPerPair; // Same limit as the other searches, shared by both sides
+	while (true)
+	{
+		PruneStaleEntries(0);
+		PruneStaleEntries(1);
+		if ((SearchWorkspaces[0].OpenHeap.Num() == 0) || (SearchWorkspaces[1].OpenHeap.Num() == 0))
 		{
-			// We need to add the room location in order that the corridors spawning take them in account
-			RequestedCorridors.FindOrAdd(StartDoorGridCoords).MakeConnection(StartDoorGridCoords, StartRoomGridCoords, true);
-			RequestedCorridors.FindOrAdd(EndDoorGridCoords).MakeConnection(EndDoorGridCoords, EndRoomGridCoords, true);
-
-			UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
-			RetracePath(StartDoorGridCoords, EndDoorGridCoords, ClosedNodesMap);
-			return true;
+			break; // One side is fully explored, no other path can be found
+		}
+		if (FMath::Max(SearchWorkspaces[0].OpenHeap.HeapTop().FCost, SearchWorkspaces[1].OpenHeap.HeapTop().FCost) >= BestPathCost)
+		{
+			break;
 		}
 
-		// For each neighbor of current node:
-		TArray<FSG_GridCoordinate> Neighbours = DungeonGridCmpt->GetNeighbourNodes3D(CurrentCoords);
+		const int32 Side = (SearchWorkspaces[1].OpenHeap.Num() < SearchWorkspaces[0].OpenHeap.Num()) ? 1 : 0;
+		FCityGen_DenseSearchStorage& SideStorage = SearchWorkspaces[Side].Storage;
+		const FCityGen_DenseSearchStorage& OtherStorage = SearchWorkspaces[1 - Side].Storage;
 
-		for (int32 i = 0; i < Neighbours.Num(); i++)
+		FCityGen_DenseOpenEntry Entry;
+		SearchWorkspaces[Side].OpenHeap.HeapPop(Entry, OpenHeapPredicate, EAllowShrinking::No);
+
+		numIterations = numIterations + 1;
+		OutNumExpansions = numIterations;
+		if (numIterations > maxIterations)
 		{
-			// Adding nodes
-			const FSG_GridCoordinate& CurrentNeighbourCoordinate = Neighbours[i];
+			UE_LOG(LogCityGen, Warning, TEXT("MAX ITERATIONS REACHED"));
+			return false;
+		}
 
-			if (IsGridTileBlocked(CurrentNeighbourCoordinate))
+		const int32 CurrentIndex = Entry.CellIndex;
+		SideStorage.SetClosed(CurrentIndex);
+
+		const FSG_GridCoordinate CurrentCoords = SideStorage.ToCoord(CurrentIndex);
+		const float CurrentGCost = SideStorage.GetGCost(CurrentIndex);
+		const bool bIsCurrentCorridor = RequestedCorridors.Contains(CurrentCoords);
+		const uint8 WalkableNeighbours = GetWalkableNeighbourMask(CurrentCoords);
+		for (uint8 Direction = 0; Direction < FCityGen_DenseSearchStorage::NumDirections; ++Direction)
+		{
+			const FSG_GridCoordinate NeighbourCoords = CurrentCoords + FCityGen_DenseSearchStorage::DirectionOffsets[Direction];
+			if ((WalkableNeighbours & (1 << Direction)) == 0)
 			{
 				continue;
 			}
 
-			float MovementCost = GetDistance(CurrentCoords, Neighbours[i]);
-
-			// check if this is already used in a previous path, and lower the cost if it is 
-			if (RequestedCorridors.Contains(CurrentNeighbourCoordinate))
+			// The reduction applies to the cell entered when walking from the start door to the end door:
+			// the neighbour for the forward search, the current cell for the backward search
+			float MovementCost = GetDistance(CurrentCoords, NeighbourCoords);
+			const bool bIsEnteredCellCorridor = (Side == 0) ? RequestedCorridors.Contains(NeighbourCoords) : bIsCurrentCorridor;
+			if (bIsEnteredCellCorridor)
 			{
-				const float MovementReductionFactorForCellWithCorridor = 0.5f;
-				MovementCost *= MovementReductionFactorForCellWithCorridor;
+				MovementCost *= CityGenCorridorCost::MovementReductionFactorForCellWithCorridor;
 			}
 
-			float CurrentNeighbour_NewGCost = CurrentNode.GCost + MovementCost;
-			float CurrentNeighbour_NewHCost = GetDistance(Neighbours[i], EndDoorGridCoords);
-			float CurrentNeighbour_NewFCost = CurrentNeighbour_NewHCost + CurrentNeighbour_NewGCost;
-
-			if (ClosedNodesMap.Contains(CurrentNeighbourCoordinate))
+			const int32 NeighbourIndex = SideStorage.ToIndex(NeighbourCoords);
+			const float NewGCost = CurrentGCost + MovementCost;
+			if (NewGCost >= SideStorage.GetGCost(NeighbourIndex))
 			{
-				const FCityGen_NodeCoord& AlreadyVisitedNode = ClosedNodesMap[CurrentNeighbourCoordinate];
-				if (AlreadyVisitedNode.ComputeFCost() < CurrentNeighbour_NewFCost)
-				{
-					continue;
-				}
+				continue;
 			}
 
-			if (OpenNodesMap.Contains(CurrentNeighbourCoordinate))
-			{
-				FCityGen_NodeCoord& AlreadyVisitedNode = OpenNodesMap[CurrentNeighbourCoordinate];
-				if (AlreadyVisitedNode.ComputeFCost() < CurrentNeighbour_NewFCost)
-				{
-					continue;
-				}
-				
-				AlreadyVisitedNode.GCost = CurrentNeighbour_NewGCost;
-				AlreadyVisitedNode.HCost = CurrentNeighbour_NewHCost;
-				AlreadyVisitedNode.bHaveParent = true;
-				AlreadyVisitedNode.ParentCoordinate = CurrentCoords;
-			}
-			else
-			{
-				FCityGen_NodeCoord NewNeighbourNode;
-				NewNeighbourNode.GCost = CurrentNeighbour_NewGCost;
-				NewNeighbourNode.HCost = CurrentNeighbour_NewHCost;
-				NewNeighbourNode.bHaveParent = true;
-				NewNeighbourNode.ParentCoordinate = CurrentCoords;
-				NewNeighbourNode.NodeCoordinate = CurrentNeighbourCoordinate;
+			SideStorage.SetGCost(NeighbourIndex, NewGCost);
+			SideStorage.SetParentDirection(NeighbourIndex, FCityGen_DenseSearchStorage::GetOppositeDirection(Direction));
+			PushOpenNode(Side, NeighbourIndex, NewGCost, GetDistance(NeighbourCoords, Targets[Side]));
 
-				OpenSet.Add(CurrentNeighbourCoordinate);
-				OpenNodesMap.Add(CurrentNeighbourCoordinate, NewNeighbourNode);
+			// Reached by the other side too: this is a full path from the start door to the end door
+			const float OtherGCost = OtherStorage.GetGCost(NeighbourIndex);
+			if ((OtherGCost != TNumericLimits<float>::Max()) && (NewGCost + OtherGCost < BestPathCost))
+			{
+				BestPathCost = NewGCost + OtherGCost;
+				MeetingIndex = NeighbourIndex;
 			}
 		}
 	}
 
-	UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), numIterations);
-	return false;
+	if (MeetingIndex == INDEX_NONE)
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("No path found after %d iterations"), numIterations);
+		return false;
+	}
+
+	// We need to add the room location in order that the corridors spawning take them in account
+	AddCorridorConnection(StartDoorGridCoords, StartRoomGridCoords, true);
+	AddCorridorConnection(EndDoorGridCoords, EndRoomGridCoords, true);
+
+	UE_LOG(LogCityGen, Log, TEXT("PATH FOUND"));
+	// Meeting node to the start door, then meeting node to the end door
+	RetracePath(SearchWorkspaces[0].Storage, MeetingIndex);
+	RetracePath(SearchWorkspaces[1].Storage, MeetingIndex);
+	return true;
 }
 
 // @return: location in world space of the first gridCoord of the path
@@ -667,8 +3458,8 @@ void ADungeonGenerator_GridBased::RetracePath(
 	{
 		const FSG_GridCoordinate& CurrentNodeCoord = CurrentNode->GetNodeCoordinate();
 		const FSG_GridCoordinate& ParentNodeCoord = CurrentNode->GetParentNodeCoordinate();
-		RequestedCorridors.FindOrAdd(CurrentNodeCoord).MakeConnection(CurrentNodeCoord, ParentNodeCoord, false);
-		RequestedCorridors.FindOrAdd(ParentNodeCoord).MakeConnection(ParentNodeCoord, CurrentNodeCoord, false);
+		AddCorridorConnection(CurrentNodeCoord, ParentNodeCoord, false);
+		AddCorridorConnection(ParentNodeCoord, CurrentNodeCoord, false);
 
 #if 0
 		UE_LOG(LogCityGen, Log, TEXT("Path Grid Coord X: %d  Y: %d   Z: %d"),
@@ -687,289 +3478,408 @@ void ADungeonGenerator_GridBased::RetracePath(
 	}
 }
 
+// Walk the parent directions from EndIndex until the start node
+// Every cell between a node and its parent is added, as the parent may be several cells away
+void ADungeonGenerator_GridBased::RetracePath(const FCityGen_DenseSearchStorage& Storage, int32 EndIndex)
+{
+	int32 CurrentIndex = EndIndex;
+	uint8 ParentDirection = Storage.GetParentDirection(CurrentIndex);
+	while (ParentDirection != FCityGen_DenseSearchStorage::ParentDirectionNone)
+	{
+		const int32 NumSteps = Storage.GetParentJumpLength(CurrentIndex);
+		FSG_GridCoordinate CurrentNodeCoord = Storage.ToCoord(CurrentIndex);
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			const FSG_GridCoordinate ParentNodeCoord = CurrentNodeCoord + FCityGen_DenseSearchStorage::DirectionOffsets[ParentDirection];
+			AddCorridorConnection(CurrentNodeCoord, ParentNodeCoord, false);
+			AddCorridorConnection(ParentNodeCoord, CurrentNodeCoord, false);
+			CurrentNodeCoord = ParentNodeCoord;
+		}
+
+		CurrentIndex = Storage.ToIndex(CurrentNodeCoord);
+		ParentDirection = Storage.GetParentDirection(CurrentIndex);
+	}
+}
+
 // CORRIDOR TYPE SPAWNING
 void ADungeonGenerator_GridBased::SpawnCorridors()
 {
-	TSet<FSG_GridCoordinate> ProcessedCoords;
+	BeginSpawnCorridors();
+	StepSpawnCorridors(TNumericLimits<double>::Max());
+}
 
-	TArray<FSG_GridCoordinate> CorridorCoords;
-	RequestedCorridors.GetKeys(CorridorCoords);
-	for (int32 i = 0; i < CorridorCoords.Num(); ++i)
+void ADungeonGenerator_GridBased::BeginSpawnCorridors()
+{
+	CancelSpawnCorridors();
+	RequestedCorridors.GetKeys(PendingCorridorCoords);
+	NextCorridorIndex = 0;
+
+	// Closest cells first, so a time sliced spawn fills the view of the player before the rest of the dungeon
+	const FSG_GridCoordinate FocusCoord = DungeonGridCmpt->WorldToGrid(GetCorridorSpawnFocus());
+	TArray<TPair<double, FSG_GridCoordinate>> SortedCoords;
+	SortedCoords.Reserve(PendingCorridorCoords.Num());
+	for (const FSG_GridCoordinate& Coord : PendingCorridorCoords)
 	{
-		const FSG_GridCoordinate& CurrentCoord = CorridorCoords[i];
-		const FCellConnectionState& CurrentCoordConnection = RequestedCorridors[CurrentCoord];
-
-		// Here we should not process coord twice
-		check(!ProcessedCoords.Contains(CurrentCoord));
-		ProcessedCoords.Add(CurrentCoord);
-
-		int32 UpCount = CurrentCoordConnection.bConnectUp ? 1 : 0;
-		int32 DownCount = CurrentCoordConnection.bConnectDown ? 1 : 0;
-		int32 HorizontalCount = CurrentCoordConnection.GetHorizontalConnectionCount();
-		UE_LOG(LogCityGen, Log, TEXT("HorizontalCount: %d"), HorizontalCount);
-		TArray<bool> bHasDirections = CurrentCoordConnection.GetDirectionArray();
+		const FVector Offset((Coord.X - FocusCoord.X) * TileSize.X, (Coord.Y - FocusCoord.Y) * TileSize.Y, (Coord.Z - FocusCoord.Z) * TileSize.Z);
+		SortedCoords.Emplace(Offset.SizeSquared(), Coord);
+	}
+	SortedCoords.Sort([](const TPair<double, FSG_GridCoordinate>& A, const TPair<double, FSG_GridCoordinate>& B) { return A.Key < B.Key; });
+	for (int32 Index = 0; Index < SortedCoords.Num(); ++Index)
+	{
+		PendingCorridorCoords[Index] = SortedCoords[Index].Value;
+	}
+}
 
-		FVector LocationWS = DungeonGridCmpt->GridToWorld(CurrentCoord) + FVector(TileSize.X, TileSize.Y, 0) / 2.0;
+void ADungeonGenerator_GridBased::CancelSpawnCorridors()
+{
+	PendingCorridorCoords.Reset();
+	NextCorridorIndex = 0;
+	for (TArray<FTransform>& Instances : PendingCorridorInstances)
+	{
+		Instances.Reset();
+	}
+	if (bSpawningCorridorsFromTick)
+	{
+		bSpawningCorridorsFromTick = false;
+		SetActorTickEnabled(false);
+	}
+}
 
-		if (DownCount > 0 && UpCount == 0)
-		{
-			ACityGen_RoomBase* pCorridor = SpawnDownLvlCorridor(CurrentCoord, LocationWS);
-			if (pCorridor != nullptr)
-			{
-				AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
-			}
-			continue;
-		}
+void ADungeonGenerator_GridBased::FinishSpawnCorridors()
+{
+	if (!AreCorridorsMaterialized())
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("FinishSpawnCorridors called with %d corridor cells still to spawn"), PendingCorridorCoords.Num() - NextCorridorIndex);
+		return;
+	}
 
-		if (UpCount > 0 && DownCount == 0)
-		{ 
-			ACityGen_RoomBase* pCorridor = SpawnUpLvlCorridor(CurrentCoord, LocationWS);
-			if (pCorridor != nullptr)
-			{
-				AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
-			}
-			continue;
-		}
+	UpdateDoorStatus();
+	OnCorridorsMaterialized.Broadcast(RequestedCorridors.Num());
+}
 
-		if (UpCount > 0 && DownCount > 0)
-		{
-			ACityGen_RoomBase* pCorridor = SpawnUpAndDownLvlCorridor(CurrentCoord, LocationWS);
-			if (pCorridor != nullptr)
-			{
-				AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
-			}
-			continue;
-		}
+bool ADungeonGenerator_GridBased::AreCorridorsMaterialized() const
+{
+	return !bSpawningCorridorsFromTick && (NextCorridorIndex >= PendingCorridorCoords.Num());
+}
 
-		if (HorizontalCount == 3)
-		{
-			ACityGen_RoomBase* pCorridor = SpawnTCorridor(CurrentCoord, LocationWS, bHasDirections);
-			if (pCorridor != nullptr)
-			{
-				AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
-			}
-			continue;
-		}
+FVector ADungeonGenerator_GridBased::GetCorridorSpawnFocus() const
+{
+	const UWorld* World = GetWorld();
+	const APlayerController* PlayerController = (World != nullptr) ? World->GetFirstPlayerController() : nullptr;
+	if (PlayerController != nullptr)
+	{
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		return ViewLocation;
+	}
+	return GetActorLocation();
+}
 
-		if (HorizontalCount == 4)
+bool ADungeonGenerator_GridBased::StepSpawnCorridors(double DeadlineSeconds)
+{
+	while (NextCorridorIndex < PendingCorridorCoords.Num())
+	{
+		if (FPlatformTime::Seconds() >= DeadlineSeconds)
 		{
-			ACityGen_RoomBase* pCorridor = SpawnCrossCorridor(CurrentCoord, LocationWS);
-			if (pCorridor != nullptr)
-			{
-				AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
-			}
-			continue;
+			return false;
 		}
 
-		if (HorizontalCount == 2)
-		{
-			ACityGen_RoomBase* pCorridor = SpawnStraightCorridor(CurrentCoord, LocationWS, bHasDirections); //can spawn straight or corner, depending on neighbour positions
-			if (pCorridor != nullptr)
-			{
-				AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
-			}
-			continue;
-		}
+		SpawnCorridorAt(PendingCorridorCoords[NextCorridorIndex]);
+		NextCorridorIndex++;
 	}
-	
+	PendingCorridorCoords.Empty();
+	NextCorridorIndex = 0;
+	FlushCorridorInstances();
+
 #if WITH_EDITOR
 	CheckNoOverlappingRooms(AllSpawnedCorridors);
 #endif // WITH_EDITOR
+	return true;
 }
 
-ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnDownLvlCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const
+float ADungeonGenerator_GridBased::GetSpawnCorridorsProgress() const
 {
-	if (ElevatorCorridorRoom_Down == nullptr)
-	{
-		UE_LOG(LogCityGen, Warning, TEXT("ElevatorCorridorRoom_Down is nullptr"));
-		return nullptr;
-	}
+	return (PendingCorridorCoords.Num() > 0) ? (float)NextCorridorIndex / (float)PendingCorridorCoords.Num() : 1.0f;
+}
 
-	FVector LocationWSLvl2 = DungeonGridCmpt->GridToWorld(CurrentCoord) + FVector(TileSize.X, TileSize.Y, 0) / 2.0;
-	ACityGen_RoomBase* SpawnElevatorCorridorRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(ElevatorCorridorRoom_Down, Location, FRotator::ZeroRotator);
-	if (SpawnElevatorCorridorRoom == nullptr)
+void ADungeonGenerator_GridBased::SpawnCorridorAt(const FSG_GridCoordinate& CurrentCoord)
+{
+	FCorridorPiece Piece;
+	if (!GetCorridorPiece(CurrentCoord, Piece))
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("Failed to spawn ElevatorCorridorRoom_Down actor"));
-		return nullptr;
+		return;
 	}
 
-	return SpawnElevatorCorridorRoom;
-}
+	FVector LocationWS = DungeonGridCmpt->GridToWorld(CurrentCoord) + FVector(TileSize.X, TileSize.Y, 0) / 2.0;
 
-ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnUpLvlCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const
-{
-	if (ElevatorCorridorRoom_Up == nullptr)
+	if (CorridorOutputMode == ECorridorOutputMode::InstancedMeshes)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("ElevatorCorridorRoom_Up is nullptr"));
-		return nullptr;
+		PendingCorridorInstances[(int32)Piece.Type].Add(FTransform(Piece.Rotation, LocationWS));
+		return;
 	}
 
-	FVector LocationWSLvl2 = DungeonGridCmpt->GridToWorld(CurrentCoord) + FVector(TileSize.X, TileSize.Y, 0) / 2.0;
-	ACityGen_RoomBase* SpawnElevatorCorridorRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(ElevatorCorridorRoom_Up, Location, FRotator::ZeroRotator);
-	if (SpawnElevatorCorridorRoom == nullptr)
+	// A cell is spawned again when its connections change, the previous actor goes back to the pool
+	ACityGen_RoomBase* pPreviousCorridor = nullptr;
+	if (AllSpawnedCorridors.RemoveAndCopyValue(CurrentCoord, pPreviousCorridor) && (pPreviousCorridor != nullptr))
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("Failed to spawn ElevatorCorridorRoom_Up actor"));
-		return nullptr;
+		CorridorActorPool->ReleaseActor(pPreviousCorridor);
 	}
 
-	return SpawnElevatorCorridorRoom;
+	ACityGen_RoomBase* pCorridor = SpawnCorridorPiece(Piece, LocationWS);
+	if (pCorridor != nullptr)
+	{
+		AllSpawnedCorridors.Add(CurrentCoord, pCorridor);
+	}
 }
 
-ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnUpAndDownLvlCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const
+FCorridorPieceTable::FCorridorPieceTable()
 {
-	if (ElevatorCorridorRoom_UpAndDown == nullptr)
+	for (int32 TypeIndex = (int32)ECorridorPieceType::Straight; TypeIndex <= (int32)ECorridorPieceType::CrossJunction; ++TypeIndex)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("ElevatorCorridorRoom_UpAndDown is nullptr"));
-		return nullptr;
+		const ECorridorPieceType Type = (ECorridorPieceType)TypeIndex;
+		const uint8 Openings = GetOpeningsMask(Type);
+
+		uint8 NumYawVariants = 0;
+		for (int32 NumQuarterTurns = 0; NumQuarterTurns < 4; ++NumQuarterTurns)
+		{
+			NumYawVariants += (RotateHorizontalMask(Openings, NumQuarterTurns) == Openings) ? 1 : 0;
+		}
+
+		for (int32 NumQuarterTurns = 0; NumQuarterTurns < 4; ++NumQuarterTurns)
+		{
+			FEntry& Entry = Entries[RotateHorizontalMask(Openings, NumQuarterTurns)];
+			if (Entry.bValid)
+			{
+				continue; // Same openings as a smaller turn
+			}
+			Entry.bValid = true;
+			Entry.Type = Type;
+			Entry.NumYawVariants = NumYawVariants;
+			Entry.BaseYaw = FRotator::NormalizeAxis(NumQuarterTurns * 90.0f);
+		}
 	}
 
-	FVector LocationWSLvl2 = DungeonGridCmpt->GridToWorld(CurrentCoord) + FVector(TileSize.X, TileSize.Y, 0) / 2.0;
-	ACityGen_RoomBase* SpawnElevatorCorridorRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(ElevatorCorridorRoom_UpAndDown, Location, FRotator::ZeroRotator);
-	if (SpawnElevatorCorridorRoom == nullptr)
+	// Any vertical connection makes an elevator, whatever the horizontal ones
+	for (int32 Mask = 0; Mask < CellConnectionMask::NumMasks; ++Mask)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("Failed to spawn ElevatorCorridorRoom_UpAndDown actor"));
-		return nullptr;
+		const bool bUp = (Mask & CellConnectionMask::Up) != 0;
+		const bool bDown = (Mask & CellConnectionMask::Down) != 0;
+		if (bUp || bDown)
+		{
+			Entries[Mask] = FEntry();
+			Entries[Mask].bValid = true;
+			Entries[Mask].Type = (bUp && bDown) ? ECorridorPieceType::ElevatorUpAndDown : (bUp ? ECorridorPieceType::ElevatorUp : ECorridorPieceType::ElevatorDown);
+		}
 	}
+}
 
-	return SpawnElevatorCorridorRoom;
+const FCorridorPieceTable& FCorridorPieceTable::Get()
+{
+	static const FCorridorPieceTable Table;
+	return Table;
 }
 
-ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnTCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location, const TArray<bool>& bDirections) const
+uint8 FCorridorPieceTable::GetOpeningsMask(ECorridorPieceType Type)
 {
-	if (TJunctionCorridorRoom == nullptr)
+	switch (Type)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("TJunctionCorridorRoom is nullptr"));
-		return nullptr;
+	case ECorridorPieceType::Straight:
+		return CellConnectionMask::North | CellConnectionMask::South;
+	case ECorridorPieceType::Corner:
+		return CellConnectionMask::North | CellConnectionMask::East;
+	case ECorridorPieceType::TJunction:
+		return CellConnectionMask::North | CellConnectionMask::East | CellConnectionMask::South;
+	case ECorridorPieceType::CrossJunction:
+		return CellConnectionMask::Horizontal;
+	default:
+		return 0;
 	}
+}
 
-	FRotator TjunctionRotation = FRotator::ZeroRotator;
+uint8 FCorridorPieceTable::RotateHorizontalMask(uint8 Mask, int32 NumQuarterTurns)
+{
+	const int32 Shift = ((NumQuarterTurns % 4) + 4) % 4;
+	const uint8 Horizontal = Mask & CellConnectionMask::Horizontal;
+	return ((Horizontal << Shift) | (Horizontal >> (4 - Shift))) & CellConnectionMask::Horizontal;
+}
 
-	if (!bDirections[0]) //NORTH
-	{
-		TjunctionRotation = FRotator(0.f, 90.f, 0.f);
-	}
-	else if (!bDirections[1]) //EAST
-	{
-		TjunctionRotation = FRotator(0.f, 180.f, 0.f);
-	}
-	else if (!bDirections[2]) //SOUTH
+bool ADungeonGenerator_GridBased::GetCorridorPiece(const FSG_GridCoordinate& CurrentCoord, FCorridorPiece& OutPiece) const
+{
+	const FCorridorPieceTable::FEntry& Entry = FCorridorPieceTable::Get().Entries[RequestedCorridors[CurrentCoord].GetConnectionMask()];
+	if (!Entry.bValid)
 	{
-		TjunctionRotation = FRotator(0.f, -90.0f, 0.f);
+		return false;
 	}
-	else if (!bDirections[3]) //WEST
+
+	OutPiece.Type = Entry.Type;
+
+	// From the seed and the cell, the cells are not always spawned in the same order (see BeginSpawnCorridors)
+	const uint32 CellHash = HashCombine(GetTypeHash(CurrentCoord), (uint32)DungeonGenRandomStream.GetInitialSeed());
+	const int32 YawVariant = (Entry.NumYawVariants > 1) ? (int32)(CellHash % (uint32)Entry.NumYawVariants) : 0;
+	OutPiece.Rotation = FRotator(0.f, FRotator::NormalizeAxis(Entry.BaseYaw + YawVariant * 360.0f / Entry.NumYawVariants), 0.f);
+	return true;
+}
+
+TSubclassOf<ACityGen_RoomBase> ADungeonGenerator_GridBased::GetCorridorPieceClass(ECorridorPieceType Type) const
+{
+	switch (Type)
 	{
-		TjunctionRotation = FRotator(0.f, 0.f, 0.f);
+	case ECorridorPieceType::Straight:
+		return CorridorRoom;
+	case ECorridorPieceType::Corner:
+		return CorridorCornerRoom;
+	case ECorridorPieceType::TJunction:
+		return TJunctionCorridorRoom;
+	case ECorridorPieceType::CrossJunction:
+		return CrossJunctionCorridorRoom;
+	case ECorridorPieceType::ElevatorUp:
+		return ElevatorCorridorRoom_Up;
+	case ECorridorPieceType::ElevatorDown:
+		return ElevatorCorridorRoom_Down;
+	case ECorridorPieceType::ElevatorUpAndDown:
+		return ElevatorCorridorRoom_UpAndDown;
+	default:
+		return nullptr;
 	}
-	else
+}
+
+UStaticMesh* ADungeonGenerator_GridBased::GetCorridorPieceMesh(ECorridorPieceType Type) const
+{
+	switch (Type)
 	{
-		check(false); // Should never happens
+	case ECorridorPieceType::Straight:
+		return CorridorMesh;
+	case ECorridorPieceType::Corner:
+		return CorridorCornerMesh;
+	case ECorridorPieceType::TJunction:
+		return TJunctionCorridorMesh;
+	case ECorridorPieceType::CrossJunction:
+		return CrossJunctionCorridorMesh;
+	case ECorridorPieceType::ElevatorUp:
+		return ElevatorCorridorMesh_Up;
+	case ECorridorPieceType::ElevatorDown:
+		return ElevatorCorridorMesh_Down;
+	case ECorridorPieceType::ElevatorUpAndDown:
+		return ElevatorCorridorMesh_UpAndDown;
+	default:
+		return nullptr;
 	}
-
-	ACityGen_RoomBase* SpawnTCorridorRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(TJunctionCorridorRoom, Location, TjunctionRotation);
-	return SpawnTCorridorRoom;
 }
 
-ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnCrossCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const
+ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnCorridorPiece(const FCorridorPiece& Piece, const FVector& Location) const
 {
-	if (CrossJunctionCorridorRoom == nullptr)
+	TSubclassOf<ACityGen_RoomBase> RoomToSpawn = GetCorridorPieceClass(Piece.Type);
+	if (RoomToSpawn == nullptr)
 	{
-		UE_LOG(LogCityGen, Warning, TEXT("CrossJunctionCorridorRoom is nullptr"));
+		UE_LOG(LogCityGen, Warning, TEXT("No corridor type set for %s"), *UEnum::GetValueAsString(Piece.Type));
 		return nullptr;
 	}
 
-	// Random rotation in 90 increments
-	int32 RandomIndex = DungeonGenRandomStream.RandRange(0, 3); // 0, 1, 2, or 3
-	float Yaw = RandomIndex * 90.f;
-
-	FRotator RandomRotation(0.f, Yaw, 0.f);
+	bool bReused = false;
+	ACityGen_RoomBase* SpawnCorridorRoom = CorridorActorPool->Acquire(RoomToSpawn, FTransform(Piece.Rotation, Location), bReused);
+	if (SpawnCorridorRoom == nullptr)
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("Failed to spawn %s corridor actor"), *UEnum::GetValueAsString(Piece.Type));
+		return nullptr;
+	}
 
-	ACityGen_RoomBase* SpawnCrossCorridorRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(CrossJunctionCorridorRoom, Location, RandomRotation);
-	return SpawnCrossCorridorRoom;
+	if (bReused)
+	{
+		SpawnCorridorRoom->ResetForReuse();
+	}
+	return SpawnCorridorRoom;
 }
 
-ACityGen_RoomBase* ADungeonGenerator_GridBased::SpawnStraightCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location, const TArray<bool>& bDirections) const
+void ADungeonGenerator_GridBased::FlushCorridorInstances()
 {
-	TSubclassOf<ACityGen_RoomBase> RoomToSpawn = nullptr;
-	FRotator RoomRotation = FRotator::ZeroRotator;
-	bool bNorth = bDirections[0];
-	bool bEast = bDirections[1];
-	bool bSouth = bDirections[2];
-	bool bWest = bDirections[3];
-
-	// Check for straight corridor
-	if ((bNorth && bSouth) || (bEast && bWest))
+	if (CorridorInstanceComponents.Num() < (int32)ECorridorPieceType::Num)
 	{
-		if (CorridorRoom == nullptr)
-		{
-			UE_LOG(LogCityGen, Warning, TEXT("CorridorRoom is nullptr"));
-			return nullptr;
-		}
-		
-		RoomToSpawn = CorridorRoom;
-		if (bNorth && bSouth)
-		{
-			float Yaw = FMath::RandBool() ? 0.f : 180.f;
-			RoomRotation = FRotator(0.f, Yaw, 0.f); // North/south 
-		}
-		else
-		{
-			float Yaw = FMath::RandBool() ? 90.f : -90.f;
-			RoomRotation = FRotator(0.f, Yaw, 0.f); // East/west 
-		}
+		CorridorInstanceComponents.SetNum((int32)ECorridorPieceType::Num);
 	}
-	// Check for adjacent (corner)
-	else
+
+	for (int32 TypeIndex = 0; TypeIndex < (int32)ECorridorPieceType::Num; ++TypeIndex)
 	{
-		if (CorridorCornerRoom == nullptr)
+		TArray<FTransform>& Instances = PendingCorridorInstances[TypeIndex];
+		if (Instances.Num() == 0)
 		{
-			UE_LOG(LogCityGen, Warning, TEXT("CorridorCornerRoom is nullptr"));
-			return nullptr;
+			continue;
 		}
 
-		RoomToSpawn = CorridorCornerRoom;
-
-		if (bNorth && bEast)
+		const ECorridorPieceType Type = (ECorridorPieceType)TypeIndex;
+		UStaticMesh* Mesh = GetCorridorPieceMesh(Type);
+		if (Mesh == nullptr)
 		{
-			RoomRotation = FRotator(0.f, 0.f, 0.f);
+			UE_LOG(LogCityGen, Warning, TEXT("No corridor mesh set for %s, %d corridor cells are left empty"), *UEnum::GetValueAsString(Type), Instances.Num());
+			Instances.Reset();
+			continue;
 		}
-		else if (bSouth && bEast)
+
+		TObjectPtr<UHierarchicalInstancedStaticMeshComponent>& Component = CorridorInstanceComponents[TypeIndex];
+		if (Component == nullptr)
 		{
-			RoomRotation = FRotator(0.f, 90.f, 0.f);
+			Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+			if (GetRootComponent() != nullptr)
+			{
+				Component->SetupAttachment(GetRootComponent());
+			}
+			Component->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+			Component->RegisterComponent();
+			AddInstanceComponent(Component);
 		}
-		else if (bSouth && bWest)
+		if (Component->GetStaticMesh() != Mesh)
 		{
-			RoomRotation = FRotator(0.f, 180.f, 0.f);
+			Component->SetStaticMesh(Mesh);
 		}
-		else if (bNorth && bWest)
+
+		// One call per type, the HISM tree is built once for all of them
+		Component->AddInstances(Instances, false, true);
+		Instances.Reset();
+	}
+
+	if (CorridorOutputMode == ECorridorOutputMode::InstancedMeshes)
+	{
+		UE_LOG(LogCityGen, Log, TEXT("Corridors output as %d instances"), GetNumCorridorInstances());
+	}
+}
+
+void ADungeonGenerator_GridBased::ClearCorridorInstances()
+{
+	for (UHierarchicalInstancedStaticMeshComponent* Component : CorridorInstanceComponents)
+	{
+		if (Component != nullptr)
 		{
-			RoomRotation = FRotator(0.f, -90.f, 0.f);
+			Component->ClearInstances();
 		}
-		else
+	}
+	for (TArray<FTransform>& Instances : PendingCorridorInstances)
+	{
+		Instances.Reset();
+	}
+}
+
+int32 ADungeonGenerator_GridBased::GetNumCorridorInstances() const
+{
+	int32 NumInstances = 0;
+	for (const UHierarchicalInstancedStaticMeshComponent* Component : CorridorInstanceComponents)
+	{
+		if (Component != nullptr)
 		{
-			check(false); // Should never happens
+			NumInstances += Component->GetInstanceCount();
 		}
 	}
-
-	ACityGen_RoomBase* SpawnCorridorRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(RoomToSpawn, Location, RoomRotation);
-	return SpawnCorridorRoom;
+	return NumInstances;
 }
 
 void ADungeonGenerator_GridBased::UpdateDoorStatus()
 {
-	TSet<FSG_GridCoordinate> ProcessedCoords;
-
-	TArray<FSG_GridCoordinate> CorridorCoords;
-	RequestedCorridors.GetKeys(CorridorCoords);
-	for (int32 i = 0; i < CorridorCoords.Num(); ++i)
+	RequestedCorridors.ForEach([this](const FSG_GridCoordinate& CurrentCoord, const FCellConnectionState& CurrentCoordConnection)
 	{
-		const FSG_GridCoordinate& CurrentCoord = CorridorCoords[i];
-		const FCellConnectionState& CurrentCoordConnection = RequestedCorridors[CurrentCoord];
-
 		// 1) We only have to check the corridor, as the room exit state are set when the path are found
 		// 2) We only have to check for elevator/stairs, as other case are manage by the type of corridor
-		if(!CurrentCoordConnection.bConnectUp && !CurrentCoordConnection.bConnectDown)
+		if(!CurrentCoordConnection.IsVertical())
 		{
-			continue;
+			return;
 		}
 
 		ACityGen_RoomBase** pCorridorActorPtr = AllSpawnedCorridors.Find(CurrentCoord);
@@ -978,9 +3888,8 @@ void ADungeonGenerator_GridBased::UpdateDoorStatus()
 			ACityGen_RoomBase* pCorridorActor = *pCorridorActorPtr;
 			//pCorridorActor->UpdateExitPoint(DungeonGridCmpt); // For corridor we only need exit point local
 			pCorridorActor->SetExitsUsed(CurrentCoordConnection);
-			continue;
 		}
-	}
+	});
 
 	OpenUsedExits();
 }
@@ -1048,7 +3957,70 @@ float ADungeonGenerator_GridBased::GetDistance(const FSG_GridCoordinate& A, cons
 	return DX + DY + (DZ * DistanceFactorForZ);
 }
 
+float ADungeonGenerator_GridBased::GetDistanceToClosestGoal(const FSG_GridCoordinate& Coord, const FCityGen_DenseSearchState& State) const
+{
+	if (State.Goals.Num() == 0)
+	{
+		// Distance to the closest cell of the goal box, in constant time whatever the number of goals
+		const FCityGen_GridBounds& Bounds = State.GoalBounds;
+		const FSG_GridCoordinate Closest(
+			FMath::Clamp(Coord.X, Bounds.Min.X, Bounds.Max.X),
+			FMath::Clamp(Coord.Y, Bounds.Min.Y, Bounds.Max.Y),
+			FMath::Clamp(Coord.Z, Bounds.Min.Z, Bounds.Max.Z));
+		return GetDistance(Coord, Closest);
+	}
+
+	float MinDistance = TNumericLimits<float>::Max();
+	for (const FSG_GridCoordinate& Goal : State.Goals)
+	{
+		MinDistance = FMath::Min(MinDistance, GetDistance(Coord, Goal));
+	}
+	return MinDistance;
+}
+
+float ADungeonGenerator_GridBased::GetOpenCostLowerBound(const FCityGen_SearchWorkspace& Workspace, const FCityGen_DenseSearchState& State) const
+{
+	// A step into a corridor cell costs a fraction of the distance, so that fraction of the distance never overestimates
+	const FCityGen_DenseSearchStorage& Storage = Workspace.Storage;
+	float LowerBound = State.PathCost;
+	for (const FCityGen_DenseOpenEntry& Entry : Workspace.OpenHeap)
+	{
+		if (!Storage.IsOpen(Entry.CellIndex) || (Storage.GetGCost(Entry.CellIndex) != Entry.GCost))
+		{
+			continue; // Stale entry
+		}
+		const float Heuristic = CityGenCorridorCost::MovementReductionFactorForCellWithCorridor * GetDistanceToClosestGoal(Storage.ToCoord(Entry.CellIndex), State);
+		LowerBound = FMath::Min(LowerBound, Entry.GCost + Heuristic);
+	}
+	return LowerBound;
+}
+
 bool ADungeonGenerator_GridBased::IsGridTileBlocked(const FSG_GridCoordinate& GridCoord) const
 {
-	return BlockedGridTiles.Contains(GridCoord);
+	return BlockedGridTiles.IsSet(GridCoord);
+}
+
+bool ADungeonGenerator_GridBased::IsCorridorSearchLimitedToBounds() const
+{
+	switch (CorridorSearchAlgorithm)
+	{
+	case ECorridorSearchAlgorithm::LinearScan:
+		return false;
+	case ECorridorSearchAlgorithm::BinaryHeap:
+		return bUseDenseSearchStorage;
+	default:
+		return true;
+	}
+}
+
+bool ADungeonGenerator_GridBased::IsCellClosedToCorridors(const FSG_GridCoordinate& GridCoord) const
+{
+	return (IsCorridorSearchLimitedToBounds() && !DungeonGridBounds.Contains(GridCoord)) || IsGridTileBlocked(GridCoord);
+}
+
+uint8 ADungeonGenerator_GridBased::GetWalkableNeighbourMask(const FSG_GridCoordinate& GridCoord) const
+{
+	// The blocked tiles volume covers exactly the search bounds
+	checkSlow(BlockedGridTiles.GetOrigin() == DungeonGridBounds.Min);
+	return BlockedGridTiles.GetNeighbourClearMask3D(GridCoord);
 }
@@ -50,4 +50,19 @@ TArray<ACityGen_RoomBase*> ADungeonGenerator_Linear::GetAllRoomsArray() const
 void ADungeonGenerator_Linear::InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms)
 {
 	RoomsToConnect = SpawnedRooms;
+}
+
+bool ADungeonGenerator_Linear::AddRoomToConnect(ACityGen_RoomBase* Room)
+{
+	if ((Room == nullptr) || RoomsToConnect.Contains(Room))
+	{
+		return false;
+	}
+	RoomsToConnect.Add(Room);
+	return true;
+}
+
+bool ADungeonGenerator_Linear::RemoveRoomToConnect(ACityGen_RoomBase* Room)
+{
+	return RoomsToConnect.Remove(Room) > 0;
 }
\ No newline at end of file
@@ -65,4 +65,19 @@ TArray<ACityGen_RoomBase*> ADungeonGenerator_Looping::GetAllRoomsArray() const
 void ADungeonGenerator_Looping::InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms)
 {
 	RoomsToConnect = SpawnedRooms;
+}
+
+bool ADungeonGenerator_Looping::AddRoomToConnect(ACityGen_RoomBase* Room)
+{
+	if ((Room == nullptr) || RoomsToConnect.Contains(Room))
+	{
+		return false;
+	}
+	RoomsToConnect.Add(Room);
+	return true;
+}
+
+bool ADungeonGenerator_Looping::RemoveRoomToConnect(ACityGen_RoomBase* Room)
+{
+	return RoomsToConnect.Remove(Room) > 0;
 }
\ No newline at end of file
@@ -61,4 +61,28 @@ TArray<ACityGen_RoomBase*> ADungeonGenerator_Star::GetAllRoomsArray() const
 void ADungeonGenerator_Star::InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms)
 {
 	RoomsToConnect = SpawnedRooms;
+}
+
+ACityGen_RoomBase* ADungeonGenerator_Star::GetFlowFieldHub() const
+{
+	return bUseHubFlowField ? CentralRoom : nullptr;
+}
+
+bool ADungeonGenerator_Star::AddRoomToConnect(ACityGen_RoomBase* Room)
+{
+	if ((Room == nullptr) || RoomsToConnect.Contains(Room))
+	{
+		return false;
+	}
+	RoomsToConnect.Add(Room);
+	return true;
+}
+
+bool ADungeonGenerator_Star::RemoveRoomToConnect(ACityGen_RoomBase* Room)
+{
+	if (Room == CentralRoom)
+	{
+		return false; // The hub can only be moved
+	}
+	return RoomsToConnect.Remove(Room) > 0;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "MineGenerator.h"
 
+#include "CityGen_ActorPool.h"
 #include "CityGen_LogChannels.h"
 #include "CityGen_Roombase.h"
 #include "DungeonGenerator_GridBased.h"
@@ -20,7 +21,13 @@ AMineGenerator::AMineGenerator()
 	GridCmpt = CreateDefaultSubobject<USG_GridComponentWithSize>(TEXT("GridCmpt"));
 	GridCmpt->SetTileSize(TileSize);
 
+	RoomActorPool = CreateDefaultSubobject<UCityGen_ActorPoolComponent>(TEXT("RoomActorPool"));
+
 	MineGenRandomStream = FRandomStream(RandomSeed);
+
+	// Only ticks during the time sliced generation
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
 // Called when the game starts or when spawned
@@ -30,9 +37,33 @@ void AMineGenerator::BeginPlay()
 
 	bool bSpawnCorridorRes = SpawnCorridorGenerator();
 	ClearRooms();
+	if (bTimeSlicedGeneration)
+	{
+		StartTimeSlicedGeneration();
+		return;
+	}
 	bool bGenerateMineRes = GenerateMine();
 }
 
+void AMineGenerator::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (GenerationStage == EMineGenerationStage::Idle || GenerationStage == EMineGenerationStage::Done || GenerationStage == EMineGenerationStage::Failed)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	const double DeadlineSeconds = FPlatformTime::Seconds() + GenerationBudgetMs / 1000.0;
+	StepGeneration(DeadlineSeconds);
+
+	if (GenerationStage != EMineGenerationStage::Done && GenerationStage != EMineGenerationStage::Failed)
+	{
+		OnGenerationProgress.Broadcast(GenerationStage, GetGenerationStageProgress());
+	}
+}
+
 bool AMineGenerator::SpawnCorridorGenerator()
 {
 	TSubclassOf<ADungeonGenerator_GridBased> SelectedClass = GetSelectedGeneratorClass();
@@ -60,7 +91,7 @@ void AMineGenerator::ClearRooms()
 	{
 		if (Room)
 		{
-			Room->Destroy();
+			RoomActorPool->ReleaseActor(Room);
 		}
 	}
 
@@ -75,6 +106,43 @@ void AMineGenerator::ClearRooms()
 	DungeonGeneratorInstance->ClearCorridorMeshes();
 }
 
+void AMineGenerator::WarmUpPools(int32 NumRoomsPerType, int32 NumCorridorsPerType)
+{
+	for (const TSubclassOf<ACityGen_RoomBase>& RoomType : RoomTypes)
+	{
+		RoomActorPool->WarmUp(RoomType, NumRoomsPerType);
+	}
+	if (GeneratorType == EGeneratorType::Star)
+	{
+		RoomActorPool->WarmUp(StarSettings.CentralRoom, 1);
+	}
+
+	if (DungeonGeneratorInstance)
+	{
+		DungeonGeneratorInstance->WarmUpCorridorPool(NumCorridorsPerType);
+	}
+}
+
+void AMineGenerator::ResizePools(int32 MaxRoomsPerType, int32 MaxCorridorsPerType)
+{
+	RoomActorPool->SetMaxPooledActorsPerClass(MaxRoomsPerType);
+	if (DungeonGeneratorInstance)
+	{
+		DungeonGeneratorInstance->GetCorridorActorPool()->SetMaxPooledActorsPerClass(MaxCorridorsPerType);
+	}
+}
+
+ACityGen_RoomBase* AMineGenerator::SpawnRoom(TSubclassOf<ACityGen_RoomBase> RoomClass, const FVector& Location, const FRotator& Rotation)
+{
+	bool bReused = false;
+	ACityGen_RoomBase* Room = RoomActorPool->Acquire(RoomClass, FTransform(Rotation, Location), bReused);
+	if (bReused)
+	{
+		Room->ResetForReuse();
+	}
+	return Room;
+}
+
 bool AMineGenerator::GenerateMine()
 {
 	AllSpawnedRooms.Empty();
@@ -96,54 +164,273 @@ bool AMineGenerator::GenerateMine()
 		int32 Attempts = 0;
 		int32 Spawned = 0;
 
+		BeginPlacementLevel(LevelIndex);
 		while (Spawned < NumRooms && Attempts < MaxAttempts)
 		{
 			++Attempts;
+			if (TryPlaceRoomOnLevel(LevelIndex))
+			{
+				++Spawned;
+			}
+			else if (!CanRetryFailedPlacement())
+			{
+				break;
+			}
+		}
+
+		if (Spawned < NumRooms)
+		{
+			UE_LOG(LogCityGen, Warning, TEXT("Level %d: %d of %d rooms placed"), LevelIndex, Spawned, NumRooms);
+		}
+	}
+
+	// After all rooms are spawned, we can now generate corridors between them
+	ADungeonGenerator_GridBased* Generator = PrepareGeneratorForConnection();
+	bool bSuccess = (Generator != nullptr) && Generator->ConnectRoomsInOrder();
+
+	if (!bSuccess)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to connect rooms with corridors."));
+		return false;
+	}
+	return true;
+}
+
+void AMineGenerator::BeginPlacementLevel(int32 LevelIndex)
+{
+	if (RoomPlacementStrategy != ERoomPlacementStrategy::FreeRectPacking)
+	{
+		return;
+	}
+
+	// Levels are placed in order, the rooms of the level below are the last ones placed
+	PreviousLevelRoomRects = (LevelIndex > 0) ? MoveTemp(CurrentLevelRoomRects) : TArray<FIntRect>();
+	CurrentLevelRoomRects.Reset();
+
+	LevelFreeSpace.Init(GetPlacementArea());
+	for (const FIntRect& RoomRect : PreviousLevelRoomRects)
+	{
+		LevelFreeSpace.Occupy(RoomRect);
+	}
+
+	// The central room is spawned after the other rooms, its cells are kept free on its level and the ones around it
+	if ((GeneratorType == EGeneratorType::Star) && StarSettings.CentralRoom && (FMath::Abs(LevelIndex - StarSettings.CentralRoomGridLocation.Z) <= 1))
+	{
+		// Its yaw is random, so the square around both orientations is kept
+		const FIntPoint Footprint = GetRoomFootprint(StarSettings.CentralRoom);
+		const int32 HalfSize = FMath::Max(Footprint.X, Footprint.Y) / 2 + 1;
+		const FIntPoint Center(StarSettings.CentralRoomGridLocation.X, StarSettings.CentralRoomGridLocation.Y);
+		LevelFreeSpace.Occupy(FIntRect(Center - FIntPoint(HalfSize, HalfSize), Center + FIntPoint(HalfSize, HalfSize)));
+	}
+}
+
+bool AMineGenerator::TryPlaceRoomOnLevel(int32 LevelIndex)
+{
+	if (RoomPlacementStrategy == ERoomPlacementStrategy::FreeRectPacking)
+	{
+		return TryPackRoomOnLevel(LevelIndex);
+	}
+
+	int32 RandomRoomTypeIndex = 0;
+	FSG_GridCoordinate Coord;
+	FRotator SpawnRotation;
+	SampleRoomPlacement(LevelIndex, RandomRoomTypeIndex, Coord, SpawnRotation);
+	TSubclassOf<ACityGen_RoomBase> SelectedRoomType = RoomTypes[RandomRoomTypeIndex];
+	FVector SpawnLocationWS = GridCmpt->GridToWorld(Coord);
+
+	UE_LOG(LogCityGen, Verbose, TEXT("SpawnLocation ints: X=%d, Y=%d, Z=%d"),
+		Coord.X, Coord.Y, Coord.Z);
+	UE_LOG(LogCityGen, Verbose, TEXT("SpawnLocation: X=%f, Y=%f, Z=%f"),
+		SpawnLocationWS.X, SpawnLocationWS.Y, SpawnLocationWS.Z);
 
-			int32 RandomRoomTypeIndex = MineGenRandomStream.RandRange(0, RoomTypes.Num() - 1);
-			TSubclassOf<ACityGen_RoomBase> SelectedRoomType = RoomTypes[RandomRoomTypeIndex];
+	// ensure rooms are not directly on top of the other z +- 1 (do we need this?)
+	if (IsTooCloseVertically(Coord))
+	{
+		return false; // Skip spawning this room
+	}
 
-			int32 SpawnLocationX = MineGenRandomStream.RandRange(-GridWidth / 2, GridWidth/2); // spawns randomly in the middle of the level
-			int32 SpawnLocationY = MineGenRandomStream.RandRange(-GridHeight / 2, GridHeight/2);
-			int32 SpawnLocationZ = LevelIndex; // Adjust Z based on level index
+	ACityGen_RoomBase* NewRoom = SpawnRoom(SelectedRoomType, SpawnLocationWS, SpawnRotation);
+
+	AllSpawnedRooms.Add(NewRoom);
+	OccupiedGridCells.Add(Coord);
+	return true;
+}
+
+void AMineGenerator::SampleRoomPlacement(int32 LevelIndex, int32& OutRoomTypeIndex, FSG_GridCoordinate& OutCoord, FRotator& OutRotation)
+{
+	OutRoomTypeIndex = MineGenRandomStream.RandRange(0, RoomTypes.Num() - 1);
 
-			FSG_GridCoordinate Coord(SpawnLocationX, SpawnLocationY, SpawnLocationZ);
-			FVector SpawnLocationWS = GridCmpt->GridToWorld(Coord);
-			FRotator SpawnRotation = FRotator(0, MineGenRandomStream.RandRange(0, 3) * 90.0f, 0); // randomise rotation based on 90 degree increments only on yaw
+	int32 SpawnLocationX = MineGenRandomStream.RandRange(-GridWidth / 2, GridWidth/2); // spawns randomly in the middle of the level
+	int32 SpawnLocationY = MineGenRandomStream.RandRange(-GridHeight / 2, GridHeight/2);
+	int32 SpawnLocationZ = LevelIndex; // Adjust Z based on level index
+	OutCoord = FSG_GridCoordinate(SpawnLocationX, SpawnLocationY, SpawnLocationZ);
 
-			UE_LOG(LogTemp, Warning, TEXT("SpawnLocation ints: X=%d, Y=%d, Z=%d"),
-				SpawnLocationX, SpawnLocationY, SpawnLocationZ);
-			UE_LOG(LogTemp, Warning, TEXT("SpawnLocation: X=%f, Y=%f, Z=%f"),
-				SpawnLocationWS.X, SpawnLocationWS.Y, SpawnLocationWS.Z);
+	OutRotation = FRotator(0, MineGenRandomStream.RandRange(0, 3) * 90.0f, 0); // randomise rotation based on 90 degree increments only on yaw
+}
+
+bool AMineGenerator::TryPackRoomOnLevel(int32 LevelIndex)
+{
+	if (RoomTypes.Num() == 0)
+	{
+		return false;
+	}
 
-			// ensure rooms are not directly on top of the other z +- 1 (do we need this?)
-			bool bTooCloseVertically = false;
-			for (const FSG_GridCoordinate& Occupied : OccupiedGridCells)
+	// Same number of random values whatever is found, so the placements only depend on the seed
+	const int32 FirstRoomTypeIndex = MineGenRandomStream.RandRange(0, RoomTypes.Num() - 1);
+	const bool bFlipRoom = MineGenRandomStream.RandBool();
+
+	for (int32 TypeOffset = 0; TypeOffset < RoomTypes.Num(); ++TypeOffset)
+	{
+		const TSubclassOf<ACityGen_RoomBase> RoomType = RoomTypes[(FirstRoomTypeIndex + TypeOffset) % RoomTypes.Num()];
+		if (!RoomType)
+		{
+			continue;
+		}
+
+		const FIntPoint Footprint = GetRoomFootprint(RoomType);
+		FIntRect PaddedRect;
+		bool bRotated = false;
+		if (!LevelFreeSpace.FindPosition(Footprint + FIntPoint(RoomSpacing, RoomSpacing), PaddedRect, bRotated))
+		{
+			continue;
+		}
+		LevelFreeSpace.Occupy(PaddedRect);
+
+		// The room is in the low corner of the rectangle, the spacing after it
+		const FIntPoint RoomSize = bRotated ? FIntPoint(Footprint.Y, Footprint.X) : Footprint;
+		const FIntRect RoomRect(PaddedRect.Min, PaddedRect.Min + RoomSize);
+		CurrentLevelRoomRects.Add(RoomRect);
+		for (int32 X = RoomRect.Min.X; X < RoomRect.Max.X; ++X)
+		{
+			for (int32 Y = RoomRect.Min.Y; Y < RoomRect.Max.Y; ++Y)
 			{
-				if (Occupied.X == Coord.X && Occupied.Y == Coord.Y &&
-					FMath::Abs(Occupied.Z - Coord.Z) <= 1)
-				{
-					bTooCloseVertically = true;
-					break;
-				}
+				OccupiedGridCells.Add(FSG_GridCoordinate(X, Y, LevelIndex));
 			}
+		}
+
+		// Rooms are centered on their location, the cell in the middle of the footprint
+		const FSG_GridCoordinate Coord(RoomRect.Min.X + RoomSize.X / 2, RoomRect.Min.Y + RoomSize.Y / 2, LevelIndex);
+		const FVector SpawnLocationWS = GridCmpt->GridToWorld(Coord);
+		const FRotator SpawnRotation(0, (bRotated ? 90.0f : 0.0f) + (bFlipRoom ? 180.0f : 0.0f), 0);
+
+		ACityGen_RoomBase* NewRoom = SpawnRoom(RoomType, SpawnLocationWS, SpawnRotation);
+		AllSpawnedRooms.Add(NewRoom);
+		return true;
+	}
+	return false;
+}
+
+FIntPoint AMineGenerator::GetRoomFootprint(TSubclassOf<ACityGen_RoomBase> RoomClass)
+{
+	if (const FIntPoint* pFootprint = RoomFootprintCache.Find(RoomClass))
+	{
+		return *pFootprint;
+	}
+
+	// The bounds boxes are components of the room blueprint, so a room is spawned to read them, then given to the pool
+	FIntPoint Footprint(1, 1);
+	ACityGen_RoomBase* Room = SpawnRoom(RoomClass, RoomActorPool->ParkingLocation, FRotator::ZeroRotator);
+	if (Room != nullptr)
+	{
+		Footprint = Room->GetRoomTileFootprint();
+		RoomActorPool->ReleaseActor(Room);
+	}
+	RoomFootprintCache.Add(RoomClass, Footprint);
+	return Footprint;
+}
 
-			if (bTooCloseVertically)
+FIntRect AMineGenerator::GetPlacementArea() const
+{
+	return FIntRect(FIntPoint(-GridWidth / 2, -GridHeight / 2), FIntPoint(GridWidth / 2 + 1, GridHeight / 2 + 1));
+}
+
+#if WITH_EDITOR
+void AMineGenerator::BenchmarkRoomPlacement()
+{
+	if (RoomTypes.Num() == 0)
+	{
+		UE_LOG(LogCityGen, Warning, TEXT("BenchmarkRoomPlacement: no room type"));
+		return;
+	}
+
+	// The settings and the placed cells are changed by the runs, nothing is spawned
+	const int32 PreviousGridWidth = GridWidth;
+	const int32 PreviousGridHeight = GridHeight;
+	const FRandomStream PreviousRandomStream = MineGenRandomStream;
+	const FSG_GridColumnSet PreviousOccupiedGridCells = OccupiedGridCells;
+
+	// Same attempts as GenerateMine on 8 levels, MaxAttempts = NumRooms * 10 per level
+	// The grid grows with the number of rooms so the rate of rejected attempts stays the same
+	const int32 NumLevels = 8;
+	for (const int32 NumRooms : { 1250, 2500, 5000, 10000 })
+	{
+		const int32 NumRoomsPerLevel = NumRooms / NumLevels;
+		GridWidth = FMath::CeilToInt(FMath::Sqrt(NumRoomsPerLevel * 4.0f));
+		GridHeight = GridWidth;
+
+		// The attempts of TryPlaceRoomOnLevel without the spawn, only the clearance test and the added cell change
+		// @return: number of rooms placed
+		auto RunPlacement = [&](auto&& IsTooClose, auto&& AddCell)
+		{
+			MineGenRandomStream.Initialize(RandomSeed);
+			int32 NumPlaced = 0;
+			for (int32 LevelIndex = 0; LevelIndex < NumLevels; ++LevelIndex)
 			{
-				continue; // Skip spawning this room
+				const int32 MaxAttempts = NumRoomsPerLevel * 10;
+				int32 Spawned = 0;
+				for (int32 Attempts = 0; (Spawned < NumRoomsPerLevel) && (Attempts < MaxAttempts); ++Attempts)
+				{
+					int32 RoomTypeIndex = 0;
+					FSG_GridCoordinate Coord;
+					FRotator Rotation;
+					SampleRoomPlacement(LevelIndex, RoomTypeIndex, Coord, Rotation);
+					if (!IsTooClose(Coord))
+					{
+						AddCell(Coord);
+						++Spawned;
+					}
+				}
+				NumPlaced += Spawned;
 			}
-
-			ACityGen_RoomBase* NewRoom = GetWorld()->SpawnActor<ACityGen_RoomBase>(SelectedRoomType, SpawnLocationWS, SpawnRotation);
-				
-			AllSpawnedRooms.Add(NewRoom);
-			OccupiedGridCells.Add(Coord);
-			++Spawned;
-			
-		}
+			return NumPlaced;
+		};
+
+		OccupiedGridCells.Empty();
+		double StartTime = FPlatformTime::Seconds();
+		const int32 NumPlacedColumns = RunPlacement(
+			[this](const FSG_GridCoordinate& Coord) { return IsTooCloseVertically(Coord); },
+			[this](const FSG_GridCoordinate& Coord) { OccupiedGridCells.Add(Coord); });
+		const double ColumnSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// Reference: the Morton cell set used before the column index, three lookups per attempt
+		FSG_MortonCellSet MortonCells;
+		StartTime = FPlatformTime::Seconds();
+		const int32 NumPlacedMorton = RunPlacement(
+			[&MortonCells](const FSG_GridCoordinate& Coord)
+			{
+				return MortonCells.Contains(FSG_GridCoordinate(Coord.X, Coord.Y, Coord.Z - 1))
+					|| MortonCells.Contains(Coord)
+					|| MortonCells.Contains(FSG_GridCoordinate(Coord.X, Coord.Y, Coord.Z + 1));
+			},
+			[&MortonCells](const FSG_GridCoordinate& Coord) { MortonCells.Add(Coord); });
+		const double MortonSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogCityGen, Display, TEXT("Benchmark room placement: %d rooms, grid %dx%dx%d, %d placed, column index %.3f ms (%.1f ns per room), Morton cell set %.3f ms (%.1f ns per room), same result=%d"),
+			NumRooms, GridWidth + 1, GridHeight + 1, NumLevels, NumPlacedColumns,
+			ColumnSeconds * 1000.0, ColumnSeconds * 1e9 / FMath::Max(NumPlacedColumns, 1),
+			MortonSeconds * 1000.0, MortonSeconds * 1e9 / FMath::Max(NumPlacedMorton, 1),
+			(NumPlacedColumns == NumPlacedMorton) ? 1 : 0);
 	}
 
-	// After all rooms are spawned, we can now generate corridors between them
-	bool bSuccess = false;
+	GridWidth = PreviousGridWidth;
+	GridHeight = PreviousGridHeight;
+	MineGenRandomStream = PreviousRandomStream;
+	OccupiedGridCells = PreviousOccupiedGridCells;
+}
+#endif // WITH_EDITOR
+
+ADungeonGenerator_GridBased* AMineGenerator::PrepareGeneratorForConnection()
+{
 	if ((GeneratorType == EGeneratorType::Star) && AllSpawnedRooms.Num() > 0) // we can skip SetRoomsToConnect
 	{
 		ADungeonGenerator_Star* StarGenerator = Cast<ADungeonGenerator_Star>(DungeonGeneratorInstance);
@@ -156,32 +443,167 @@ bool AMineGenerator::GenerateMine()
 			{
 				StarGenerator->CentralRoom = CentralRoomActor;
 				StarGenerator->InitFromSpawnedRooms( AllSpawnedRooms );
-				bSuccess = StarGenerator->ConnectRoomsInOrder();
+				return StarGenerator;
 			}
 			else
 			{
 				UE_LOG(LogTemp, Warning, TEXT("Central room is null"));
-				bSuccess = false;
+				return nullptr;
 			}
 		}
 		else
 		{
 			UE_LOG(LogTemp, Warning, TEXT("Central room has issues"));
-			bSuccess = false;
+			return nullptr;
 		}
 	}
-	else
+
+	DungeonGeneratorInstance->InitFromSpawnedRooms(AllSpawnedRooms);
+	return DungeonGeneratorInstance;
+}
+
+bool AMineGenerator::StartTimeSlicedGeneration()
+{
+	if (!DungeonGeneratorInstance)
 	{
-		DungeonGeneratorInstance->InitFromSpawnedRooms(AllSpawnedRooms);
-		bSuccess = DungeonGeneratorInstance->ConnectRoomsInOrder();
+		UE_LOG(LogTemp, Warning, TEXT("DungeonGeneratorInstance is not initialized. Cannot generate mine."));
+		return false;
 	}
-	
+
+	AllSpawnedRooms.Empty();
+	SpawnedCorridors.Empty();
+	OccupiedGridCells.Empty();
+
+	PlacementLevelIndex = 0;
+	PlacementAttempts = 0;
+	PlacementSpawned = 0;
+	ConnectingGenerator = nullptr;
+
+	GenerationStage = EMineGenerationStage::PlaceRooms;
+	SetActorTickEnabled(true);
+	return true;
+}
+
+void AMineGenerator::StepGeneration(double DeadlineSeconds)
+{
+	// At least one step per call, so the generation always moves forward even with a tiny budget
+	do
+	{
+		switch (GenerationStage)
+		{
+		case EMineGenerationStage::PlaceRooms:
+		{
+			if (PlacementLevelIndex >= RoomsPerLevel.Num())
+			{
+				GenerationStage = EMineGenerationStage::SnapRooms;
+				break;
+			}
+
+			const int32 NumRooms = RoomsPerLevel[PlacementLevelIndex];
+			const int32 MaxAttempts = NumRooms * 10;
+			if (PlacementAttempts == 0)
+			{
+				BeginPlacementLevel(PlacementLevelIndex);
+			}
+
+			bool bLevelDone = (PlacementSpawned >= NumRooms) || (PlacementAttempts >= MaxAttempts);
+			if (!bLevelDone)
+			{
+				++PlacementAttempts;
+				if (TryPlaceRoomOnLevel(PlacementLevelIndex))
+				{
+					++PlacementSpawned;
+				}
+				else
+				{
+					bLevelDone = !CanRetryFailedPlacement();
+				}
+			}
+
+			if (bLevelDone)
+			{
+				if (PlacementSpawned < NumRooms)
+				{
+					UE_LOG(LogCityGen, Warning, TEXT("Level %d: %d of %d rooms placed"), PlacementLevelIndex, PlacementSpawned, NumRooms);
+				}
+				++PlacementLevelIndex;
+				PlacementAttempts = 0;
+				PlacementSpawned = 0;
+			}
+			break;
+		}
+		case EMineGenerationStage::SnapRooms:
+			ConnectingGenerator = PrepareGeneratorForConnection();
+			if (ConnectingGenerator == nullptr || !ConnectingGenerator->PlanCorridors_SnapRooms())
+			{
+				UE_LOG(LogCityGen, Error, TEXT("No path found"));
+				FinishGeneration(false);
+				break;
+			}
+			GenerationStage = EMineGenerationStage::BlockTiles;
+			break;
+		case EMineGenerationStage::BlockTiles:
+			ConnectingGenerator->PlanCorridors_BlockTiles();
+			GenerationStage = EMineGenerationStage::FindPaths;
+			break;
+		case EMineGenerationStage::FindPaths:
+			if (ConnectingGenerator->PlanCorridors_StepPairs(DeadlineSeconds))
+			{
+				if (!ConnectingGenerator->PlanCorridors_Finish())
+				{
+					UE_LOG(LogCityGen, Error, TEXT("No path found"));
+					FinishGeneration(false);
+					break;
+				}
+				ConnectingGenerator->BeginSpawnCorridors();
+				GenerationStage = EMineGenerationStage::SpawnCorridors;
+			}
+			break;
+		case EMineGenerationStage::SpawnCorridors:
+			if (ConnectingGenerator->StepSpawnCorridors(DeadlineSeconds))
+			{
+				GenerationStage = EMineGenerationStage::UpdateDoors;
+			}
+			break;
+		case EMineGenerationStage::UpdateDoors:
+			ConnectingGenerator->FinishSpawnCorridors();
+			FinishGeneration(true);
+			break;
+		default:
+			return;
+		}
+	}
+	while (GenerationStage != EMineGenerationStage::Done && GenerationStage != EMineGenerationStage::Failed && FPlatformTime::Seconds() < DeadlineSeconds);
+}
+
+float AMineGenerator::GetGenerationStageProgress() const
+{
+	switch (GenerationStage)
+	{
+	case EMineGenerationStage::PlaceRooms:
+		return (RoomsPerLevel.Num() > 0) ? (float)PlacementLevelIndex / (float)RoomsPerLevel.Num() : 1.0f;
+	case EMineGenerationStage::FindPaths:
+		return ConnectingGenerator->GetPlanCorridorsProgress();
+	case EMineGenerationStage::SpawnCorridors:
+		return ConnectingGenerator->GetSpawnCorridorsProgress();
+	case EMineGenerationStage::Done:
+		return 1.0f;
+	default:
+		return 0.0f;
+	}
+}
+
+void AMineGenerator::FinishGeneration(bool bSuccess)
+{
 	if (!bSuccess)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Failed to connect rooms with corridors."));
-		return false;
 	}
-	return true;
+
+	GenerationStage = bSuccess ? EMineGenerationStage::Done : EMineGenerationStage::Failed;
+	ConnectingGenerator = nullptr;
+	SetActorTickEnabled(false);
+	OnGenerationComplete.Broadcast(bSuccess);
 }
 
 
@@ -195,7 +617,7 @@ ACityGen_RoomBase* AMineGenerator::SpawnCentralRoom()
 			FVector CentralRoomLocation = GridCmpt->GridToWorld(StarSettings.CentralRoomGridLocation);
 			FRotator CentralRoomRotation = FRotator(0, MineGenRandomStream.RandRange(0, 3) * 90.0f, 0); // randomise rotation based on 90 degree increments only on yaw
 			// Spawn the central room actor
-			CentralRoomActor = GetWorld()->SpawnActor<ACityGen_RoomBase>(StarSettings.CentralRoom, CentralRoomLocation, CentralRoomRotation);
+			CentralRoomActor = SpawnRoom(StarSettings.CentralRoom, CentralRoomLocation, CentralRoomRotation);
 			
 			AllSpawnedRooms.Add(CentralRoomActor);
 
@@ -6,33 +6,74 @@
 
 #include "CoreMinimal.h"
 
+// Bits of FCellConnectionState::GetConnectionMask, the horizontal ones in the order of SG_GetRotNormForDirection
+namespace CellConnectionMask
+{
+	constexpr uint8 North = 1 << 0;
+	constexpr uint8 East = 1 << 1;
+	constexpr uint8 South = 1 << 2;
+	constexpr uint8 West = 1 << 3;
+	constexpr uint8 Up = 1 << 4;
+	constexpr uint8 Down = 1 << 5;
+
+	constexpr uint8 Horizontal = North | East | South | West;
+	constexpr int32 NumMasks = 64;
+}
+
+// Connections of a corridor cell packed in 16 bits: the CellConnectionMask bits, then the room flag of each horizontal direction
 struct FCellConnectionState
 {
 public:
-	bool bConnectNorth = false;
-
-	bool bNorthIsARoom = false;
+	// Room flag of the horizontal direction d (rotation norm) is bit RoomShift + d
+	static constexpr int32 RoomShift = 6;
 
-	bool bConnectEast = false;
+private:
+	uint16 Bits = 0;
 
-	bool bEastIsARoom = false;
+public:
+	void MakeConnection(const FSG_GridCoordinate& OurCoords, const FSG_GridCoordinate& OtherCoords, bool bIsARoom);
 
-	bool bConnectSouth = false;
+	// Connected directions, see CellConnectionMask
+	FORCEINLINE uint8 GetConnectionMask() const
+	{
+		return uint8(Bits & 0x3f);
+	}
 
-	bool bSouthIsARoom = false;
+	// @param RotNorm: horizontal direction, see SG_GetRotNormForDirection
+	FORCEINLINE bool IsConnected(int32 RotNorm) const
+	{
+		return (Bits & (1 << RotNorm)) != 0;
+	}
 
-	bool bConnectWest = false;
+	FORCEINLINE bool IsARoom(int32 RotNorm) const
+	{
+		return (Bits & (1 << (RoomShift + RotNorm))) != 0;
+	}
 
-	bool bWestIsARoom = false;
+	FORCEINLINE bool IsConnectedNorth() const { return (Bits & CellConnectionMask::North) != 0; }
+	FORCEINLINE bool IsConnectedEast() const { return (Bits & CellConnectionMask::East) != 0; }
+	FORCEINLINE bool IsConnectedSouth() const { return (Bits & CellConnectionMask::South) != 0; }
+	FORCEINLINE bool IsConnectedWest() const { return (Bits & CellConnectionMask::West) != 0; }
+	FORCEINLINE bool IsConnectedUp() const { return (Bits & CellConnectionMask::Up) != 0; }
+	FORCEINLINE bool IsConnectedDown() const { return (Bits & CellConnectionMask::Down) != 0; }
 
-	bool bConnectUp = false;
+	FORCEINLINE bool IsVertical() const
+	{
+		return (Bits & (CellConnectionMask::Up | CellConnectionMask::Down)) != 0;
+	}
 
-	bool bConnectDown = false;
+	FORCEINLINE int32 GetHorizontalConnectionCount() const
+	{
+		return (int32)FMath::CountBits(uint64(Bits & CellConnectionMask::Horizontal));
+	}
 
-public:
-	void MakeConnection(const FSG_GridCoordinate& OurCoords, const FSG_GridCoordinate& OtherCoords, bool bIsARoom);
-	
-	int32 GetHorizontalConnectionCount() const;
+	FORCEINLINE bool operator==(const FCellConnectionState& Other) const
+	{
+		return Bits == Other.Bits;
+	}
 
-	TArray<bool> GetDirectionArray() const;
+	FORCEINLINE bool operator!=(const FCellConnectionState& Other) const
+	{
+		return Bits != Other.Bits;
+	}
 };
@@ -0,0 +1,94 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+
+#include "CityGen_ActorPool.generated.h"
+
+USTRUCT()
+struct FCityGen_PooledActors
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> Actors;
+};
+
+// Actors released by a generator are parked here instead of being destroyed: hidden, without collision and tick,
+// and moved to ParkingLocation. The next generation takes them back instead of spawning new ones, one pool per class
+// Only used in game worlds, in editor worlds the actors are destroyed and spawned as before so the level never saves parked actors
+UCLASS(ClassGroup = (ProceduralCityGenerator), meta = (BlueprintSpawnableComponent))
+class PROCEDURALCITYGENERATOR_API UCityGen_ActorPoolComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Parked actors kept per class, an actor released in a full pool is destroyed
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pool", meta = (ClampMin = "0"))
+	int32 MaxPooledActorsPerClass = 256;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pool")
+	FVector ParkingLocation = FVector(0.0, 0.0, -100000.0);
+
+	// Actors spawned by the pool, and actors taken back from it
+	UPROPERTY(VisibleAnywhere, Transient, BlueprintReadOnly, Category = "Pool")
+	int32 NumSpawnedActors = 0;
+
+	UPROPERTY(VisibleAnywhere, Transient, BlueprintReadOnly, Category = "Pool")
+	int32 NumReusedActors = 0;
+
+private:
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FCityGen_PooledActors> Pools;
+
+public:
+	UCityGen_ActorPoolComponent();
+
+	// Take a parked actor of the class and move it to Transform, or spawn one if the pool of the class is empty
+	UFUNCTION(BlueprintCallable, Category = "Pool")
+	AActor* AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform);
+
+	// @param bOutReused: true if the actor was parked, its state is the one it had when released
+	template<typename ActorType>
+	ActorType* Acquire(TSubclassOf<ActorType> ActorClass, const FTransform& Transform, bool& bOutReused)
+	{
+		return Cast<ActorType>(AcquireInternal(ActorClass, Transform, bOutReused));
+	}
+
+	// Park the actor, or destroy it if the pool of its class is full
+	UFUNCTION(BlueprintCallable, Category = "Pool")
+	void ReleaseActor(AActor* Actor);
+
+	// Spawn parked actors until the pool of the class holds Count of them, for a loading screen
+	// Count is clamped to MaxPooledActorsPerClass
+	UFUNCTION(BlueprintCallable, Category = "Pool")
+	void WarmUp(TSubclassOf<AActor> ActorClass, int32 Count);
+
+	// Change the pool size, for example between levels. Parked actors above the new size are destroyed
+	UFUNCTION(BlueprintCallable, Category = "Pool")
+	void SetMaxPooledActorsPerClass(int32 NewMaxPooledActorsPerClass);
+
+	// Destroy every parked actor
+	UFUNCTION(BlueprintCallable, Category = "Pool")
+	void EmptyPool();
+
+	UFUNCTION(BlueprintPure, Category = "Pool")
+	int32 GetNumPooledActors(TSubclassOf<AActor> ActorClass) const;
+
+	UFUNCTION(BlueprintPure, Category = "Pool")
+	int32 GetTotalNumPooledActors() const;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	AActor* AcquireInternal(UClass* ActorClass, const FTransform& Transform, bool& bOutReused);
+
+	// Deferred spawn, a parked actor is hidden before its construction script and BeginPlay so it is never seen
+	AActor* SpawnActor(UClass* ActorClass, const FTransform& Transform, bool bSpawnParked);
+
+	void ParkActor(AActor* Actor) const;
+
+	bool UsePool() const;
+};
@@ -0,0 +1,97 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CellConnectionState.h"
+
+#include "SimpleGridRuntime/Public/SG_GridBitVolume.h"
+#include "SimpleGridRuntime/Public/SG_GridCoordinate.h"
+#include "SimpleGridRuntime/Public/SG_MortonKey.h"
+
+#include "CoreMinimal.h"
+
+// Connections of the corridor cells, stored by chunks of 4x4x4 cells
+// The chunk of a cell is its Morton code without the 6 lowest bits (see FSG_MortonCellSet), the cells of a chunk are
+// contiguous and ForEach visits the chunks in the order they were created, so iterating follows the memory
+// A bit volume over the search bounds mirrors which cells are corridors, Contains is a bit test inside of the bounds
+struct PROCEDURALCITYGENERATOR_API FCityGen_CorridorCellStore
+{
+public:
+	static constexpr int32 CellsPerChunk = 64;
+
+private:
+	struct FChunk
+	{
+		uint64 ChunkCode = 0;
+		uint64 UsedCells = 0;
+		FCellConnectionState Cells[CellsPerChunk];
+	};
+
+	TArray<FChunk> Chunks;
+	TMap<uint64, int32> ChunkIndices;
+	int32 NumCells = 0;
+
+	// Empty until SetBounds
+	FSG_GridBitVolume CellBits;
+
+public:
+	// Cover the box with the bit volume, cells outside of it are still stored and found through the chunks
+	void SetBounds(const FSG_GridCoordinate& Origin, const FIntVector& Size);
+
+	FORCEINLINE bool Contains(const FSG_GridCoordinate& Coord) const
+	{
+		if (CellBits.IsInside(Coord))
+		{
+			return CellBits.IsSet(Coord);
+		}
+		return Find(Coord) != nullptr;
+	}
+
+	const FCellConnectionState* Find(const FSG_GridCoordinate& Coord) const;
+
+	// Add the cell without connection if it is not stored yet
+	FCellConnectionState& FindOrAdd(const FSG_GridCoordinate& Coord);
+
+	// The cell must be stored
+	const FCellConnectionState& operator[](const FSG_GridCoordinate& Coord) const
+	{
+		const FCellConnectionState* pState = Find(Coord);
+		check(pState != nullptr);
+		return *pState;
+	}
+
+	int32 Num() const
+	{
+		return NumCells;
+	}
+
+	// In the order of ForEach
+	void GetKeys(TArray<FSG_GridCoordinate>& OutCoords) const;
+
+	// Release the memory, the bounds are removed too
+	void Empty();
+
+	// Keep the memory and the bounds
+	void Reset();
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Chunks.GetAllocatedSize() + ChunkIndices.GetAllocatedSize() + CellBits.GetAllocatedSize();
+	}
+
+	// @param Functor: void(const FSG_GridCoordinate& Coord, const FCellConnectionState& State)
+	template<typename FunctorType>
+	void ForEach(FunctorType&& Functor) const
+	{
+		for (const FChunk& Chunk : Chunks)
+		{
+			uint64 UsedCells = Chunk.UsedCells;
+			while (UsedCells != 0)
+			{
+				const int32 CellIndex = (int32)FMath::CountTrailingZeros64(UsedCells);
+				UsedCells &= UsedCells - 1;
+				Functor(FSG_MortonKey::Decode((Chunk.ChunkCode << FSG_MortonCellSet::BrickShift) | (uint64)CellIndex), Chunk.Cells[CellIndex]);
+			}
+		}
+	}
+};
@@ -0,0 +1,492 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "SimpleGridRuntime/Public/SG_GridCoordinate.h"
+
+#include "CoreMinimal.h"
+
+// Cost of a step into a cell already used by a corridor, so that the corridors are shared. Used by every search
+namespace CityGenCorridorCost
+{
+	// The integer costs are divided by it
+	constexpr int32 CorridorCellCostDivisor = 2;
+
+	// The float costs are multiplied by it
+	constexpr float MovementReductionFactorForCellWithCorridor = 1.0f / CorridorCellCostDivisor;
+}
+
+// Inclusive box of grid cells
+struct PROCEDURALCITYGENERATOR_API FCityGen_GridBounds
+{
+public:
+	FSG_GridCoordinate Min = {};
+
+	FSG_GridCoordinate Max = {};
+
+	bool bIsValid = false;
+
+public:
+	void Reset();
+
+	void Add(const FSG_GridCoordinate& Coord);
+
+	void ExpandBy(const FIntVector& Margin);
+
+	bool Contains(const FSG_GridCoordinate& Coord) const
+	{
+		return bIsValid &&
+			(Coord.X >= Min.X) && (Coord.X <= Max.X) &&
+			(Coord.Y >= Min.Y) && (Coord.Y <= Max.Y) &&
+			(Coord.Z >= Min.Z) && (Coord.Z <= Max.Z);
+	}
+
+	// Number of cells on each axis
+	FIntVector GetSize() const;
+};
+
+// Per cell data of a corridor search, stored in flat arrays covering a bounded box of the dungeon grid
+// Cells are indexed X first, then Y, then Z
+// The parent of a node is stored as a direction (3 bits) instead of a coordinate, so a node only cost 9 bytes
+// (plus 2 bytes when the parent can be more than one cell away, see ParentJumpLength)
+// The arrays are kept between searches: a cell is only valid if its generation is the one of the current search,
+// so Init does not clear memory and only allocates when the bounds grow
+struct PROCEDURALCITYGENERATOR_API FCityGen_DenseSearchStorage
+{
+public:
+	// Directions, same order as FSG_GridNeighbours and USG_GridComponent::GetNeighbourNodes3D
+	static constexpr int32 NumDirections = 6;
+	static const FSG_GridCoordinate DirectionOffsets[NumDirections];
+
+	// Node flags layout
+	static constexpr uint8 ParentDirectionMask = 0x07;
+	static constexpr uint8 ParentDirectionNone = 0x07;
+	static constexpr uint8 StateOpen = 1 << 3;
+	static constexpr uint8 StateClosed = 1 << 4;
+	static constexpr uint8 StateGoal = 1 << 5;
+	static constexpr uint8 StateExpanded = 1 << 6; // Kept when a closed node is re-opened
+
+	static constexpr int32 MaxParentJumpLength = MAX_uint16;
+
+	FCityGen_GridBounds Bounds;
+
+	// Number of times the arrays had to grow since the storage was created
+	int32 NumAllocations = 0;
+
+private:
+	TArray<float> GCost;
+
+	TArray<uint8> NodeFlags;
+
+	// Number of cells between a node and its parent, following the parent direction
+	// Only used by searches with jumps, otherwise the parent is always the adjacent cell
+	TArray<uint16> ParentJumpLength;
+
+	// Search generation of each cell, the data of a cell stamped by a previous search is not valid
+	TArray<uint32> CellGeneration;
+
+	uint32 Generation = 0;
+
+	bool bUseJumpLengths = false;
+
+	int32 StrideY = 0;
+	int32 StrideZ = 0;
+
+public:
+	// Reset all the nodes: no cost, no parent, not open or closed
+	// O(1) unless the bounds contain more cells than any previous search
+	void Init(const FCityGen_GridBounds& InBounds, bool bWithJumpLengths = false);
+
+	// Release the memory
+	void Empty();
+
+	// Every cell from EndIndex to the start node following the parents, both included
+	void GetPath(int32 EndIndex, TArray<FSG_GridCoordinate>& OutPath) const;
+
+	bool IsInside(const FSG_GridCoordinate& Coord) const
+	{
+		return Bounds.Contains(Coord);
+	}
+
+	// Coord need to be inside the bounds
+	int32 ToIndex(const FSG_GridCoordinate& Coord) const
+	{
+		return (Coord.X - Bounds.Min.X) + (Coord.Y - Bounds.Min.Y) * StrideY + (Coord.Z - Bounds.Min.Z) * StrideZ;
+	}
+
+	FSG_GridCoordinate ToCoord(int32 Index) const
+	{
+		const int32 Z = Index / StrideZ;
+		const int32 Y = (Index - Z * StrideZ) / StrideY;
+		const int32 X = Index - Z * StrideZ - Y * StrideY;
+		return FSG_GridCoordinate(Bounds.Min.X + X, Bounds.Min.Y + Y, Bounds.Min.Z + Z);
+	}
+
+	bool IsTouched(int32 Index) const
+	{
+		return CellGeneration[Index] == Generation;
+	}
+
+	// Max float if the node was not reached by the current search
+	float GetGCost(int32 Index) const
+	{
+		return IsTouched(Index) ? GCost[Index] : TNumericLimits<float>::Max();
+	}
+
+	void SetGCost(int32 Index, float Cost)
+	{
+		Touch(Index);
+		GCost[Index] = Cost;
+	}
+
+	uint8 GetParentDirection(int32 Index) const
+	{
+		return IsTouched(Index) ? (NodeFlags[Index] & ParentDirectionMask) : ParentDirectionNone;
+	}
+
+	// Direction is the one going from the node to its parent
+	void SetParentDirection(int32 Index, uint8 Direction)
+	{
+		Touch(Index);
+		NodeFlags[Index] = (NodeFlags[Index] & ~ParentDirectionMask) | (Direction & ParentDirectionMask);
+	}
+
+	int32 GetParentJumpLength(int32 Index) const
+	{
+		return (bUseJumpLengths && IsTouched(Index)) ? ParentJumpLength[Index] : 1;
+	}
+
+	// Only valid if initialized with jump lengths
+	void SetParentJumpLength(int32 Index, int32 Length)
+	{
+		check(bUseJumpLengths && (Length > 0) && (Length <= MaxParentJumpLength));
+		Touch(Index);
+		ParentJumpLength[Index] = (uint16)Length;
+	}
+
+	bool IsOpen(int32 Index) const
+	{
+		return IsTouched(Index) && ((NodeFlags[Index] & StateOpen) != 0);
+	}
+
+	bool IsClosed(int32 Index) const
+	{
+		return IsTouched(Index) && ((NodeFlags[Index] & StateClosed) != 0);
+	}
+
+	void SetOpen(int32 Index)
+	{
+		Touch(Index);
+		NodeFlags[Index] = (NodeFlags[Index] & ~StateClosed) | StateOpen;
+	}
+
+	void SetClosed(int32 Index)
+	{
+		Touch(Index);
+		NodeFlags[Index] = (NodeFlags[Index] & ~StateOpen) | StateClosed | StateExpanded;
+	}
+
+	// True if the node was closed at least once by the current search, even if it was re-opened since
+	bool WasExpanded(int32 Index) const
+	{
+		return IsTouched(Index) && ((NodeFlags[Index] & StateExpanded) != 0);
+	}
+
+	// Reaching a goal ends the search, a search can have several goals
+	bool IsGoal(int32 Index) const
+	{
+		return IsTouched(Index) && ((NodeFlags[Index] & StateGoal) != 0);
+	}
+
+	void SetGoal(int32 Index)
+	{
+		Touch(Index);
+		NodeFlags[Index] |= StateGoal;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return GCost.GetAllocatedSize() + NodeFlags.GetAllocatedSize() + ParentJumpLength.GetAllocatedSize() + CellGeneration.GetAllocatedSize();
+	}
+
+	static uint8 GetOppositeDirection(uint8 Direction)
+	{
+		// Horizontal directions are a 4 cycle, vertical are the pair 4/5
+		return (Direction < 4) ? ((Direction + 2) & 3) : (Direction ^ 1);
+	}
+
+	// 0: X, 1: Y, 2: Z
+	static int32 GetDirectionAxis(uint8 Direction)
+	{
+		return (Direction < 4) ? (Direction & 1) : 2;
+	}
+
+private:
+	// First write of a cell in the current search: reset its data
+	FORCEINLINE void Touch(int32 Index)
+	{
+		if (CellGeneration[Index] != Generation)
+		{
+			CellGeneration[Index] = Generation;
+			GCost[Index] = TNumericLimits<float>::Max();
+			NodeFlags[Index] = ParentDirectionNone;
+			if (bUseJumpLengths)
+			{
+				ParentJumpLength[Index] = 1;
+			}
+		}
+	}
+};
+
+// Entry of a binary heap open set referencing a cell of a FCityGen_DenseSearchStorage
+// Entries are not removed when a node is improved or closed, stale entries are skipped when popped
+struct FCityGen_DenseOpenEntry
+{
+	float FCost = 0.0f;
+	float HCost = 0.0f;
+	float GCost = 0.0f; // GCost of the node when pushed, used to detect stale entries
+	uint32 Sequence = 0; // Push order
+	int32 CellIndex = INDEX_NONE;
+};
+
+// Lowest F cost first, then lowest H cost (closest to the goal), then first pushed
+struct FCityGen_DenseOpenEntryPredicate
+{
+	FORCEINLINE bool operator()(const FCityGen_DenseOpenEntry& A, const FCityGen_DenseOpenEntry& B) const
+	{
+		if (A.FCost != B.FCost)
+		{
+			return A.FCost < B.FCost;
+		}
+		if (A.HCost != B.HCost)
+		{
+			return A.HCost < B.HCost;
+		}
+		return A.Sequence < B.Sequence;
+	}
+};
+
+// Fixed point costs of the corridor searches, in half cells so that the corridor discount stays exact
+// The Z factor is rounded to an integer number of cells
+struct PROCEDURALCITYGENERATOR_API FCityGen_IntegerCostModel
+{
+public:
+	static constexpr int32 UnitsPerCell = CityGenCorridorCost::CorridorCellCostDivisor;
+
+	int32 HorizontalStepCost = UnitsPerCell;
+
+	int32 VerticalStepCost = UnitsPerCell;
+
+public:
+	FCityGen_IntegerCostModel() = default;
+
+	explicit FCityGen_IntegerCostModel(float DistanceFactorForZ);
+
+	// Cost to move to the adjacent cell in Direction, reduced if that cell is already used by a corridor
+	int32 GetStepCost(uint8 Direction, bool bIsCorridor) const
+	{
+		const int32 StepCost = (FCityGen_DenseSearchStorage::GetDirectionAxis(Direction) == 2) ? VerticalStepCost : HorizontalStepCost;
+		return bIsCorridor ? (StepCost / CityGenCorridorCost::CorridorCellCostDivisor) : StepCost;
+	}
+
+	// Same as GetStepCost between two adjacent cells
+	int32 GetStepCost(const FSG_GridCoordinate& From, const FSG_GridCoordinate& To, bool bIsCorridor) const
+	{
+		const int32 StepCost = (From.Z != To.Z) ? VerticalStepCost : HorizontalStepCost;
+		return bIsCorridor ? (StepCost / CityGenCorridorCost::CorridorCellCostDivisor) : StepCost;
+	}
+
+	// Manhattan distance with the Z factor
+	int32 GetDistance(const FSG_GridCoordinate& A, const FSG_GridCoordinate& B) const
+	{
+		return (FMath::Abs(A.X - B.X) + FMath::Abs(A.Y - B.Y)) * HorizontalStepCost + FMath::Abs(A.Z - B.Z) * VerticalStepCost;
+	}
+};
+
+// Open set with integer priorities, one bucket per priority (Dial's algorithm)
+// Push and pop are O(1) as the step costs are small, entries of a bucket are popped last in first out
+// Entries are not removed when a node is improved or closed, stale entries are skipped when popped
+struct PROCEDURALCITYGENERATOR_API FCityGen_BucketQueue
+{
+public:
+	struct FEntry
+	{
+		int32 CellIndex = INDEX_NONE;
+		int32 GCost = 0; // GCost of the node when pushed, used to detect stale entries
+	};
+
+private:
+	// Kept between searches with their memory
+	TArray<TArray<FEntry>> Buckets;
+
+	// Every bucket below is empty
+	int32 MinPriority = 0;
+
+	// Every bucket above is empty
+	int32 MaxPriority = -1;
+
+	int32 NumEntries = 0;
+
+	int32 NumAllocations = 0;
+
+public:
+	// Empty the buckets without releasing their memory
+	void Reset();
+
+	// Release the memory, the allocation counter is kept
+	void Empty();
+
+	void Push(int32 Priority, const FEntry& Entry);
+
+	// Pop an entry of the lowest priority
+	// @return: false if the queue is empty
+	bool Pop(FEntry& OutEntry);
+
+	int32 Num() const
+	{
+		return NumEntries;
+	}
+
+	// Number of times a bucket or the bucket array had to grow
+	int32 GetNumAllocations() const
+	{
+		return NumAllocations;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+// Storage and open set of a search, kept between searches so that steady state searches do not allocate
+struct PROCEDURALCITYGENERATOR_API FCityGen_SearchWorkspace
+{
+public:
+	FCityGen_DenseSearchStorage Storage;
+
+	TArray<FCityGen_DenseOpenEntry> OpenHeap;
+
+	// Open set of the searches with integer costs
+	FCityGen_BucketQueue OpenBuckets;
+
+	int32 NumSearches = 0;
+
+private:
+	int32 NumHeapAllocations = 0;
+
+	int32 OpenHeapCapacity = 0;
+
+public:
+	// Reset the storage and empty the open sets without releasing their memory
+	void BeginSearch(const FCityGen_GridBounds& Bounds, bool bWithJumpLengths = false);
+
+	// Count the open heap growth of the search
+	void EndSearch();
+
+	// Push in the open heap and flag the node as open
+	void PushOpenNode(int32 CellIndex, float GCost, float HCost, uint32 Sequence);
+
+	// Release the memory, the allocation counters are kept
+	void Empty();
+
+	// Number of times the storage or an open set had to grow since the workspace was created
+	int32 GetNumAllocations() const
+	{
+		return Storage.NumAllocations + NumHeapAllocations + OpenBuckets.GetNumAllocations();
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Storage.GetAllocatedSize() + OpenHeap.GetAllocatedSize() + OpenBuckets.GetAllocatedSize();
+	}
+};
+
+enum class ECityGen_SearchStatus : uint8
+{
+	InProgress, // Paused, can be resumed
+	Found,
+	Failed
+};
+
+// Progress of a search between two calls, the open set and the nodes stay in the workspace
+struct FCityGen_DenseSearchState
+{
+	// Above this many goals, the heuristic is the distance to GoalBounds instead of the closest goal
+	static constexpr int32 MaxExactHeuristicGoals = 16;
+
+	// Reaching any goal ends the search, the goal cells are flagged in the storage
+	// Goals is only filled when there are at most MaxExactHeuristicGoals of them, so a push never loops over a whole
+	// corridor network. The distance to the box containing the goals never overestimates either
+	TArray<FSG_GridCoordinate, TInlineAllocator<4>> Goals;
+	FCityGen_GridBounds GoalBounds;
+
+	// Goal reached by the search
+	int32 EndIndex = INDEX_NONE;
+
+	uint32 PushSequence = 0;
+
+	int32 NumIterations = 0;
+
+	// w in f = g + w * h, the path found costs at most w times the optimal one when h does not overestimate
+	float HeuristicWeight = 1.0f;
+
+	// The search fails once more cells are expanded
+	int32 MaxIterations = 800;
+
+	// Set when the path is found: cost of the path, and a cost that no path between the starts and goals can go below
+	float PathCost = 0.0f;
+	float CostLowerBound = 0.0f;
+
+	// Highest F cost popped from the open set, stale entries included
+	float MaxPoppedFCost = 0.0f;
+};
+
+// Result of the searches of one pair, summed over the restarts of an anytime search
+struct FCityGen_DenseSearchResult
+{
+	int32 NumExpansions = 0;
+
+	// Searches run after the first one, and how many of them found a cheaper path
+	int32 NumRestarts = 0;
+	int32 NumImprovements = 0;
+
+	float PathCost = 0.0f;
+
+	// Highest lower bound of the optimal cost given by the searches
+	float CostLowerBound = 0.0f;
+
+	// MaxPoppedFCost of the last search, a node whose F stays above it would not change the result
+	float MaxPoppedFCost = 0.0f;
+
+	// The path costs at most this factor times the optimal path, 1 if it is optimal
+	float GetSuboptimalityBound() const
+	{
+		return (CostLowerBound > UE_KINDA_SMALL_NUMBER) ? FMath::Max(PathCost / CostLowerBound, 1.0f) : 1.0f;
+	}
+};
+
+// Query of a cached path: the doors and rooms at both ends, and a hash of what the search reads around them
+struct FCityGen_PathCacheKey
+{
+	FSG_GridCoordinate StartDoor = {};
+	FSG_GridCoordinate StartRoom = {};
+	FSG_GridCoordinate EndDoor = {};
+	FSG_GridCoordinate EndRoom = {};
+
+	// Search settings, blocked cells and corridor cells of the region around the doors
+	uint32 RegionHash = 0;
+
+	bool operator==(const FCityGen_PathCacheKey& Other) const
+	{
+		return (RegionHash == Other.RegionHash) &&
+			(StartDoor == Other.StartDoor) && (StartRoom == Other.StartRoom) &&
+			(EndDoor == Other.EndDoor) && (EndRoom == Other.EndRoom);
+	}
+
+	friend uint32 GetTypeHash(const FCityGen_PathCacheKey& Key)
+	{
+		uint32 Hash = Key.RegionHash;
+		Hash = HashCombineFast(Hash, GetTypeHash(Key.StartDoor));
+		Hash = HashCombineFast(Hash, GetTypeHash(Key.StartRoom));
+		Hash = HashCombineFast(Hash, GetTypeHash(Key.EndDoor));
+		return HashCombineFast(Hash, GetTypeHash(Key.EndRoom));
+	}
+};
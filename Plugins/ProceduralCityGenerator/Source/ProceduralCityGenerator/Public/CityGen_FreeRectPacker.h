@@ -0,0 +1,45 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Free space of a rectangle of grid cells, kept as the list of maximal free rectangles (MaxRects)
+// A placed rectangle splits every free rectangle it overlaps in up to four ones around it, then the split rectangles
+// contained in another one are removed. Rectangles are in cells, Min inclusive and Max exclusive
+// The free rectangles are not indexed: with F free rectangles and S split ones, FindPosition is O(F) and Occupy is O(F * S)
+// F grows with the placed rectangles, so placing n rooms is O(n * F) for the searches alone
+struct PROCEDURALCITYGENERATOR_API FCityGen_FreeRectPacker
+{
+private:
+	FIntRect Area;
+	TArray<FIntRect> FreeRects;
+
+	// Rectangles made by the last Occupy, kept to reuse the memory
+	TArray<FIntRect> SplitRects;
+
+public:
+	// The whole area is free
+	void Init(const FIntRect& InArea);
+
+	// Best short side fit: the free rectangle leaving the smallest side free around the size, turned by 90 degrees if better
+	// @return: false if the size fits in no free rectangle, in both orientations
+	bool FindPosition(const FIntPoint& Size, FIntRect& OutRect, bool& bOutRotated) const;
+
+	// Remove the rectangle from the free space, it does not need to be inside of a single free rectangle
+	void Occupy(const FIntRect& Rect);
+
+	const FIntRect& GetArea() const
+	{
+		return Area;
+	}
+
+	const TArray<FIntRect>& GetFreeRects() const
+	{
+		return FreeRects;
+	}
+
+private:
+	// Remove the split rectangles contained in a free rectangle or in another split one
+	void PruneSplitRects();
+};
@@ -0,0 +1,113 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CityGen_CorridorCellStore.h"
+#include "CityGen_CorridorSearch.h"
+
+#include "SimpleGridRuntime/Public/SG_GridBitVolume.h"
+#include "SimpleGridRuntime/Public/SG_GridCoordinate.h"
+
+#include "CoreMinimal.h"
+
+// Abstract graph of the dungeon grid used for hierarchical (HPA*) corridor searches
+// The grid is split in chunks of ChunkSize cells. Each group of open cells on the face shared by two chunks is an entrance,
+// with one node on each side of the face. Nodes of the same chunk are linked with the cost of the shortest path inside the chunk
+// A query searches the abstract graph, then refines the path at full resolution inside the chunks crossed by the abstract path
+// Blocked cells must not change after Build. Corridor cells can be added, then OnCorridorCellsAdded update the affected chunks
+struct PROCEDURALCITYGENERATOR_API FCityGen_HierarchicalPlanner
+{
+public:
+	struct FEdge
+	{
+		int32 TargetNode = INDEX_NONE;
+		float Cost = 0.0f; // Not used for inter chunk edges, their cost depend on the corridors and is computed when used
+		bool bInterChunk = false;
+	};
+
+	struct FNode
+	{
+		FSG_GridCoordinate Coord = {};
+		int32 ChunkIndex = INDEX_NONE;
+		TArray<FEdge> Edges;
+	};
+
+	struct FChunk
+	{
+		FCityGen_GridBounds Bounds;
+		TArray<int32> NodeIndices;
+	};
+
+	// Number of chunks which had their intra chunk edges recomputed since Build
+	int32 NumChunkUpdates = 0;
+
+private:
+	FCityGen_GridBounds Bounds;
+	FIntVector ChunkSize = FIntVector(1, 1, 1);
+	FIntVector NumChunks = FIntVector(0, 0, 0);
+
+	const FSG_GridBitVolume* BlockedGridTiles = nullptr;
+	const FCityGen_CorridorCellStore* Corridors = nullptr;
+	float DistanceFactorForZ = 1.0f;
+
+	TArray<FChunk> Chunks;
+	TArray<FNode> Nodes;
+	TMap<FSG_GridCoordinate, int32> CoordToNode;
+
+	// Reused by every search inside a chunk
+	FCityGen_DenseSearchStorage Storage;
+	TArray<FCityGen_DenseOpenEntry> OpenHeap;
+
+public:
+	// The blocked tiles and corridors are referenced, not copied: they need to outlive the planner or the next Reset
+	void Build(const FCityGen_GridBounds& InBounds, const FIntVector& InChunkSize, const FSG_GridBitVolume& InBlockedGridTiles, const FCityGen_CorridorCellStore& InCorridors, float InDistanceFactorForZ);
+
+	void Reset();
+
+	bool IsBuilt() const
+	{
+		return BlockedGridTiles != nullptr;
+	}
+
+	int32 GetNumChunks() const
+	{
+		return Chunks.Num();
+	}
+
+	int32 GetNumNodes() const
+	{
+		return Nodes.Num();
+	}
+
+	// @param OutPath: every cell from Start to Goal, each cell adjacent to the previous one
+	// @param OutNumExpansions: abstract nodes plus cells expanded by the query
+	bool FindPath(const FSG_GridCoordinate& Start, const FSG_GridCoordinate& Goal, TArray<FSG_GridCoordinate>& OutPath, int32& OutNumExpansions);
+
+	// Call after adding cells to the corridors, the intra chunk edges of the chunks containing them are recomputed
+	void OnCorridorCellsAdded(const TArray<FSG_GridCoordinate>& Cells);
+
+private:
+	int32 GetChunkIndex(const FSG_GridCoordinate& Coord) const;
+
+	bool IsWalkable(const FSG_GridCoordinate& Coord) const
+	{
+		return Bounds.Contains(Coord) && !BlockedGridTiles->IsSet(Coord);
+	}
+
+	// Cost to move between two adjacent cells, lower if To is already a corridor
+	float GetStepCost(const FSG_GridCoordinate& From, const FSG_GridCoordinate& To) const;
+
+	float GetHeuristic(const FSG_GridCoordinate& From, const FSG_GridCoordinate& To) const;
+
+	void BuildEntrances();
+
+	int32 FindOrAddNode(const FSG_GridCoordinate& Coord);
+
+	void UpdateChunkEdges(int32 ChunkIndex);
+
+	// Dijkstra from Source over the walkable cells of SearchBounds, results are left in Storage
+	// @param bReverse: costs are the ones of the paths going to Source instead of leaving it
+	// @param Target: optional, stop as soon as it is reached
+	// @return: number of expanded cells
+	int32 SearchInBounds(const FSG_GridCoordinate& Source, const FCityGen_GridBounds& SearchBounds, bool bReverse, const FSG_GridCoordinate* Target);
+};
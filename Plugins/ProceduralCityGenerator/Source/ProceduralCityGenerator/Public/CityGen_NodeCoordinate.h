@@ -12,7 +12,7 @@ struct FCityGen_NodeCoord
 	GENERATED_BODY()
 
 public:
-	// A* algorithm variables
+	// A* algorithm variables, in FCityGen_IntegerCostModel units
 	int32 GCost = TNumericLimits< int32 >::Max(); // Cost so far, set as highest for the first round of pathfinding
 	int32 HCost = TNumericLimits< int32 >::Max(); // Heuristic
 
@@ -24,7 +24,7 @@ public:
 	FCityGen_NodeCoord() = default;
 
 	// Total cost
-	FORCEINLINE float ComputeFCost() const
+	FORCEINLINE int32 ComputeFCost() const
 	{
 		return HCost + GCost;
 	}
@@ -42,6 +42,6 @@ public:
 
 	FORCEINLINE FString ToString()
 	{
-		return FString::Printf(TEXT("GCost:%d HCost:%d FCost:%f"), GCost, HCost, ComputeFCost());
+		return FString::Printf(TEXT("GCost:%d HCost:%d FCost:%d"), GCost, HCost, ComputeFCost());
 	}
 };
@@ -149,8 +149,21 @@ public:
 	// Should be called after UpdateGridCoordCaches
 	TArray<FSG_GridCoordinate> BuildListOfOverlappingCoordsFromBounds() const;
 
+	// Should be called after UpdateGridCoordCaches
+	// Inclusive boxes, coordinates are already snapped to the grid
+	const TArray<FBoundCoords>& GetCachedBoundsDungeonGridCoord() const
+	{
+		return CachedBoundsDungeonGridCoord;
+	}
+
+	// Cells covered along local X and Y by the box around the bounds boxes, at least one
+	FIntPoint GetRoomTileFootprint() const;
+
 	void CloseAllDoors();
 
+	// Back to the state of a newly spawned room, for a room taken back from an actor pool
+	void ResetForReuse();
+
 	void OpenUsedExits();
 
 	void SetExitsUsed(const FCellConnectionState& state);
@@ -2,17 +2,191 @@
 
 #pragma once
 
+#include "CityGen_CorridorCellStore.h"
+#include "CityGen_CorridorSearch.h"
+#include "CityGen_HierarchicalPlanner.h"
 #include "CityGen_NodeCoordinate.h"
 #include "CityGen_ObstacleBase.h"
 #include "GridBasedGeneratorBase.h"
 
+#include "SimpleGridRuntime/Public/SG_GridBitVolume.h"
+
+#include "Containers/LruCache.h"
+
 #include "DungeonGenerator_GridBased.generated.h"
 
 #define WITH_SORTED_EXIT_ARROW 0 // TODO : remove dead code
 
 class UArrowComponent;
+class UCityGen_ActorPoolComponent;
+class UHierarchicalInstancedStaticMeshComponent;
 struct FExitArrowData;
 
+UENUM(BlueprintType)
+enum class ECorridorSearchAlgorithm : uint8
+{
+	LinearScan UMETA(DisplayName = "Linear Scan (reference)"), // Original open set, scanned linearly for the lowest F cost at each iteration
+	BinaryHeap UMETA(DisplayName = "Binary Heap"),
+	JumpPointSearch UMETA(DisplayName = "Jump Point Search"), // Always use the dense storage
+	Bidirectional UMETA(DisplayName = "Bidirectional A*"), // Always use the dense storage
+	Hierarchical UMETA(DisplayName = "Hierarchical (HPA*)"), // Search an abstract graph of chunks, built once per PlanCorridors
+	BucketQueue UMETA(DisplayName = "Bucket Queue (Dial)") // Integer costs, always use the dense storage
+};
+
+UENUM(BlueprintType)
+enum class ECorridorConnectionMode : uint8
+{
+	RoomPairs UMETA(DisplayName = "Room Pairs"), // One corridor per pair returned by GetRoomsToConnectArray
+	SharedNetwork UMETA(DisplayName = "Shared Network") // Rooms of the pairs joined by a single network, see GetNetworkRoomsToConnectArray
+};
+
+UENUM(BlueprintType)
+enum class ECorridorOutputMode : uint8
+{
+	Actors UMETA(DisplayName = "Actors"), // One actor per corridor cell, spawned from the corridor types
+	InstancedMeshes UMETA(DisplayName = "Instanced Meshes") // One instance per corridor cell in a HISM component per corridor mesh, no actor is spawned
+};
+
+// Corridor piece of a cell, picked from its connections
+UENUM()
+enum class ECorridorPieceType : uint8
+{
+	Straight,
+	Corner,
+	TJunction,
+	CrossJunction,
+	ElevatorUp,
+	ElevatorDown,
+	ElevatorUpAndDown,
+	Num UMETA(Hidden)
+};
+
+struct FCorridorPiece
+{
+	ECorridorPieceType Type = ECorridorPieceType::Straight;
+	FRotator Rotation = FRotator::ZeroRotator;
+};
+
+// Corridor piece of every connection mask (see FCellConnectionState::GetConnectionMask), built once
+// from the openings of each piece type at yaw 0 turned by steps of 90 degrees
+struct FCorridorPieceTable
+{
+	struct FEntry
+	{
+		bool bValid = false;
+		ECorridorPieceType Type = ECorridorPieceType::Straight;
+		// The piece is spawned with a yaw of BaseYaw + k * 360 / NumYawVariants, k picked at random
+		// Above 1 for the pieces looking the same once turned
+		uint8 NumYawVariants = 1;
+		float BaseYaw = 0.0f;
+	};
+
+	FEntry Entries[CellConnectionMask::NumMasks];
+
+public:
+	static const FCorridorPieceTable& Get();
+
+	// Horizontal openings of the piece type at yaw 0, 0 for the elevators
+	static uint8 GetOpeningsMask(ECorridorPieceType Type);
+
+	// A yaw of 90 degrees moves the opening of a direction to the next one, North to East
+	static uint8 RotateHorizontalMask(uint8 Mask, int32 NumQuarterTurns);
+
+private:
+	FCorridorPieceTable();
+};
+
+// Accumulated over all the FindPath calls of the last ConnectRoomsInOrder
+USTRUCT(BlueprintType)
+struct FCorridorSearchStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumSearches = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumFailedSearches = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumExpansions = 0; // Number of nodes moved to the closed set
+
+	// Growths of the search workspaces, stays at 0 once they fit the search bounds
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumAllocations = 0;
+
+	// Parallel searches run again because a corridor committed earlier in their batch could change their result
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumSpeculativeReruns = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	double SearchTimeMs = 0.0;
+
+	// Cells used by the corridors once every pair is processed
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumCorridorCells = 0;
+
+	// FindPath calls replayed from the path cache, they are not counted in NumSearches
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumPathCacheHits = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumPathCacheMisses = 0;
+
+	// Anytime searches run again with a lower heuristic weight, and how many of them found a cheaper path
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumAnytimeRestarts = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumAnytimeImprovements = 0;
+
+	// Cost of the paths found by the dense pair searches over a lower bound of their optimal cost, 1 means optimal
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float MaxSuboptimalityBound = 1.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float AverageSuboptimalityBound = 1.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumBoundedPaths = 0;
+
+	void AddDenseSearchResult(const FCityGen_DenseSearchResult& Result, bool bFoundPath)
+	{
+		NumExpansions += Result.NumExpansions;
+		NumAnytimeRestarts += Result.NumRestarts;
+		NumAnytimeImprovements += Result.NumImprovements;
+		if (bFoundPath)
+		{
+			const float Bound = Result.GetSuboptimalityBound();
+			NumBoundedPaths++;
+			MaxSuboptimalityBound = FMath::Max(MaxSuboptimalityBound, Bound);
+			AverageSuboptimalityBound += (Bound - AverageSuboptimalityBound) / NumBoundedPaths;
+		}
+	}
+};
+
+// Corridor connections and used exits of one connected pair, kept to re-plan only the pairs affected by a room edit
+struct FCorridorPairRecord
+{
+	struct FLink
+	{
+		FSG_GridCoordinate Coord = {};
+		FSG_GridCoordinate OtherCoord = {};
+		bool bIsARoom = false;
+	};
+
+	ACityGen_RoomBase* FromRoom = nullptr;
+	ACityGen_RoomBase* ToRoom = nullptr;
+
+	// Connections added to RequestedCorridors for this pair, a cell can be shared with other pairs
+	TArray<FLink> Links;
+
+	// Exit cells of the used exits, the exits are looked up again as the rooms may rebuild them
+	TArray<FSG_GridCoordinate> UsedExitCoords;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCorridorsMaterialized, int32, NumCorridorCells);
+
 // Do not use this class directly, use one of the sub classes
 UCLASS()
 class PROCEDURALCITYGENERATOR_API ADungeonGenerator_GridBased : public AGridBasedGeneratorBase
@@ -31,30 +205,196 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Generation")
 	bool bUseBlockedExit = true;
 
+	// InstancedMeshes uses the corridor meshes instead of the corridor types: no actor, one draw call per mesh
+	// and the collision comes from the instance bodies. The corridors have no exit and door to update
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Generation")
+	ECorridorOutputMode CorridorOutputMode = ECorridorOutputMode::Actors;
+
+	// ConnectRoomsInOrder commits the paths and returns, the corridors are then spawned by Tick within CorridorSpawnBudgetMs
+	// per frame, the cells closest to the player first. Only in game worlds, the editor always spawns them at once
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Generation")
+	bool bDeferCorridorSpawning = false;
+
+	// Time given to the corridor spawning each frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generation", meta = (ClampMin = "0.1", Units = "ms", EditCondition = "bDeferCorridorSpawning"))
+	float CorridorSpawnBudgetMs = 2.0f;
+
+	// Broadcast once every corridor of the last plan is spawned and the doors are updated
+	UPROPERTY(BlueprintAssignable, Category = "Generation")
+	FOnCorridorsMaterialized OnCorridorsMaterialized;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	ECorridorSearchAlgorithm CorridorSearchAlgorithm = ECorridorSearchAlgorithm::BinaryHeap;
+
+	// Store the search nodes in flat arrays covering the rooms bounds (plus margin) instead of hash maps
+	// Only used by the BinaryHeap algorithm. Unlike the hash map search, corridors can not go outside of these bounds
+	// Needed by the parallel search, and to pause a time sliced search in the middle of a pair
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	bool bUseDenseSearchStorage = false;
+
+	// Number of cells added around the rooms bounds to build the search bounds
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	FIntVector SearchBoundsMargin = FIntVector(8, 8, 1);
+
+	// Search the pairs by batches on worker threads, the corridors are the same as with the sequential search
+	// Only used by the BinaryHeap algorithm with the dense storage. A search is run again when a corridor committed
+	// earlier in its batch could have changed its result, see IsSpeculativeSearchInvalidated
+	// A time sliced generation checks its deadline between batches, a batch is never paused in the middle
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	bool bUseParallelCorridorSearch = false;
+
+	// Number of pairs searched at the same time, 0 to use one per worker thread
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (ClampMin = "0", EditCondition = "bUseParallelCorridorSearch"))
+	int32 ParallelSearchBatchSize = 0;
+
+	// Run one dense search from every unblocked exit of the first room to any unblocked exit of the second room,
+	// instead of a search between the closest pair of exits. Not used by the parallel search
+	// Always the dense binary heap search, whatever CorridorSearchAlgorithm and bUseDenseSearchStorage are
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	bool bUseMultiExitSearch = false;
+
+	// SharedNetwork ignores how the pairs are made by the generator and only connects their rooms, with less corridor cells
+	// It always uses the dense search, and does not use the parallel or time sliced search
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	ECorridorConnectionMode ConnectionMode = ECorridorConnectionMode::RoomPairs;
+
+	// Keep the paths found by FindPath between generations, a query with the same doors and the same cells around them
+	// is replayed in RequestedCorridors without searching. Not used by the multi exit, parallel, time sliced and network searches
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	bool bUsePathCache = false;
+
+	// Maximum number of paths kept, the least recently used one is dropped first
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (ClampMin = "1", EditCondition = "bUsePathCache"))
+	int32 PathCacheSize = 256;
+
+	// Cells added around the box of the doors to build the region hashed in the cache key
+	// A path going out of the region is checked again before being replayed, it may differ from a new search but is always valid
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (EditCondition = "bUsePathCache"))
+	FIntVector PathCacheRegionMargin = FIntVector(4, 4, 1);
+
+	// Weight w of the dense search heuristic, f = g + w * h. Above 1 less cells are expanded for longer corridors,
+	// see LastSearchStats for how far the paths found can be from the cheapest ones
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (ClampMin = "1.0"))
+	float HeuristicWeight = 1.0f;
+
+	// Start with HeuristicWeight, then search again with a weight lowered by AnytimeWeightStep while the pair budget remains,
+	// keeping the cheapest path found. Only used by FindPath with the dense BinaryHeap search
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	bool bUseAnytimeSearch = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (ClampMin = "0.01", EditCondition = "bUseAnytimeSearch"))
+	float AnytimeWeightStep = 0.5f;
+
+	// Cells expanded by the search of one pair before giving up, shared by the restarts of an anytime search
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (ClampMin = "1"))
+	int32 MaxExpansionsPerPair = 800;
+
+	// Time given to the dense search of one pair, 0 for no limit. An anytime search which runs out keeps its cheapest path
+	// Not used by the parallel, time sliced, multi exit and network searches. Paths found with a limit are not cached
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding", meta = (ClampMin = "0.0"))
+	float MaxSearchTimeMsPerPair = 0.0f;
+
+	// Size in cells of the chunks of the abstract graph, only used by the Hierarchical algorithm
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	FIntVector HierarchicalChunkSize = FIntVector(8, 8, 2);
+
+	UPROPERTY(VisibleAnywhere, Transient, BlueprintReadOnly, Category = "Pathfinding")
+	FCorridorSearchStats LastSearchStats;
+
 protected:
 	UPROPERTY(VisibleAnywhere)
 	TMap<FSG_GridCoordinate, ACityGen_RoomBase*> AllSpawnedCorridors;
 
+	// One per corridor piece type, created when the first instance of the type is added
+	// Saved with the instance components, like AllSpawnedCorridors, so a later generation clears the saved instances
+	UPROPERTY(VisibleAnywhere)
+	TArray<TObjectPtr<UHierarchicalInstancedStaticMeshComponent>> CorridorInstanceComponents;
+
+	// Instances gathered by StepSpawnCorridors, added to the components once every cell is processed
+	TArray<FTransform> PendingCorridorInstances[(int32)ECorridorPieceType::Num];
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Grid");
 	TObjectPtr<USG_GridComponent> DungeonGridCmpt;
 
+	// Corridor actors are released here by ClearCorridorMeshes and taken back by the next generation
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Generation")
+	TObjectPtr<UCityGen_ActorPoolComponent> CorridorActorPool;
+
 	TArray<ACityGen_RoomBase*> AllRooms;
 
-	TMap<FSG_GridCoordinate, FCellConnectionState> RequestedCorridors;
+	// Bit volume over DungeonGridBounds, set by PlanCorridors_BlockTiles
+	FCityGen_CorridorCellStore RequestedCorridors;
 
-	TSet<FSG_GridCoordinate> BlockedGridTiles;
+	// Covers DungeonGridBounds, nothing is blocked outside of it
+	FSG_GridBitVolume BlockedGridTiles;
 
 	TArray<FSG_GridCoordinate> TilesToIgnore;
 
 	FRandomStream DungeonGenRandomStream;
 
+	// Box containing all rooms and their exits, plus SearchBoundsMargin. Updated by PlanCorridors
+	FCityGen_GridBounds DungeonGridBounds;
+
+	// Kept between searches and generations, the second one is only used by the backward side of the bidirectional search
+	FCityGen_SearchWorkspace SearchWorkspaces[2];
+
+	// One per pair of a parallel batch
+	TArray<FCityGen_SearchWorkspace> ParallelSearchWorkspaces;
+
+	// Only built when using the Hierarchical algorithm, references BlockedGridTiles and RequestedCorridors
+	FCityGen_HierarchicalPlanner HierarchicalPlanner;
+
+	// Progress of the stage functions between two calls
+	TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>> PendingRoomsToConnect;
+	int32 NextPairIndex = 0;
+	bool bAllPendingPairsConnected = true;
+
+	// Dense search of the pair at NextPairIndex paused by a deadline, it uses SearchWorkspaces[0]
+	bool bHasPausedSearch = false;
+	FCityGen_DenseSearchState PausedSearchState;
+	FExitArrowData* PausedSearchFromExit = nullptr;
+	FExitArrowData* PausedSearchToExit = nullptr;
+
+	// Sorted by BeginSpawnCorridors, the closest to the player first
+	TArray<FSG_GridCoordinate> PendingCorridorCoords;
+	int32 NextCorridorIndex = 0;
+
+	// The corridors of PendingCorridorCoords are spawned by Tick
+	bool bSpawningCorridorsFromTick = false;
+
+	// Rooms already joined to the network, only used by the SharedNetwork connection mode
+	TArray<ACityGen_RoomBase*> NetworkRooms;
+
+	// One per pair connected by the last plan, used by the incremental edits
+	TArray<FCorridorPairRecord> PairRecords;
+
+	// Record of the pair being connected, INDEX_NONE between pairs
+	int32 ActivePairRecordIndex = INDEX_NONE;
+
+	// Room transforms once snapped by the last plan, to find the rooms moved in editor since then
+	TMap<ACityGen_RoomBase*, FTransform> PlannedRoomTransforms;
+
+	// Connections added by FindPath for a query, kept between generations
+	TLruCache<FCityGen_PathCacheKey, TArray<FCorridorPairRecord::FLink>> PathCache;
+
+	// Receives the connections added by the FindPath call being cached, nullptr otherwise
+	TArray<FCorridorPairRecord::FLink>* PathCacheCapture = nullptr;
+
 public:
 	// Sets default values for this actor's properties
 	ADungeonGenerator_GridBased();
 
+	virtual void Tick(float DeltaTime) override;
+
 	UFUNCTION(CallInEditor)
 	void ClearCorridorMeshes();
 
+	// Spawn parked actors of every corridor type in the corridor pool, for a loading screen
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	void WarmUpCorridorPool(int32 NumActorsPerCorridorType);
+
+	UCityGen_ActorPoolComponent* GetCorridorActorPool() const;
+
 #if WITH_EDITOR
 	// Function only here to be able to use in editor, in code directly use ConnectRoomsInOrder
 	UFUNCTION(CallInEditor)
@@ -71,31 +411,190 @@ public:
 	// This return an array without nullptr actors
 	virtual TArray<ACityGen_RoomBase*> GetAllRoomsArray() const;
 
+	// Minimum spanning tree (Prim) over the rooms of GetRoomsToConnectArray, weighted by the distance between their closest unblocked exits
+	// Pairs are (new room, room of the tree), in the order the rooms join the tree
+	TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase* >> GetNetworkRoomsToConnectArray() const;
+
 	virtual void InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms);
 
+	// Add or remove the room from the rooms of the sub class, used by AddRoom and RemoveRoom
+	// @return: false if nothing changed
+	virtual bool AddRoomToConnect(ACityGen_RoomBase* Room);
+	virtual bool RemoveRoomToConnect(ACityGen_RoomBase* Room);
+
+	// When not nullptr and every pair starts from this room, the pairs are connected with a single flow field from its exits
+	// Only used by the RoomPairs connection mode
+	virtual ACityGen_RoomBase* GetFlowFieldHub() const;
+
 	UFUNCTION(CallInEditor)
 	bool ConnectRoomsInOrder();
 
+	// Forget the paths kept by bUsePathCache
+	UFUNCTION(CallInEditor)
+	void ClearPathCache();
+
+	// Incremental edits of a dungeon connected by ConnectRoomsInOrder. Only the pairs using the edited room, or with a corridor cell
+	// now blocked, are searched again, and only the corridor actors whose connections changed are respawned
+	// The kept corridors were found in a different order, so the result can differ a bit from a full ConnectRoomsInOrder
+	// Run a full ConnectRoomsInOrder when nothing was connected yet or in SharedNetwork mode
+	// @return: true if a path was found between all the rooms
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	bool AddRoom(ACityGen_RoomBase* Room);
+
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	bool RemoveRoom(ACityGen_RoomBase* Room);
+
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	bool MoveRoom(ACityGen_RoomBase* Room, const FTransform& NewTransform);
+
 #if WITH_EDITOR
 	UFUNCTION(CallInEditor)
 	void SnapRoomsToGridEd();
 
 	UFUNCTION(CallInEditor)
 	void DebugDrawRoomsCachedData();
+
+	// MoveRoom for every room moved in the level since the last plan
+	UFUNCTION(CallInEditor)
+	void ReplanMovedRooms();
+
+	// Run the corridor pathfinding on the current rooms with each search algorithm and log the stats,
+	// then BenchmarkStarSpokes and BenchmarkLongStraights
+	// Only runs when no corridor is planned or spawned, as every run clears the corridors. Nothing is spawned by the benchmark
+	UFUNCTION(CallInEditor)
+	void BenchmarkCorridorSearch();
+
+	// Compare the lookups and memory of the planned corridor cells keyed by coordinates and by Morton codes, and log them
+	// Use a random set of cells when nothing is planned
+	UFUNCTION(CallInEditor)
+	void BenchmarkGridKeys();
+
+	// Check every entry of the corridor piece table against the connections it is used for, and log the result
+	UFUNCTION(CallInEditor)
+	void ValidateCorridorPieceTable();
 #endif // WITH_EDITOR
 
+	// Stages of ConnectRoomsInOrder, to spread the generation over several frames
+	// Call order: PlanCorridors_SnapRooms, PlanCorridors_BlockTiles, PlanCorridors_StepPairs until it returns true, PlanCorridors_Finish,
+	// BeginSpawnCorridors, StepSpawnCorridors until it returns true, FinishSpawnCorridors
+
+	// @return: false if there is not enough rooms to connect
+	bool PlanCorridors_SnapRooms();
+	void PlanCorridors_BlockTiles();
+
+	// Connect the pairs of rooms until the deadline (FPlatformTime::Seconds) is reached
+	// The dense BinaryHeap search is paused in the middle of a pair, the other algorithms finish the current pair
+	// @return: true when every pair has been processed
+	bool PlanCorridors_StepPairs(double DeadlineSeconds);
+
+	// @return: true if a path was found between all the rooms
+	bool PlanCorridors_Finish();
+	float GetPlanCorridorsProgress() const;
+
+	// Queue the cells of RequestedCorridors, sorted by distance to GetCorridorSpawnFocus
+	void BeginSpawnCorridors();
+
+	// @return: true when every corridor has been spawned
+	bool StepSpawnCorridors(double DeadlineSeconds);
+	float GetSpawnCorridorsProgress() const;
+
+	// Update the doors and broadcast OnCorridorsMaterialized, does nothing while cells are still queued
+	void FinishSpawnCorridors();
+
+	// @return: false while corridors are still queued
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	bool AreCorridorsMaterialized() const;
+
+	void UpdateDoorStatus();
+
 protected:
+	// Snap the rooms, build the blocked tiles and find the path of every pair to connect into RequestedCorridors
+	// Does not spawn anything
+	bool PlanCorridors();
+
+	// Snap EditedRooms again, then keep the pair records still valid and connect the other pairs
+	// Corridor actors are only spawned or destroyed on the cells whose connections changed
+	// A deferred spawn still running is cancelled, and the re-plan spawns synchronously
+	bool ReplanCorridors(const TArray<ACityGen_RoomBase*>& EditedRooms);
+
+	// Start recording the connections and used exits of a pair in PairRecords
+	void BeginPairRecord(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom);
+
+	// The record is dropped if the pair was not connected
+	void EndPairRecord(bool bConnected);
+
+	// Add the connection to RequestedCorridors and to the record of the pair being connected
+	void AddCorridorConnection(const FSG_GridCoordinate& Coord, const FSG_GridCoordinate& OtherCoord, bool bIsARoom);
+
+	// Marks the exits as used (useful to open doors) and adds them to the record of the pair being connected
+	// @param ToExit: can be nullptr
+	void MarkExitsUsed(FExitArrowData* FromExit, FExitArrowData* ToExit);
+
 	//void UpdateBlockedTiles_Obstacles();
 	void UpdateBlockedTiles_ClosedExits();
 	void UpdateBlockedTiles_RoomBounds();
 	void UpdateBlockedTiles_TilesToIgnore();
 
+	void UpdateDungeonGridBounds();
+
 	bool AddCorridorConnectingRooms(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom);
-#if WITH_SORTED_EXIT_ARROW
+#if !WITH_SORTED_EXIT_ARROW
+	// Pick the touching doors if any, otherwise the closest pair of exits not blocked
+	// @param bOutNeedPath: false when the doors are touching, no corridor is needed
+	bool SelectExitsToConnect(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit, bool& bOutNeedPath) const;
+
+	// AddCorridorConnectingRooms with the dense search, paused when the deadline is reached and resumed by the next call
+	// @param bOutConnected: set when the pair is done
+	// @return: false if the search is paused
+	bool AddCorridorConnectingRooms_Resumable(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, double DeadlineSeconds, bool& bOutConnected);
+
+	// Dense search seeded with every unblocked exit of FromRoom, reaching any unblocked exit of ToRoom ends it
+	// @return: false if a room has no unblocked exit
+	bool BeginSearch_MultiExit(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom) const;
+
+	// Find a path with the multi exit search and commit it
+	// @param OutFromExit, OutToExit: exits at both ends of the path
+	bool FindPath_MultiExit(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit);
+
+	// Join FromRoom to the network with the shortest path from one of its exits to a corridor cell or an exit of a room of the network
+	// Joining existing corridors instead of going to ParentRoom grows an approximation of the Steiner tree of the rooms
+	bool AddCorridorConnectingRoomToNetwork(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ParentRoom);
+
+	// @param OutToExit: nullptr if the path ends on a corridor cell
+	bool FindPath_ToNetwork(ACityGen_RoomBase* FromRoom, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit);
+
+	// Exits at both ends of a path found by the multi exit search
+	void GetPathEndExits(ACityGen_RoomBase* FromRoom, ACityGen_RoomBase* ToRoom, const TArray<FSG_GridCoordinate>& Path, FExitArrowData*& OutFromExit, FExitArrowData*& OutToExit) const;
+
+	// Same result as calling AddCorridorConnectingRooms for each pair, with the searches run on worker threads
+	// PlanCorridors_StepPairs gives it GetParallelSearchBatchSize pairs per call, so the deadline is checked between batches
+	bool ConnectRoomPairsInParallel(TArrayView<const TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>> RoomsToConnect);
+
+	// Dijkstra from every unblocked exit of Hub over the whole search bounds, run once for all the pairs (Hub, Room)
+	// Each path walks the parents back from the reached exit of the room with the lowest cost
+	// A committed path lowers the cost of its cells, only the cells it improves are relaxed again before the next pair
+	bool ConnectHubPairsWithFlowField(ACityGen_RoomBase* Hub, const TArray<TPair<ACityGen_RoomBase*, ACityGen_RoomBase*>>& RoomsToConnect);
+
+	// Expand the open set of the flow field until it is empty, without goal or iteration limit
+	// @return: number of expanded cells
+	int32 ExpandFlowField(FCityGen_SearchWorkspace& Workspace, uint32& PushSequence) const;
+#else
 	// SORTING EXITS BASED ON CLOSEST TO FURTHEST from given location
 	bool GetSortedExitArrows(ACityGen_RoomBase* FromRoom, const FSG_GridCoordinate& ToLocationGS, TArray<FExitArrowData*>& OutSortedExitData) const;
 #endif // WITH_SORTED_EXIT_ARROW
 
+	// Number of pairs searched at the same time by SearchPathsInParallel
+	int32 GetParallelSearchBatchSize() const;
+
+	// Dense search of each pair (start cell, end cell) on worker threads, CommitPair is called in pair order for each path found
+	// CommitPair has to add the path to RequestedCorridors, the next searches read it
+	// @return: false if a search failed
+	bool SearchPathsInParallel(TArrayView<const TPair<FSG_GridCoordinate, FSG_GridCoordinate>> PairEndpoints, TFunctionRef<void(int32 PairIndex, const TArray<FSG_GridCoordinate>& Path)> CommitPair);
+
+	// True if a search run before CellsAddedInBatch became corridors may not give the same result now
+	// @param Storage: storage of the search, not used by another search since
+	bool IsSpeculativeSearchInvalidated(const FCityGen_DenseSearchStorage& Storage, const FCityGen_DenseSearchResult& Result, const FSG_GridCoordinate& Goal, TArrayView<const FSG_GridCoordinate> CellsAddedInBatch) const;
+
 	void SnapRoomsToGrid();
 
 	// PATHFINDING
@@ -104,30 +603,111 @@ protected:
 	// @return: false if failed to find a path within the recursive loop hard coded limit
 	bool FindPath(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords);
 
+	FCityGen_PathCacheKey MakePathCacheKey(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords) const;
+
+	// Add the cached connections to RequestedCorridors if all their cells are still free
+	// @return: false if there is no cached path for the key, or it is not valid anymore
+	bool ReplayCachedPath(const FCityGen_PathCacheKey& Key);
+
+	bool FindPath_LinearScan(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
+	bool FindPath_BinaryHeap(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
+	bool FindPath_Dense(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
+	// Search of FindPath_Dense without committing the path. Only the workspace is written,
+	// so it can run on several threads at the same time with different workspaces
+	// @param bAnytime: restart with lower heuristic weights while the pair budget remains
+	// @param bUseTimeLimit: also stop after MaxSearchTimeMsPerPair. The parallel search only uses the expansion budget,
+	// so its result does not depend on the thread scheduling
+	// @param OutPath: cells from the end door to the start door
+	bool SearchPath_Dense(FCityGen_SearchWorkspace& Workspace, const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, bool bAnytime, bool bUseTimeLimit, TArray<FSG_GridCoordinate>& OutPath, FCityGen_DenseSearchResult& OutResult) const;
+
+	// SearchPath_Dense split in two, to be able to pause the search
+	// @return: false if a door is outside of the grid bounds
+	bool BeginSearch_Dense(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& EndDoorGridCoords) const;
+
+	// Every start is seeded in the open set, reaching any goal ends the search
+	bool BeginSearch_Dense(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, TArrayView<const FSG_GridCoordinate> StartCoords, TArrayView<const FSG_GridCoordinate> GoalCoords, float InHeuristicWeight) const;
+
+	// Expand nodes until the path is found, the search fails or the deadline (FPlatformTime::Seconds) is reached
+	ECityGen_SearchStatus ContinueSearch_Dense(FCityGen_SearchWorkspace& Workspace, FCityGen_DenseSearchState& State, double DeadlineSeconds, TArray<FSG_GridCoordinate>& OutPath) const;
+
+	// Add the room connections at both ends and the connections between consecutive cells of the path to RequestedCorridors
+	void CommitPath(const TArray<FSG_GridCoordinate>& Path, const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords);
+
+	// Only the connections between consecutive cells of the path
+	void CommitPathCells(const TArray<FSG_GridCoordinate>& Path);
+
+	// Jump Point Search on the dense storage, only nodes where the path may turn are expanded
+	// Around cells already used by a corridor (lower cost) it behaves like FindPath_Dense
+	bool FindPath_JumpPoint(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
+	// Query the abstract graph built by PlanCorridors, then update the chunks crossed by the new corridor
+	bool FindPath_Hierarchical(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
+	// Same search as FindPath_Dense with FCityGen_IntegerCostModel costs, the open set is a bucket queue
+	bool FindPath_BucketQueue(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
+	// A* from both doors at the same time on the dense storage, the two searches meet in the middle
+	// Helps when the end room is boxed in by other rooms: the forward search alone floods the grid before reaching it
+	bool FindPath_Bidirectional(const FSG_GridCoordinate& StartDoorGridCoords, const FSG_GridCoordinate& StartRoomGridCoords, const FSG_GridCoordinate& EndDoorGridCoords, const FSG_GridCoordinate& EndRoomGridCoords, int32& OutNumExpansions);
+
 	// @return: location in world space of the first gridCoord of the path
 	void RetracePath(
 		const FSG_GridCoordinate& StartGridCoord,
 		const FSG_GridCoordinate& EndGridCoord,
 		const TMap<FSG_GridCoordinate, FCityGen_NodeCoord>& NodesMap);
 
+	// Walk the parent directions from EndIndex until the start node
+	// Connections are made both ways, so it also works on the storage of a backward search
+	void RetracePath(const FCityGen_DenseSearchStorage& Storage, int32 EndIndex);
+
 	// CORRIDOR SPAWNING
 
 	void SpawnCorridors();
 
-	ACityGen_RoomBase* SpawnDownLvlCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const;
-	ACityGen_RoomBase* SpawnUpLvlCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const;
-	ACityGen_RoomBase* SpawnUpAndDownLvlCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const;
-	ACityGen_RoomBase* SpawnTCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location, const TArray<bool>& bDirections) const;
-	ACityGen_RoomBase* SpawnCrossCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location) const;
-	ACityGen_RoomBase* SpawnStraightCorridor(const FSG_GridCoordinate& CurrentCoord, const FVector& Location, const TArray<bool>& bDirections) const;
+	// View location of the first local player, the generator location without one
+	FVector GetCorridorSpawnFocus() const;
 
-	void UpdateDoorStatus();
+	void CancelSpawnCorridors();
+
+	// Spawn the corridor actor matching the connections of the cell, or queue its instance
+	void SpawnCorridorAt(const FSG_GridCoordinate& CurrentCoord);
+
+	// Single lookup in FCorridorPieceTable, the random yaw comes from DungeonGenRandomStream
+	// @return: false if the connections of the cell do not match any corridor piece
+	bool GetCorridorPiece(const FSG_GridCoordinate& CurrentCoord, FCorridorPiece& OutPiece) const;
+
+	TSubclassOf<ACityGen_RoomBase> GetCorridorPieceClass(ECorridorPieceType Type) const;
+	UStaticMesh* GetCorridorPieceMesh(ECorridorPieceType Type) const;
+
+	ACityGen_RoomBase* SpawnCorridorPiece(const FCorridorPiece& Piece, const FVector& Location) const;
+
+	// Add the pending instances to the component of their piece type, created if needed
+	void FlushCorridorInstances();
+
+	// Remove the instances of every corridor component, the components are kept
+	void ClearCorridorInstances();
+
+	int32 GetNumCorridorInstances() const;
 
 #if WITH_EDITOR
 	// Check that there is no corridors overlapping rooms with an offset of half a cell
 	// This is an old function that probably need to be re work in order to be relevant
 	// We will not cleanup that function now as we run out of time
 	void CheckNoOverlappingRooms(const TMap<FSG_GridCoordinate, ACityGen_RoomBase*>& AllCorridorActors);
+
+	// Empty generated grid for the benchmarks, it replaces the dungeon one until the corridors are cleared
+	void InitBenchmarkGrid(const FSG_GridCoordinate& Min, const FSG_GridCoordinate& Max);
+
+	// Sequential and parallel dense searches from a hub to NumSpokes cells around it on a generated grid, compared in the log
+	// The grid replaces the dungeon one while it runs, everything is cleared after
+	void BenchmarkStarSpokes(int32 NumSpokes);
+
+	// Expansions of the BinaryHeap and JumpPointSearch algorithms along long open lanes of a generated grid, logged
+	// The grid replaces the dungeon one while it runs, everything is cleared after
+	void BenchmarkLongStraights();
 #endif // WITH_EDITOR
 
 	void OpenUsedExits();
@@ -136,6 +716,23 @@ protected:
 
 	bool IsGridTileBlocked(const FSG_GridCoordinate& GridCoord) const;
 
+	// False for the hash map searches (LinearScan, and BinaryHeap without the dense storage), their corridors can leave the bounds
+	bool IsCorridorSearchLimitedToBounds() const;
+
+	// Blocked, or outside of the bounds when the search can not leave them: a corridor found before can not use the cell anymore
+	bool IsCellClosedToCorridors(const FSG_GridCoordinate& GridCoord) const;
+
+	// Bit d set if the neighbour in direction d is inside the search bounds and not blocked, the six neighbours are tested at once
+	uint8 GetWalkableNeighbourMask(const FSG_GridCoordinate& GridCoord) const;
+
 	float GetDistance(const FSG_GridCoordinate& A, const FSG_GridCoordinate& B) const;
+
+	// Heuristic of the dense search, admissible with several goals
+	// Exact for a few goals, distance to the goal box for a network (see FCityGen_DenseSearchState::Goals)
+	float GetDistanceToClosestGoal(const FSG_GridCoordinate& Coord, const FCityGen_DenseSearchState& State) const;
+
+	// Lowest g + h of the cells left in the open set, with h scaled down so it never overestimates
+	// A path cheaper than State.PathCost always goes through one of them with its optimal g, so no path costs less
+	float GetOpenCostLowerBound(const FCityGen_SearchWorkspace& Workspace, const FCityGen_DenseSearchState& State) const;
 };
 
@@ -31,4 +31,7 @@ public:
 	virtual TArray<ACityGen_RoomBase*> GetAllRoomsArray() const override;
 
 	virtual void InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms) override;
+
+	virtual bool AddRoomToConnect(ACityGen_RoomBase* Room) override;
+	virtual bool RemoveRoomToConnect(ACityGen_RoomBase* Room) override;
 };
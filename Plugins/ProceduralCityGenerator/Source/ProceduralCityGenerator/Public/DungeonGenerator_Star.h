@@ -25,6 +25,11 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Dungeon Settings")
 	TArray<ACityGen_RoomBase*> Obstacles;
 
+	// Connect every room to the central room with one flow field expanded from the central room exits,
+	// instead of one search per room. Not used by the SharedNetwork connection mode
+	UPROPERTY(EditAnywhere, Category = "Dungeon Settings")
+	bool bUseHubFlowField = false;
+
 public:
 	// This return an array without nullptr actors
 	// The pair does not contains same actor
@@ -34,4 +39,9 @@ public:
 	virtual TArray<ACityGen_RoomBase*> GetAllRoomsArray() const override;
 
 	virtual void InitFromSpawnedRooms(const TArray<ACityGen_RoomBase*>& SpawnedRooms) override;
+
+	virtual ACityGen_RoomBase* GetFlowFieldHub() const override;
+
+	virtual bool AddRoomToConnect(ACityGen_RoomBase* Room) override;
+	virtual bool RemoveRoomToConnect(ACityGen_RoomBase* Room) override;
 };
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "GridBasedGeneratorBase.generated.h"
 
 class ACityGen_RoomBase;
+class UStaticMesh;
 
 UCLASS()
 class PROCEDURALCITYGENERATOR_API AGridBasedGeneratorBase : public AActor
@@ -40,6 +41,30 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Corridor Types")
 	TSubclassOf<ACityGen_RoomBase> ElevatorCorridorRoom_UpAndDown;
 
+	// CORRIDOR MESHES, used instead of the corridor types when the corridors are output as instanced meshes
+	// Same pivot and orientation as the matching corridor type
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> CorridorMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> CorridorCornerMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> TJunctionCorridorMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> CrossJunctionCorridorMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> ElevatorCorridorMesh_Up;
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> ElevatorCorridorMesh_Down;
+
+	UPROPERTY(EditAnywhere, Category = "Corridor Meshes")
+	TObjectPtr<UStaticMesh> ElevatorCorridorMesh_UpAndDown;
+
 protected:
 	FVector TileSize = FVector(500, 500, 250);
 
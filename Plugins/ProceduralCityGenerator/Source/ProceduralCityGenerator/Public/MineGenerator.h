@@ -2,12 +2,15 @@
 
 #pragma once
 
+#include "CityGen_FreeRectPacker.h"
 #include "GridBasedGeneratorBase.h"
 
 #include "SimpleGridRuntime/Public/SG_GridCoordinate.h"
+#include "SimpleGridRuntime/Public/SG_GridColumnSet.h"
 
 #include "MineGenerator.generated.h"
 
+class UCityGen_ActorPoolComponent;
 class USG_GridComponentWithSize;
 class ADungeonGenerator_GridBased;
 
@@ -19,6 +22,31 @@ enum class EGeneratorType : uint8
 	Loop    UMETA(DisplayName = "Loop")
 };
 
+// Stages of the time sliced generation, in order
+UENUM(BlueprintType)
+enum class EMineGenerationStage : uint8
+{
+	Idle,
+	PlaceRooms,
+	SnapRooms,
+	BlockTiles,
+	FindPaths,
+	SpawnCorridors,
+	UpdateDoors,
+	Done,
+	Failed
+};
+
+UENUM(BlueprintType)
+enum class ERoomPlacementStrategy : uint8
+{
+	RandomSampling UMETA(DisplayName = "Random Sampling"), // Random cells of the grid, NumRooms * 10 attempts per level
+	FreeRectPacking UMETA(DisplayName = "Free Rectangle Packing (MaxRects)") // Room footprints packed in the free space of each level
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnMineGenerationProgress, EMineGenerationStage, Stage, float, Progress);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMineGenerationComplete, bool, bSuccess);
+
 USTRUCT(BlueprintType)
 struct FStarGeneratorSettings
 {
@@ -92,13 +120,41 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid Settings")
 	int32 GridHeight = 10;
 
+	// FreeRectPacking places each room where its footprint fits best in the free space of the level, never on top of a room
+	// of the level below, and stops a level only once no room type fits anymore
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Room Generation")
+	ERoomPlacementStrategy RoomPlacementStrategy = ERoomPlacementStrategy::RandomSampling;
+
+	// Free cells kept after each room along X and Y, for the corridors
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Room Generation", meta = (ClampMin = "0", EditCondition = "RoomPlacementStrategy == ERoomPlacementStrategy::FreeRectPacking"))
+	int32 RoomSpacing = 1;
+
 	UPROPERTY();
 	TObjectPtr<USG_GridComponentWithSize> GridCmpt;
 
+	// Rooms are released here by ClearRooms and taken back by the next generation
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Room Generation")
+	TObjectPtr<UCityGen_ActorPoolComponent> RoomActorPool;
+
 	// Random seed
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generation")
 	int32 RandomSeed = 12345;
 
+	// Spread the generation started by BeginPlay over several frames instead of blocking the game thread
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generation")
+	bool bTimeSlicedGeneration = false;
+
+	// Time given to the time sliced generation each frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generation", meta = (ClampMin = "0.1", Units = "ms", EditCondition = "bTimeSlicedGeneration"))
+	float GenerationBudgetMs = 4.0f;
+
+	// Broadcast at the end of each frame of the time sliced generation, Progress is the one of the current stage (0 to 1)
+	UPROPERTY(BlueprintAssignable, Category = "Generation")
+	FOnMineGenerationProgress OnGenerationProgress;
+
+	UPROPERTY(BlueprintAssignable, Category = "Generation")
+	FOnMineGenerationComplete OnGenerationComplete;
+
 	// VARIABLES 
 
 	UPROPERTY()
@@ -107,14 +163,33 @@ public:
 	UPROPERTY()
 	TArray<AActor*> SpawnedCorridors;
 
-	UPROPERTY()
-	TSet<FSG_GridCoordinate> OccupiedGridCells;
+	// Cells indexed by (X, Y) column with a Z bit mask, the vertical clearance of a placement is one lookup
+	// The masks start one level below the first one so the level under level 0 is a bit too
+	FSG_GridColumnSet OccupiedGridCells = FSG_GridColumnSet(-1);
 
 private:
 	ADungeonGenerator_GridBased* DungeonGeneratorInstance;
 
 	FRandomStream MineGenRandomStream;
 
+	// Time sliced generation progress
+	EMineGenerationStage GenerationStage = EMineGenerationStage::Idle;
+	int32 PlacementLevelIndex = 0;
+	int32 PlacementAttempts = 0;
+	int32 PlacementSpawned = 0;
+
+	// Generator connecting the rooms, the star one when the central room is used
+	ADungeonGenerator_GridBased* ConnectingGenerator = nullptr;
+
+	// Free space of the level being placed, and the footprints of its rooms and of the rooms of the level below
+	FCityGen_FreeRectPacker LevelFreeSpace;
+	TArray<FIntRect> CurrentLevelRoomRects;
+	TArray<FIntRect> PreviousLevelRoomRects;
+
+	// Footprint of each room class at yaw 0, measured once on a spawned room
+	UPROPERTY(Transient)
+	TMap<TSubclassOf<ACityGen_RoomBase>, FIntPoint> RoomFootprintCache;
+
 public:
 	// Sets default values for this actor's properties
 	AMineGenerator();
@@ -130,10 +205,84 @@ public:
 	UFUNCTION(CallInEditor, Category = "Room Generation")
 	bool SpawnCorridorGenerator();
 
+	// Spawn parked actors of every room type in the room pool, and of every corridor type in the corridor pool
+	// To be called during a loading screen, after SpawnCorridorGenerator
+	UFUNCTION(BlueprintCallable, Category = "Room Generation")
+	void WarmUpPools(int32 NumRoomsPerType, int32 NumCorridorsPerType);
+
+	// Pool sizes of the next level, the parked actors above them are destroyed
+	UFUNCTION(BlueprintCallable, Category = "Room Generation")
+	void ResizePools(int32 MaxRoomsPerType, int32 MaxCorridorsPerType);
+
 	ACityGen_RoomBase* SpawnCentralRoom();
 
+	// Taken from the room pool when possible
+	ACityGen_RoomBase* SpawnRoom(TSubclassOf<ACityGen_RoomBase> RoomClass, const FVector& Location, const FRotator& Rotation);
+
+	// Same result as GenerateMine, run by Tick within GenerationBudgetMs each frame
+	// @return: false if the generation could not start
+	UFUNCTION(BlueprintCallable, Category = "Room Generation")
+	bool StartTimeSlicedGeneration();
+
+	UFUNCTION(BlueprintPure, Category = "Room Generation")
+	EMineGenerationStage GetGenerationStage() const
+	{
+		return GenerationStage;
+	}
+
+#if WITH_EDITOR
+	// Run the random sampling placement of TryPlaceRoomOnLevel for up to 10k rooms without spawning them, and log the
+	// time per room of its clearance check on the column index and on the Morton cell set it replaced
+	UFUNCTION(CallInEditor, Category = "Room Generation")
+	void BenchmarkRoomPlacement();
+#endif // WITH_EDITOR
+
+	virtual void Tick(float DeltaTime) override;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Reset the free space of the level, called before its first placement
+	void BeginPlacementLevel(int32 LevelIndex);
+
+	// One placement attempt on the level, with RoomPlacementStrategy
+	// @return: true if a room was spawned
+	bool TryPlaceRoomOnLevel(int32 LevelIndex);
+
+	// Random room type, cell and rotation of a RandomSampling attempt, drawn from MineGenRandomStream
+	void SampleRoomPlacement(int32 LevelIndex, int32& OutRoomTypeIndex, FSG_GridCoordinate& OutCoord, FRotator& OutRotation);
+
+	// @return: true if a room is already placed on the column of the cell, on its level or the ones next to it
+	bool IsTooCloseVertically(const FSG_GridCoordinate& Coord) const
+	{
+		return OccupiedGridCells.ContainsAnyInColumn(Coord.X, Coord.Y, Coord.Z - 1, Coord.Z + 1);
+	}
+
+	// @return: false when no more room can be placed on the level, so a failed attempt ends the level
+	bool CanRetryFailedPlacement() const
+	{
+		return RoomPlacementStrategy == ERoomPlacementStrategy::RandomSampling;
+	}
+
+	// Random room type first, then the other types, at the best free position for its footprint
+	// @return: false if no room type fits anywhere on the level
+	bool TryPackRoomOnLevel(int32 LevelIndex);
+
+	FIntPoint GetRoomFootprint(TSubclassOf<ACityGen_RoomBase> RoomClass);
+
+	// Cells of the grid settings, X in [-GridWidth / 2, GridWidth / 2] and Y in [-GridHeight / 2, GridHeight / 2]
+	FIntRect GetPlacementArea() const;
+
+	// Give the spawned rooms to the generator, spawning the central room first for the star generator
+	// @return: the generator to connect the rooms with, nullptr on failure
+	ADungeonGenerator_GridBased* PrepareGeneratorForConnection();
+
+	// Run the stages until the deadline (FPlatformTime::Seconds) is reached or the generation ends
+	void StepGeneration(double DeadlineSeconds);
+
+	float GetGenerationStageProgress() const;
+
+	void FinishGeneration(bool bSuccess);
+
 };
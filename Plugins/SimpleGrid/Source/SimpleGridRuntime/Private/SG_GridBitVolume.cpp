@@ -0,0 +1,143 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#include "SimpleGridRuntime/Public/SG_GridBitVolume.h"
+
+void FSG_GridBitVolume::Init(const FSG_GridCoordinate& InOrigin, const FIntVector& InSize)
+{
+	check((InSize.X >= 0) && (InSize.Y >= 0) && (InSize.Z >= 0));
+
+	Origin = InOrigin;
+	Size = InSize;
+	WordsPerRow = FMath::DivideAndRoundUp(Size.X, BitsPerWord);
+	Words.Init(0, WordsPerRow * Size.Y * Size.Z);
+}
+
+void FSG_GridBitVolume::Reset()
+{
+	Origin = FSG_GridCoordinate(0, 0, 0);
+	Size = FIntVector(0, 0, 0);
+	WordsPerRow = 0;
+	Words.Empty();
+}
+
+void FSG_GridBitVolume::ClearAll()
+{
+	FMemory::Memzero(Words.GetData(), Words.Num() * sizeof(uint64));
+}
+
+void FSG_GridBitVolume::Set(const FSG_GridCoordinate& Coord)
+{
+	if (!IsInside(Coord))
+	{
+		return;
+	}
+	const int32 LocalX = Coord.X - Origin.X;
+	Words[GetRowWordIndex(Coord) + (LocalX / BitsPerWord)] |= (uint64(1) << (LocalX % BitsPerWord));
+}
+
+void FSG_GridBitVolume::Clear(const FSG_GridCoordinate& Coord)
+{
+	if (!IsInside(Coord))
+	{
+		return;
+	}
+	const int32 LocalX = Coord.X - Origin.X;
+	Words[GetRowWordIndex(Coord) + (LocalX / BitsPerWord)] &= ~(uint64(1) << (LocalX % BitsPerWord));
+}
+
+void FSG_GridBitVolume::SetBox(const FSG_GridCoordinate& BoxMin, const FSG_GridCoordinate& BoxMax, bool bValue)
+{
+	// Clip to the volume
+	const int32 MinX = FMath::Max(BoxMin.X, Origin.X);
+	const int32 MinY = FMath::Max(BoxMin.Y, Origin.Y);
+	const int32 MinZ = FMath::Max(BoxMin.Z, Origin.Z);
+	const int32 MaxX = FMath::Min(BoxMax.X, Origin.X + Size.X - 1);
+	const int32 MaxY = FMath::Min(BoxMax.Y, Origin.Y + Size.Y - 1);
+	const int32 MaxZ = FMath::Min(BoxMax.Z, Origin.Z + Size.Z - 1);
+	if ((MinX > MaxX) || (MinY > MaxY) || (MinZ > MaxZ))
+	{
+		return;
+	}
+
+	for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+	{
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			SetRowRange(GetRowWordIndex(FSG_GridCoordinate(MinX, Y, Z)), MinX - Origin.X, MaxX - Origin.X, bValue);
+		}
+	}
+}
+
+void FSG_GridBitVolume::SetRowRange(int32 RowWordIndex, int32 FirstX, int32 LastX, bool bValue)
+{
+	const int32 FirstWord = FirstX / BitsPerWord;
+	const int32 LastWord = LastX / BitsPerWord;
+	for (int32 WordIndex = FirstWord; WordIndex <= LastWord; ++WordIndex)
+	{
+		uint64 Mask = ~uint64(0);
+		if (WordIndex == FirstWord)
+		{
+			Mask &= ~uint64(0) << (FirstX % BitsPerWord);
+		}
+		if (WordIndex == LastWord)
+		{
+			Mask &= ~uint64(0) >> (BitsPerWord - 1 - (LastX % BitsPerWord));
+		}
+
+		uint64& Word = Words[RowWordIndex + WordIndex];
+		Word = bValue ? (Word | Mask) : (Word & ~Mask);
+	}
+}
+
+uint32 FSG_GridBitVolume::GetBoxHash(const FSG_GridCoordinate& BoxMin, const FSG_GridCoordinate& BoxMax) const
+{
+	// Clip to the volume
+	const int32 MinX = FMath::Max(BoxMin.X, Origin.X);
+	const int32 MinY = FMath::Max(BoxMin.Y, Origin.Y);
+	const int32 MinZ = FMath::Max(BoxMin.Z, Origin.Z);
+	const int32 MaxX = FMath::Min(BoxMax.X, Origin.X + Size.X - 1);
+	const int32 MaxY = FMath::Min(BoxMax.Y, Origin.Y + Size.Y - 1);
+	const int32 MaxZ = FMath::Min(BoxMax.Z, Origin.Z + Size.Z - 1);
+	if ((MinX > MaxX) || (MinY > MaxY) || (MinZ > MaxZ))
+	{
+		return 0;
+	}
+
+	const int32 FirstX = MinX - Origin.X;
+	const int32 LastX = MaxX - Origin.X;
+	const int32 FirstWord = FirstX / BitsPerWord;
+	const int32 LastWord = LastX / BitsPerWord;
+
+	uint32 Hash = 0;
+	for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+	{
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			const int32 RowWordIndex = GetRowWordIndex(FSG_GridCoordinate(MinX, Y, Z));
+			for (int32 WordIndex = FirstWord; WordIndex <= LastWord; ++WordIndex)
+			{
+				uint64 Mask = ~uint64(0);
+				if (WordIndex == FirstWord)
+				{
+					Mask &= ~uint64(0) << (FirstX % BitsPerWord);
+				}
+				if (WordIndex == LastWord)
+				{
+					Mask &= ~uint64(0) >> (BitsPerWord - 1 - (LastX % BitsPerWord));
+				}
+				Hash = HashCombineFast(Hash, GetTypeHash(Words[RowWordIndex + WordIndex] & Mask));
+			}
+		}
+	}
+	return Hash;
+}
+
+int32 FSG_GridBitVolume::CountSetBits() const
+{
+	int32 Count = 0;
+	for (uint64 Word : Words)
+	{
+		Count += FMath::CountBits(Word);
+	}
+	return Count;
+}
@@ -1,6 +1,7 @@
 // Copyright Chateau Pageot, Inc. All Rights Reserved.
 
 #include "SimpleGridRuntime/Public/SG_GridComponent.h"
+#include "SimpleGridRuntime/Public/SG_GridNeighbours.h"
 
 #include "Net/UnrealNetwork.h"
 
@@ -176,31 +177,20 @@ FSG_GridCoordinate USG_GridComponent::AdjacentCellFromDirectionWS(const FSG_Grid
 }
 
 // Get neighboor nodes in 2D space
+// Allocate an array for each call, prefer FSG_GridNeighbours in loops
 TArray<FSG_GridCoordinate> USG_GridComponent::GetNeighbourNodes2D(const FSG_GridCoordinate& Node)
 {
-	TArray<FSG_GridCoordinate> NeighbourNodes;
-	NeighbourNodes.Reserve(4);
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(1, 0, 0))); // west
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(0, 1, 0))); // North
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(-1, 0, 0))); // East
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(0, -1, 0))); // South
-
-	return NeighbourNodes;
+	FSG_GridCoordinate NeighbourNodes[FSG_GridNeighbours::Num2D];
+	FSG_GridNeighbours::GetNeighbours(Node, NeighbourNodes); // west, North, East, South
+	return TArray<FSG_GridCoordinate>(NeighbourNodes, FSG_GridNeighbours::Num2D);
 }
 
 // Get neighboor nodes in 3D space
 TArray<FSG_GridCoordinate> USG_GridComponent::GetNeighbourNodes3D(const FSG_GridCoordinate& Node)
 {
-	TArray<FSG_GridCoordinate> NeighbourNodes;
-	NeighbourNodes.Reserve(6);
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(1, 0, 0))); // west
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(0, 1, 0))); // North
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(-1, 0, 0))); // East
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(0, -1, 0))); // South
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(0, 0, 1))); // Up
-	NeighbourNodes.Add(FSG_GridCoordinate(Node + FSG_GridCoordinate(0, 0, -1))); // Down
-
-	return NeighbourNodes;
+	FSG_GridCoordinate NeighbourNodes[FSG_GridNeighbours::Num3D];
+	FSG_GridNeighbours::GetNeighbours(Node, NeighbourNodes); // west, North, East, South, Up, Down
+	return TArray<FSG_GridCoordinate>(NeighbourNodes, FSG_GridNeighbours::Num3D);
 }
 
 void USG_GridComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -0,0 +1,132 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "SG_GridCoordinate.h"
+#include "SG_GridNeighbours.h"
+
+#include "CoreMinimal.h"
+
+// One bit per cell for a box of grid coordinates
+// X is the fastest axis and every X row starts on a new 64 bits word, so a run of X can be set/cleared a word at a time
+// Coordinates outside of the volume are never set
+struct SIMPLEGRIDRUNTIME_API FSG_GridBitVolume
+{
+public:
+	static constexpr int32 BitsPerWord = 64;
+
+private:
+	FSG_GridCoordinate Origin = {};
+	FIntVector Size = FIntVector(0, 0, 0);
+	int32 WordsPerRow = 0;
+	TArray<uint64> Words;
+
+public:
+	// Resize the volume to cover [InOrigin, InOrigin + InSize[ and clear all bits
+	void Init(const FSG_GridCoordinate& InOrigin, const FIntVector& InSize);
+
+	// Release memory, the volume contains no cell after that
+	void Reset();
+
+	void ClearAll();
+
+	const FSG_GridCoordinate& GetOrigin() const
+	{
+		return Origin;
+	}
+
+	const FIntVector& GetSize() const
+	{
+		return Size;
+	}
+
+	bool IsInside(const FSG_GridCoordinate& Coord) const
+	{
+		return (Coord.X >= Origin.X) && (Coord.X < Origin.X + Size.X) &&
+			(Coord.Y >= Origin.Y) && (Coord.Y < Origin.Y + Size.Y) &&
+			(Coord.Z >= Origin.Z) && (Coord.Z < Origin.Z + Size.Z);
+	}
+
+	// Return false outside of the volume
+	FORCEINLINE bool IsSet(const FSG_GridCoordinate& Coord) const
+	{
+		if (!IsInside(Coord))
+		{
+			return false;
+		}
+		const int32 LocalX = Coord.X - Origin.X;
+		return (Words[GetRowWordIndex(Coord) + (LocalX / BitsPerWord)] & (uint64(1) << (LocalX % BitsPerWord))) != 0;
+	}
+
+	// Bit d set if the neighbour in direction d (see FSG_GridNeighbours) is inside the volume and not set
+	// The six bits are read together from the words of the cell row and of the four rows around it
+	FORCEINLINE uint8 GetNeighbourClearMask3D(const FSG_GridCoordinate& Coord) const
+	{
+		const int32 LocalX = Coord.X - Origin.X;
+		const int32 LocalY = Coord.Y - Origin.Y;
+		const int32 LocalZ = Coord.Z - Origin.Z;
+		const bool bIsInterior = (LocalX > 0) && (LocalX < Size.X - 1) &&
+			(LocalY > 0) && (LocalY < Size.Y - 1) &&
+			(LocalZ > 0) && (LocalZ < Size.Z - 1);
+		if (!bIsInterior)
+		{
+			// Border cells, or outside of the volume
+			uint8 Mask = 0;
+			for (int32 Direction = 0; Direction < FSG_GridNeighbours::Num3D; ++Direction)
+			{
+				const FSG_GridCoordinate Neighbour = FSG_GridNeighbours::GetNeighbour(Coord, Direction);
+				if (IsInside(Neighbour) && !IsSet(Neighbour))
+				{
+					Mask |= uint8(1) << Direction;
+				}
+			}
+			return Mask;
+		}
+
+		const int32 RowWordIndex = GetRowWordIndex(Coord);
+		const int32 RowStrideZ = WordsPerRow * Size.Y;
+		const uint64 SetBits =
+			(GetRowBit(RowWordIndex, LocalX + 1) << 0) |
+			(GetRowBit(RowWordIndex + WordsPerRow, LocalX) << 1) |
+			(GetRowBit(RowWordIndex, LocalX - 1) << 2) |
+			(GetRowBit(RowWordIndex - WordsPerRow, LocalX) << 3) |
+			(GetRowBit(RowWordIndex + RowStrideZ, LocalX) << 4) |
+			(GetRowBit(RowWordIndex - RowStrideZ, LocalX) << 5);
+		return uint8(~SetBits) & FSG_GridNeighbours::AllDirectionsMask3D;
+	}
+
+	// Ignored outside of the volume
+	void Set(const FSG_GridCoordinate& Coord);
+
+	// Ignored outside of the volume
+	void Clear(const FSG_GridCoordinate& Coord);
+
+	// Set or clear all cells of the inclusive box [BoxMin, BoxMax], clipped to the volume
+	void SetBox(const FSG_GridCoordinate& BoxMin, const FSG_GridCoordinate& BoxMax, bool bValue);
+
+	int32 CountSetBits() const;
+
+	// Hash of the bits of the inclusive box [BoxMin, BoxMax], clipped to the volume, read a word at a time
+	uint32 GetBoxHash(const FSG_GridCoordinate& BoxMin, const FSG_GridCoordinate& BoxMax) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Words.GetAllocatedSize();
+	}
+
+private:
+	// Coord need to be inside the volume
+	FORCEINLINE int32 GetRowWordIndex(const FSG_GridCoordinate& Coord) const
+	{
+		return ((Coord.Y - Origin.Y) + (Coord.Z - Origin.Z) * Size.Y) * WordsPerRow;
+	}
+
+	// 0 or 1, LocalX need to be inside the row
+	FORCEINLINE uint64 GetRowBit(int32 RowWordIndex, int32 LocalX) const
+	{
+		return (Words[RowWordIndex + (LocalX / BitsPerWord)] >> (LocalX % BitsPerWord)) & 1;
+	}
+
+	// Local X, inclusive range
+	void SetRowRange(int32 RowWordIndex, int32 FirstX, int32 LastX, bool bValue);
+};
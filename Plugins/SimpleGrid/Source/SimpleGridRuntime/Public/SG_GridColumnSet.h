@@ -0,0 +1,146 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "SG_GridCoordinate.h"
+#include "SG_MortonKey.h"
+
+#include "CoreMinimal.h"
+
+// Set of grid cells indexed by (X, Y) column, with one bit per Z level of the column
+// Z in [MinZ, MinZ + 64[ is a bit of the column mask, so testing a range of levels above and below a cell is one map
+// lookup and a mask. Cells outside of these levels are kept in a Morton cell set and always give the same answers
+struct FSG_GridColumnSet
+{
+public:
+	static constexpr int32 LevelsPerColumn = 64;
+
+private:
+	TMap<uint64, uint64> Columns;
+	FSG_MortonCellSet OutOfRangeCells;
+	int32 MinZ = 0;
+	int32 NumCells = 0;
+
+public:
+	FSG_GridColumnSet() = default;
+
+	explicit FSG_GridColumnSet(int32 InMinZ)
+		: MinZ(InMinZ)
+	{
+	}
+
+	// Lowest level stored in the column masks, the set must be empty
+	void SetMinZ(int32 InMinZ)
+	{
+		check(NumCells == 0);
+		MinZ = InMinZ;
+	}
+
+	int32 GetMinZ() const
+	{
+		return MinZ;
+	}
+
+	// @return: false if the cell was already in the set
+	bool Add(const FSG_GridCoordinate& Coord)
+	{
+		if (!IsLevelInRange(Coord.Z))
+		{
+			const bool bAdded = OutOfRangeCells.Add(Coord);
+			NumCells += bAdded ? 1 : 0;
+			return bAdded;
+		}
+
+		uint64& Column = Columns.FindOrAdd(GetColumnKey(Coord.X, Coord.Y), 0);
+		const uint64 Bit = 1ull << (Coord.Z - MinZ);
+		if ((Column & Bit) != 0)
+		{
+			return false;
+		}
+		Column |= Bit;
+		NumCells++;
+		return true;
+	}
+
+	bool Contains(const FSG_GridCoordinate& Coord) const
+	{
+		return ContainsAnyInColumn(Coord.X, Coord.Y, Coord.Z, Coord.Z);
+	}
+
+	// @return: true if a cell of the column (X, Y) is in the inclusive level range [FirstZ, LastZ]
+	bool ContainsAnyInColumn(int32 X, int32 Y, int32 FirstZ, int32 LastZ) const
+	{
+		if (FirstZ > LastZ)
+		{
+			return false;
+		}
+
+		// Levels of the range outside of the masks
+		for (int32 Z = FirstZ; Z <= FMath::Min(LastZ, MinZ - 1); ++Z)
+		{
+			if (OutOfRangeCells.Contains(FSG_GridCoordinate(X, Y, Z)))
+			{
+				return true;
+			}
+		}
+		for (int32 Z = FMath::Max(FirstZ, MinZ + LevelsPerColumn); Z <= LastZ; ++Z)
+		{
+			if (OutOfRangeCells.Contains(FSG_GridCoordinate(X, Y, Z)))
+			{
+				return true;
+			}
+		}
+
+		const int32 FirstLevel = FMath::Max(FirstZ, MinZ) - MinZ;
+		const int32 LastLevel = FMath::Min(LastZ, MinZ + LevelsPerColumn - 1) - MinZ;
+		if (FirstLevel > LastLevel)
+		{
+			return false;
+		}
+
+		const uint64* Column = Columns.Find(GetColumnKey(X, Y));
+		if (Column == nullptr)
+		{
+			return false;
+		}
+		// Bits FirstLevel to LastLevel, the shift by 64 of a full column is avoided
+		const uint64 RangeMask = (~0ull >> (LevelsPerColumn - 1 - (LastLevel - FirstLevel))) << FirstLevel;
+		return (*Column & RangeMask) != 0;
+	}
+
+	int32 Num() const
+	{
+		return NumCells;
+	}
+
+	void Empty()
+	{
+		Columns.Empty();
+		OutOfRangeCells.Empty();
+		NumCells = 0;
+	}
+
+	// Keep the memory
+	void Reset()
+	{
+		Columns.Reset();
+		OutOfRangeCells.Reset();
+		NumCells = 0;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Columns.GetAllocatedSize() + OutOfRangeCells.GetAllocatedSize();
+	}
+
+private:
+	bool IsLevelInRange(int32 Z) const
+	{
+		return (Z >= MinZ) && (Z < MinZ + LevelsPerColumn);
+	}
+
+	static uint64 GetColumnKey(int32 X, int32 Y)
+	{
+		return ((uint64)(uint32)X << 32) | (uint64)(uint32)Y;
+	}
+};
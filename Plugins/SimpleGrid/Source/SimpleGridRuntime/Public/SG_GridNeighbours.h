@@ -0,0 +1,69 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "SG_GridCoordinate.h"
+
+#include "CoreMinimal.h"
+
+// Neighbours of a grid cell without building an array, for the inner loops of the grid searches
+// Directions are in the same order as USG_GridComponent::GetNeighbourNodes3D: +X, +Y, -X, -Y, +Z, -Z
+// The 2D neighbours are the first four directions
+struct FSG_GridNeighbours
+{
+public:
+	static constexpr int32 Num2D = 4;
+	static constexpr int32 Num3D = 6;
+
+	// Bit d set for every direction d, see FSG_GridBitVolume::GetNeighbourClearMask3D
+	static constexpr uint8 AllDirectionsMask3D = (1 << Num3D) - 1;
+
+	static constexpr int32 OffsetX[Num3D] = { 1, 0, -1, 0, 0, 0 };
+	static constexpr int32 OffsetY[Num3D] = { 0, 1, 0, -1, 0, 0 };
+	static constexpr int32 OffsetZ[Num3D] = { 0, 0, 0, 0, 1, -1 };
+
+public:
+	static FORCEINLINE FSG_GridCoordinate GetOffset(int32 Direction)
+	{
+		return FSG_GridCoordinate(OffsetX[Direction], OffsetY[Direction], OffsetZ[Direction]);
+	}
+
+	static FORCEINLINE FSG_GridCoordinate GetNeighbour(const FSG_GridCoordinate& Node, int32 Direction)
+	{
+		return FSG_GridCoordinate(Node.X + OffsetX[Direction], Node.Y + OffsetY[Direction], Node.Z + OffsetZ[Direction]);
+	}
+
+	// Fill a fixed size buffer, use Num2D or Num3D as size
+	template<int32 NumDirections>
+	static FORCEINLINE void GetNeighbours(const FSG_GridCoordinate& Node, FSG_GridCoordinate (&OutNeighbours)[NumDirections])
+	{
+		static_assert((NumDirections == Num2D) || (NumDirections == Num3D), "Only 2D and 3D neighbours are supported");
+		for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+		{
+			OutNeighbours[Direction] = GetNeighbour(Node, Direction);
+		}
+	}
+
+	// @param Functor: void(int32 Direction, const FSG_GridCoordinate& Neighbour)
+	template<int32 NumDirections = Num3D, typename FunctorType>
+	static FORCEINLINE void ForEachNeighbour(const FSG_GridCoordinate& Node, FunctorType&& Functor)
+	{
+		static_assert((NumDirections == Num2D) || (NumDirections == Num3D), "Only 2D and 3D neighbours are supported");
+		for (int32 Direction = 0; Direction < NumDirections; ++Direction)
+		{
+			Functor(Direction, GetNeighbour(Node, Direction));
+		}
+	}
+
+	// Only calls the functor for the directions whose bit is set in DirectionMask
+	template<typename FunctorType>
+	static FORCEINLINE void ForEachNeighbourInMask(const FSG_GridCoordinate& Node, uint8 DirectionMask, FunctorType&& Functor)
+	{
+		while (DirectionMask != 0)
+		{
+			const int32 Direction = FMath::CountTrailingZeros(uint32(DirectionMask));
+			DirectionMask &= DirectionMask - 1;
+			Functor(Direction, GetNeighbour(Node, Direction));
+		}
+	}
+};
@@ -0,0 +1,241 @@
+// Copyright Chateau Pageot, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "SG_GridCoordinate.h"
+
+#include "CoreMinimal.h"
+
+// pdep/pext interleave the bits in one instruction. They are part of BMI2, which every CPU with AVX2 has
+#if PLATFORM_CPU_X86_FAMILY && (defined(__BMI2__) || defined(__AVX2__))
+	#define SG_MORTON_USE_BMI2 1
+	#include <immintrin.h>
+#else
+	#define SG_MORTON_USE_BMI2 0
+#endif
+
+// Grid coordinate packed in a 64 bits Morton (Z-order) code: the bits of X, Y and Z are interleaved, X in the lowest bit
+// Each axis keeps 21 bits, so the coordinates must be in [MinCoordinate, MaxCoordinate]
+// Cells close on the grid get close codes: containers ordered or bucketed by code keep neighbour cells together in memory
+struct FSG_MortonKey
+{
+public:
+	static constexpr int32 BitsPerAxis = 21;
+	static constexpr int32 MinCoordinate = -(1 << (BitsPerAxis - 1));
+	static constexpr int32 MaxCoordinate = (1 << (BitsPerAxis - 1)) - 1;
+
+	// Bits of each axis in the code
+	static constexpr uint64 MaskX = 0x1249249249249249ull;
+	static constexpr uint64 MaskY = MaskX << 1;
+	static constexpr uint64 MaskZ = MaskX << 2;
+
+	uint64 Code = 0;
+
+public:
+	FSG_MortonKey() = default;
+
+	explicit FSG_MortonKey(uint64 InCode)
+		: Code(InCode)
+	{
+	}
+
+	explicit FSG_MortonKey(const FSG_GridCoordinate& Coord)
+		: Code(Encode(Coord.X, Coord.Y, Coord.Z))
+	{
+	}
+
+	FSG_GridCoordinate ToCoord() const
+	{
+		return Decode(Code);
+	}
+
+	static bool IsEncodable(const FSG_GridCoordinate& Coord)
+	{
+		return (Coord.X >= MinCoordinate) && (Coord.X <= MaxCoordinate)
+			&& (Coord.Y >= MinCoordinate) && (Coord.Y <= MaxCoordinate)
+			&& (Coord.Z >= MinCoordinate) && (Coord.Z <= MaxCoordinate);
+	}
+
+	static FORCEINLINE uint64 Encode(int32 X, int32 Y, int32 Z)
+	{
+		checkSlow(IsEncodable(FSG_GridCoordinate(X, Y, Z)));
+#if SG_MORTON_USE_BMI2
+		return _pdep_u64(ToUnsigned(X), MaskX) | _pdep_u64(ToUnsigned(Y), MaskY) | _pdep_u64(ToUnsigned(Z), MaskZ);
+#else
+		return EncodePortable(X, Y, Z);
+#endif
+	}
+
+	static FORCEINLINE FSG_GridCoordinate Decode(uint64 InCode)
+	{
+#if SG_MORTON_USE_BMI2
+		return FSG_GridCoordinate(ToSigned(_pext_u64(InCode, MaskX)), ToSigned(_pext_u64(InCode, MaskY)), ToSigned(_pext_u64(InCode, MaskZ)));
+#else
+		return DecodePortable(InCode);
+#endif
+	}
+
+	// Shifts and masks, same result as the BMI2 version
+	static FORCEINLINE uint64 EncodePortable(int32 X, int32 Y, int32 Z)
+	{
+		return SpreadBits(ToUnsigned(X)) | (SpreadBits(ToUnsigned(Y)) << 1) | (SpreadBits(ToUnsigned(Z)) << 2);
+	}
+
+	static FORCEINLINE FSG_GridCoordinate DecodePortable(uint64 InCode)
+	{
+		return FSG_GridCoordinate(ToSigned(CompactBits(InCode)), ToSigned(CompactBits(InCode >> 1)), ToSigned(CompactBits(InCode >> 2)));
+	}
+
+	bool operator==(const FSG_MortonKey& Other) const
+	{
+		return Code == Other.Code;
+	}
+
+	bool operator!=(const FSG_MortonKey& Other) const
+	{
+		return Code != Other.Code;
+	}
+
+	// Z-order
+	bool operator<(const FSG_MortonKey& Other) const
+	{
+		return Code < Other.Code;
+	}
+
+	friend uint32 GetTypeHash(const FSG_MortonKey& Key)
+	{
+		return GetTypeHash(Key.Code);
+	}
+
+private:
+	// Offset so that the coordinates are positive, the order of the codes follows the order of the coordinates
+	static FORCEINLINE uint64 ToUnsigned(int32 Value)
+	{
+		return (uint64)((uint32)Value - (uint32)MinCoordinate) & ((1ull << BitsPerAxis) - 1);
+	}
+
+	static FORCEINLINE int32 ToSigned(uint64 Value)
+	{
+		return (int32)Value + MinCoordinate;
+	}
+
+	// Move the 21 lowest bits to every third bit
+	static FORCEINLINE uint64 SpreadBits(uint64 Value)
+	{
+		Value &= 0x1fffffull;
+		Value = (Value | (Value << 32)) & 0x1f00000000ffffull;
+		Value = (Value | (Value << 16)) & 0x1f0000ff0000ffull;
+		Value = (Value | (Value << 8)) & 0x100f00f00f00f00full;
+		Value = (Value | (Value << 4)) & 0x10c30c30c30c30c3ull;
+		Value = (Value | (Value << 2)) & MaskX;
+		return Value;
+	}
+
+	// Inverse of SpreadBits
+	static FORCEINLINE uint64 CompactBits(uint64 Value)
+	{
+		Value &= MaskX;
+		Value = (Value ^ (Value >> 2)) & 0x10c30c30c30c30c3ull;
+		Value = (Value ^ (Value >> 4)) & 0x100f00f00f00f00full;
+		Value = (Value ^ (Value >> 8)) & 0x1f0000ff0000ffull;
+		Value = (Value ^ (Value >> 16)) & 0x1f00000000ffffull;
+		Value = (Value ^ (Value >> 32)) & 0x1fffffull;
+		return Value;
+	}
+};
+
+// Set of grid cells stored by bricks of 4x4x4 cells, one bit per cell
+// The brick of a cell is its Morton code without the 6 lowest bits, so the 64 cells of a brick are a single word
+// and the cells of a room or of a corridor share a few map entries instead of one each
+struct FSG_MortonCellSet
+{
+public:
+	static constexpr int32 BrickShift = 6;
+	static constexpr uint64 CellInBrickMask = (1ull << BrickShift) - 1;
+
+private:
+	TMap<uint64, uint64> Bricks;
+	int32 NumCells = 0;
+
+public:
+	// @return: false if the cell was already in the set
+	bool Add(const FSG_GridCoordinate& Coord)
+	{
+		const uint64 Code = FSG_MortonKey::Encode(Coord.X, Coord.Y, Coord.Z);
+		uint64& Brick = Bricks.FindOrAdd(Code >> BrickShift, 0);
+		const uint64 Bit = 1ull << (Code & CellInBrickMask);
+		if ((Brick & Bit) != 0)
+		{
+			return false;
+		}
+		Brick |= Bit;
+		NumCells++;
+		return true;
+	}
+
+	// @return: false if the cell was not in the set
+	bool Remove(const FSG_GridCoordinate& Coord)
+	{
+		const uint64 Code = FSG_MortonKey::Encode(Coord.X, Coord.Y, Coord.Z);
+		uint64* Brick = Bricks.Find(Code >> BrickShift);
+		const uint64 Bit = 1ull << (Code & CellInBrickMask);
+		if ((Brick == nullptr) || ((*Brick & Bit) == 0))
+		{
+			return false;
+		}
+		*Brick &= ~Bit;
+		if (*Brick == 0)
+		{
+			Bricks.Remove(Code >> BrickShift);
+		}
+		NumCells--;
+		return true;
+	}
+
+	bool Contains(const FSG_GridCoordinate& Coord) const
+	{
+		const uint64 Code = FSG_MortonKey::Encode(Coord.X, Coord.Y, Coord.Z);
+		const uint64* Brick = Bricks.Find(Code >> BrickShift);
+		return (Brick != nullptr) && ((*Brick & (1ull << (Code & CellInBrickMask))) != 0);
+	}
+
+	int32 Num() const
+	{
+		return NumCells;
+	}
+
+	void Empty()
+	{
+		Bricks.Empty();
+		NumCells = 0;
+	}
+
+	// Keep the memory
+	void Reset()
+	{
+		Bricks.Reset();
+		NumCells = 0;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Bricks.GetAllocatedSize();
+	}
+
+	// Cells of a brick are visited in Z-order, the order of the bricks is the one of the map
+	// @param Functor: void(const FSG_GridCoordinate& Coord)
+	template<typename FunctorType>
+	void ForEach(FunctorType&& Functor) const
+	{
+		for (const TPair<uint64, uint64>& Brick : Bricks)
+		{
+			uint64 Bits = Brick.Value;
+			while (Bits != 0)
+			{
+				const uint64 CellInBrick = FMath::CountTrailingZeros64(Bits);
+				Bits &= Bits - 1;
+				Functor(FSG_MortonKey::Decode((Brick.Key << BrickShift) | CellInBrick));
+			}
+		}
+	}
+};